@@ -0,0 +1,843 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "utils.h"
+#include "binaryheap.h"
+#include "pqueue.h"
+#include "multiqueue.h"
+#include "extsort.h"
+#include "topk.h"
+#include "minmaxheap.h"
+#include "radixheap.h"
+#include "timerwheel.h"
+
+
+/**********************************************************
+ * Benchmarks for the binheap.  Built as binaryheap_bench
+ * with the BENCH_BINARYHEAP flag, usage:
+ *   binaryheap_bench [benchmark] [n]
+ ***********************************************************/
+#ifdef BENCH_BINARYHEAP
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+
+/* inserts into a heap that starts tiny and doubles, against one sized up front */
+static void bench_grow(int n) {
+	int sizes[2] = {0, n};
+	int run, i;
+	for (run = 0; run < 2; run++) {
+		double start = now_seconds();
+		binheap* h = create_binheap(sizes[run]);
+		for (i = 0; i < n; i++) {
+			insert(h, (int)((long long)i * 7919 % n));
+		}
+		double inserted = now_seconds();
+		while (!is_heap_empty(h)) {
+			delete_min(h);
+		}
+		printf("%-20s %10i keys  insert %8.3f s  delete_min %8.3f s\n",
+				(run == 0) ? "growing from 4" : "sized up front", n, inserted - start, now_seconds() - inserted);
+		free_binheap(h);
+	}
+}
+
+
+
+/* xorshift64*, the same keys for every arity */
+static unsigned int next_random(unsigned long long* state) {
+	unsigned long long x = *state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return (unsigned int)((x * 0x2545F4914F6CDD1DULL) >> 33);
+}
+
+
+
+/*
+ * fills a heap with n random keys and empties it, then runs an event
+ * queue: n times pop the earliest key and push one a random delay later
+ */
+static void bench_dary(int n) {
+	int arities[4] = {2, 4, 8, 16};
+	int run, i;
+	for (run = 0; run < 4; run++) {
+		unsigned long long state = 0x9E3779B97F4A7C15ULL;
+		binheap* h = create_dary_binheap(n, arities[run]);
+		double start = now_seconds();
+		for (i = 0; i < n; i++) {
+			insert(h, (int)(next_random(&state) & 0x3FFFFFFF));
+		}
+		double inserted = now_seconds();
+		while (!is_heap_empty(h)) {
+			delete_min(h);
+		}
+		double deleted = now_seconds();
+		for (i = 0; i < n; i++) {
+			insert(h, (int)(next_random(&state) & 0xFFFFFF));
+		}
+		double filled = now_seconds();
+		for (i = 0; i < n; i++) {
+			int now = delete_min(h);
+			insert(h, now + (int)(next_random(&state) & 0xFFFF));
+		}
+		printf("%2i-ary %10i keys  insert %8.3f s  delete_min %8.3f s  pop+push %8.3f s\n",
+				arities[run], n, inserted - start, deleted - inserted, now_seconds() - filled);
+		free_binheap(h);
+	}
+}
+
+
+
+/* a random graph in adjacency array form, degree edges out of every vertex */
+typedef struct {
+	int n;
+	int* first;     // edges of v are first[v] .. first[v+1]-1
+	int* target;
+	int* weight;
+} graph;
+
+static graph* random_graph(int n, int degree, unsigned long long seed) {
+	graph* g = myMalloc(sizeof(graph));
+	g->n = n;
+	g->first = myMalloc((n + 1) * sizeof(int));
+	g->target = myMalloc((long long)n * degree * sizeof(int));
+	g->weight = myMalloc((long long)n * degree * sizeof(int));
+	int v, j;
+	for (v = 0; v <= n; v++) {
+		g->first[v] = v * degree;
+	}
+	for (v = 0; v < n; v++) {
+		for (j = 0; j < degree; j++) {
+			g->target[v * degree + j] = (int)(next_random(&seed) % n);
+			g->weight[v * degree + j] = 1 + (int)(next_random(&seed) % 1000);
+		}
+	}
+	return g;
+}
+
+static void free_graph(graph* g) {
+	free(g->first);
+	free(g->target);
+	free(g->weight);
+	free(g);
+}
+
+
+
+/*
+ * shortest paths from vertex 0, moving queued vertices forward with
+ * pq_decrease_key, against queueing a duplicate on every improvement and
+ * skipping the stale copies as they come out
+ */
+static void bench_dijkstra(int n) {
+	graph* g = random_graph(n, 8, 12345);
+	int* dist = myMalloc(n * sizeof(int));
+	int* handle = myMalloc(n * sizeof(int));
+	long long check[2] = {0, 0};
+	int run, v, e, priority;
+	for (run = 0; run < 2; run++) {
+		double start = now_seconds();
+		pqueue* pq = create_pqueue(0);
+		long long pops = 0;
+		for (v = 0; v < n; v++) {
+			dist[v] = 0x7FFFFFFF;
+			handle[v] = -1;
+		}
+		dist[0] = 0;
+		handle[0] = pq_insert(pq, 0, 0);
+		while (!pq_is_empty(pq)) {
+			pq_delete_min(pq, &priority, &v);
+			pops = pops + 1;
+			if (run == 0) {
+				handle[v] = -1;
+			} else if (priority > dist[v]) {
+				continue;	//a stale duplicate
+			}
+			for (e = g->first[v]; e < g->first[v + 1]; e++) {
+				int u = g->target[e];
+				int d = priority + g->weight[e];
+				if (d < dist[u]) {
+					dist[u] = d;
+					if (run == 1) {
+						pq_insert(pq, d, u);
+					} else if (handle[u] >= 0) {
+						pq_decrease_key(pq, handle[u], d);
+					} else {
+						handle[u] = pq_insert(pq, d, u);
+					}
+				}
+			}
+		}
+		for (v = 0; v < n; v++) {
+			check[run] += (dist[v] == 0x7FFFFFFF) ? 0 : dist[v];
+		}
+		printf("%-20s %10i vertices  %10lli pops  room %10i  %8.3f s\n",
+				(run == 0) ? "decrease_key" : "lazy duplicates", n, pops, pq->capacity, now_seconds() - start);
+		free_pqueue(pq);
+	}
+	if (check[0] != check[1]) {
+		printf("distances differ!\n");
+	}
+	free(dist);
+	free(handle);
+	free_graph(g);
+}
+
+
+
+/* what the threads of bench_multiqueue share */
+typedef struct {
+	multiqueue* mq;             // the queue under test, NULL for the locked binheap
+	binheap* h;                 // a single heap behind lock
+	pthread_mutex_t lock;
+	int ops;                    // delete_min and insert pairs per thread
+} mqbench;
+
+typedef struct {
+	mqbench* b;
+	unsigned long long seed;
+} mqworker;
+
+/* an event loop: take the next event and schedule a later one */
+static void* mq_worker(void* arg) {
+	mqworker* w = arg;
+	mqbench* b = w->b;
+	int i, key;
+	for (i = 0; i < b->ops; i++) {
+		int delay = (int)(next_random(&w->seed) & 0x3FF);
+		if (b->mq != NULL) {
+			if (mq_delete_min(b->mq, &key)) {
+				mq_insert(b->mq, key + delay);
+			}
+		} else {
+			pthread_mutex_lock(&b->lock);
+			key = delete_min(b->h);
+			insert(b->h, key + delay);
+			pthread_mutex_unlock(&b->lock);
+		}
+	}
+	return NULL;
+}
+
+
+
+/* number of keys below key in the Fenwick tree over 0..size-1 */
+static long long fenwick_below(const int* tree, int key) {
+	long long below = 0;
+	for (; key > 0; key -= key & -key) {
+		below += tree[key];
+	}
+	return below;
+}
+
+static void fenwick_add(int* tree, int size, int key, int delta) {
+	for (key = key + 1; key <= size; key += key & -key) {
+		tree[key] += delta;
+	}
+}
+
+
+
+/*
+ * throughput of an event loop on the multiqueue (2 heaps per thread)
+ * against one binheap behind a lock, from 1 to 64 threads, then the rank
+ * error of the multiqueue: how many smaller keys were left behind by each
+ * delete_min
+ */
+static void bench_multiqueue(int n) {
+	int threads;
+	mqbench b;
+	pthread_mutex_init(&b.lock, NULL);
+	for (threads = 1; threads <= 64; threads *= 2) {
+		int run, i;
+		for (run = 0; run < 2; run++) {
+			unsigned long long seed = 42;
+			b.mq = NULL;
+			b.h = NULL;
+			if (run == 0) {
+				b.h = create_binheap(n);
+			} else {
+				b.mq = create_multiqueue(threads, 2);
+			}
+			for (i = 0; i < n; i++) {
+				int key = (int)(next_random(&seed) & 0xFFFFF);
+				if (run == 0) {
+					insert(b.h, key);
+				} else {
+					mq_insert(b.mq, key);
+				}
+			}
+			b.ops = n / threads;
+			pthread_t* tids = myMalloc(threads * sizeof(pthread_t));
+			mqworker* workers = myMalloc(threads * sizeof(mqworker));
+			double start = now_seconds();
+			for (i = 0; i < threads; i++) {
+				workers[i].b = &b;
+				workers[i].seed = 1000 + i;
+				pthread_create(&tids[i], NULL, mq_worker, &workers[i]);
+			}
+			for (i = 0; i < threads; i++) {
+				pthread_join(tids[i], NULL);
+			}
+			double elapsed = now_seconds() - start;
+			printf("%-16s %3i threads %10i keys  %8.2f Mops/s\n", (run == 0) ? "locked binheap" : "multiqueue",
+					threads, n, 2.0 * b.ops * threads / elapsed / 1e6);
+			free(tids);
+			free(workers);
+			if (run == 0) {
+				free_binheap(b.h);
+			} else {
+				free_multiqueue(b.mq);
+			}
+		}
+	}
+	pthread_mutex_destroy(&b.lock);
+
+	int range = 1 << 22;
+	int* tree = myMalloc((range + 1) * sizeof(int));
+	for (threads = 1; threads <= 64; threads *= 2) {
+		unsigned long long seed = 7;
+		multiqueue* mq = create_multiqueue(threads, 2);
+		int i, key;
+		for (i = 0; i <= range; i++) {
+			tree[i] = 0;
+		}
+		for (i = 0; i < n; i++) {
+			key = (int)(next_random(&seed) % range);
+			mq_insert(mq, key);
+			fenwick_add(tree, range, key, 1);
+		}
+		long long total = 0;
+		long long worst = 0;
+		for (i = 0; i < n; i++) {
+			mq_delete_min(mq, &key);
+			long long error = fenwick_below(tree, key);
+			total += error;
+			worst = (error > worst) ? error : worst;
+			fenwick_add(tree, range, key, -1);
+			int next = key + (int)(next_random(&seed) % 4096);
+			next = (next < range) ? next : range - 1;
+			mq_insert(mq, next);
+			fenwick_add(tree, range, next, 1);
+		}
+		printf("multiqueue %3i heaps  rank error mean %8.2f  max %6lli\n", mq->num_heaps, (double)total / n, worst);
+		free_multiqueue(mq);
+	}
+	free(tree);
+}
+
+
+
+/* percolate_down as it was before the bottom-up delete, on a binary heap in arr[1..n] */
+static void baseline_percolate_down(int* arr, int n, int node_idx) {
+	int key = arr[node_idx];
+	int small_child;
+	if (node_idx * 2 > n) {
+		small_child = node_idx;
+	} else if (node_idx * 2 + 1 > n || arr[node_idx * 2] < arr[node_idx * 2 + 1]) {
+		small_child = node_idx * 2;
+	} else {
+		small_child = node_idx * 2 + 1;
+	}
+	while (key > arr[small_child] && small_child != 1) {
+		arr[node_idx] = arr[small_child];
+		node_idx = small_child;
+		if (node_idx * 2 > n) {
+			break;
+		} else if (node_idx * 2 + 1 > n || arr[node_idx * 2] < arr[node_idx * 2 + 1]) {
+			small_child = node_idx * 2;
+		} else {
+			small_child = node_idx * 2 + 1;
+		}
+	}
+	arr[node_idx] = key;
+}
+
+/* heap_sort as it was: build_heap, then delete_min into the freed slot, descending */
+static void baseline_heap_sort(int* arr, int n) {
+	int i;
+	for (i = n / 2; i > 0; i--) {
+		baseline_percolate_down(arr, n, i);
+	}
+	for (i = n; i > 0; i--) {
+		int root = arr[1];
+		arr[1] = arr[i];
+		baseline_percolate_down(arr, i - 1, 1);
+		arr[i] = root;
+	}
+}
+
+static int compare_ints(const void* a, const void* b) {
+	int x = *(const int*)a;
+	int y = *(const int*)b;
+	return (x > y) - (x < y);
+}
+
+
+
+/*
+ * heap_sort against the heap_sort it replaced and qsort, at sizes from
+ * 1K up to n by tens, small sizes repeated to add up to about n keys
+ */
+static void bench_sort(int n) {
+	int* keys = myMalloc(((long long)n + 1) * sizeof(int));
+	int* work = myMalloc(((long long)n + 1) * sizeof(int));
+	unsigned long long state = 99;
+	long long size;
+	int i;
+	for (i = 1; i <= n; i++) {
+		keys[i] = (int)next_random(&state);
+	}
+	for (size = 1000; size <= n; size *= 10) {
+		int repeat = (int)(n / size);
+		double times[3];
+		int method, r;
+		for (method = 0; method < 3; method++) {
+			double elapsed = 0;
+			for (r = 0; r < repeat; r++) {
+				for (i = 1; i <= size; i++) {
+					work[i] = keys[(long long)r * size + i];
+				}
+				double start = now_seconds();
+				if (method == 0) {
+					binheap h;	//a heap over the work array, heap_sort needs nothing else
+					h.cur_size = (int)size;
+					h.arr = work;
+					heap_sort(&h);
+				} else if (method == 1) {
+					baseline_heap_sort(work, (int)size);
+				} else {
+					qsort(work + 1, size, sizeof(int), compare_ints);
+				}
+				elapsed += now_seconds() - start;
+			}
+			times[method] = elapsed / repeat;
+		}
+		printf("%10lli keys  heap_sort %9.4f s  previous heap_sort %9.4f s  qsort %9.4f s\n",
+				size, times[0], times[1], times[2]);
+	}
+
+	binheap* h = create_binheap(n);	//delete_min, bottom-up against top-down
+	for (i = 1; i <= n; i++) {
+		work[i] = keys[i];
+	}
+	double start = now_seconds();
+	for (i = 1; i <= n; i++) {
+		insert(h, keys[i]);
+	}
+	double inserted = now_seconds();
+	while (!is_heap_empty(h)) {
+		delete_min(h);
+	}
+	double deleted = now_seconds();
+	int m = n;
+	for (i = m / 2; i > 0; i--) {
+		baseline_percolate_down(work, m, i);
+	}
+	double built = now_seconds();
+	while (m > 0) {
+		work[1] = work[m];
+		m = m - 1;
+		baseline_percolate_down(work, m, 1);
+	}
+	printf("%10i keys  delete_min %8.3f s  previous delete_min %8.3f s  (insert %.3f s)\n",
+			n, deleted - inserted, now_seconds() - built, inserted - start);
+	free_binheap(h);
+	free(keys);
+	free(work);
+}
+
+
+
+/*
+ * external sort of a file of n random keys in 16 MB, or an eighth of the
+ * data if that is less, with one thread and with one per core
+ */
+static void bench_extsort(int n) {
+	char dir[] = "/tmp/extsort_benchXXXXXX";
+	if (mkdtemp(dir) == NULL) {
+		printf("cannot create a directory in /tmp\n");
+		return;
+	}
+	char input[64], output[64];
+	snprintf(input, sizeof(input), "%s/input", dir);
+	snprintf(output, sizeof(output), "%s/output", dir);
+	FILE* f = fopen(input, "wb");
+	unsigned long long state = 5;
+	int i;
+	for (i = 0; i < n; i++) {
+		int key = (int)next_random(&state);
+		fwrite(&key, sizeof(int), 1, f);
+	}
+	fclose(f);
+	size_t memory = 16 << 20;
+	if ((size_t)n * sizeof(int) / 8 < memory) {
+		memory = (size_t)n * sizeof(int) / 8;
+	}
+	int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	int threads[2] = {1, (cores > 1) ? cores : 2};
+	int run;
+	for (run = 0; run < 2; run++) {
+		extsort_stats stats;
+		double start = now_seconds();
+		int ok = external_sort(input, output, dir, memory, threads[run], &stats);
+		printf("%3i threads %10lli keys %8.3f s  %5i runs  %i passes  read %8.1f MB  written %8.1f MB%s\n",
+				threads[run], stats.keys, now_seconds() - start, stats.runs, stats.merge_passes,
+				stats.bytes_read / 1e6, stats.bytes_written / 1e6, ok ? "" : "  FAILED");
+	}
+	remove(input);
+	remove(output);
+	rmdir(dir);
+}
+
+
+
+/*
+ * the 1000 largest of n random keys: inserting every key and draining,
+ * against topk_offer, topk_offer_batch and topk_parallel
+ */
+static void bench_topk(int n) {
+	int k = 1000;
+	int* keys = myMalloc((long long)n * sizeof(int));
+	unsigned long long state = 11;
+	int i;
+	for (i = 0; i < n; i++) {
+		keys[i] = (int)next_random(&state);
+	}
+	int* result = myMalloc(k * sizeof(int));
+
+	double start = now_seconds();
+	binheap* h = create_binheap(0);
+	for (i = 0; i < n; i++) {
+		insert(h, -keys[i]);	//a min-heap of negated keys drains largest first
+	}
+	for (i = 0; i < k && !is_heap_empty(h); i++) {
+		result[i] = -delete_min(h);
+	}
+	printf("%-22s %10i keys  k %5i  %8.3f s  %8lli bytes\n", "insert all and drain", n, k,
+			now_seconds() - start, (long long)h->max_size * (long long)sizeof(int));
+	free_binheap(h);
+
+	start = now_seconds();
+	topk* t = create_topk(k);
+	for (i = 0; i < n; i++) {
+		topk_offer(t, keys[i]);
+	}
+	topk_result(t, result);
+	printf("%-22s %10i keys  k %5i  %8.3f s  %8lli bytes\n", "topk_offer", n, k,
+			now_seconds() - start, (long long)t->heap->max_size * (long long)sizeof(int));
+	free_topk(t);
+
+	start = now_seconds();
+	t = create_topk(k);
+	topk_offer_batch(t, keys, n);
+	topk_result(t, result);
+	printf("%-22s %10i keys  k %5i  %8.3f s\n", "topk_offer_batch", n, k, now_seconds() - start);
+	free_topk(t);
+
+	int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	int threads = (cores > 1) ? cores : 4;
+	start = now_seconds();
+	t = topk_parallel(keys, n, k, threads);
+	topk_result(t, result);
+	printf("topk_parallel, %2i thr  %10i keys  k %5i  %8.3f s\n", threads, n, k, now_seconds() - start);
+	free_topk(t);
+	free(result);
+	free(keys);
+}
+
+
+
+/*
+ * a bounded priority buffer of 100000 keys serving the smallest key and
+ * evicting the largest when full: a min-max heap against two pqueues,
+ * one ordered each way, whose entries hold each other's handles
+ */
+static void bench_minmax(int n) {
+	int bound = 100000;
+	unsigned long long state = 3;
+	int i;
+	double start = now_seconds();
+	binheap* h = create_minmax_heap(bound);
+	long long check = 0;
+	for (i = 0; i < n; i++) {
+		if (h->cur_size == bound) {
+			check += mm_delete_max(h);
+		}
+		mm_insert(h, (int)(next_random(&state) & 0xFFFFFF));
+		if (i % 2 == 1) {
+			check -= mm_delete_min(h);
+		}
+	}
+	printf("%-20s %10i ops  %8.3f s  %10lli bytes  (check %lli)\n", "min-max heap", n, now_seconds() - start,
+			(long long)h->max_size * (long long)sizeof(int), check);
+	free_binheap(h);
+
+	state = 3;
+	start = now_seconds();
+	pqueue* low = create_pqueue(bound);	//smallest first, payload is the handle in high
+	pqueue* high = create_pqueue(bound);	//largest first by negated keys, payload is the handle in low
+	check = 0;
+	int key, other;
+	for (i = 0; i < n; i++) {
+		if (low->size == bound) {
+			pq_delete_min(high, &key, &other);
+			pq_remove(low, other);
+			check += -key;
+		}
+		key = (int)(next_random(&state) & 0xFFFFFF);
+		int lh = pq_insert(low, key, -1);
+		int hh = pq_insert(high, -key, lh);
+		low->entries[lh].payload = hh;
+		if (i % 2 == 1) {
+			pq_delete_min(low, &key, &other);
+			pq_remove(high, other);
+			check -= key;
+		}
+	}
+	long long bytes = (long long)(low->capacity + 1) * (sizeof(pqslot) + sizeof(pqentry)) * 2;
+	printf("%-20s %10i ops  %8.3f s  %10lli bytes  (check %lli)\n", "two linked pqueues", n, now_seconds() - start,
+			bytes, check);
+	free_pqueue(low);
+	free_pqueue(high);
+}
+
+
+
+/*
+ * shortest paths from vertex 0 with lazy duplicates, queued in a pqueue
+ * against a radix heap, whose keys only grow as Dijkstra's do; then the
+ * hold model of event simulation, 100000 pending times each replaced by
+ * a later one, in binheaps of arity 2 and 4 against a radix heap
+ */
+static void bench_radix(int n) {
+	graph* g = random_graph(n, 8, 12345);
+	int* dist = myMalloc(n * sizeof(int));
+	long long check[2] = {0, 0};
+	int run, v, e, priority;
+	for (run = 0; run < 2; run++) {
+		double start = now_seconds();
+		pqueue* pq = (run == 0) ? create_pqueue(0) : NULL;
+		radixheap* rh = (run == 1) ? create_radixheap() : NULL;
+		long long pops = 0;
+		for (v = 0; v < n; v++) {
+			dist[v] = 0x7FFFFFFF;
+		}
+		dist[0] = 0;
+		if (run == 0) {
+			pq_insert(pq, 0, 0);
+		} else {
+			rh_insert(rh, 0, 0);
+		}
+		while ((run == 0) ? !pq_is_empty(pq) : !rh_is_empty(rh)) {
+			if (run == 0) {
+				pq_delete_min(pq, &priority, &v);
+			} else {
+				priority = rh_delete_min(rh, &v);
+			}
+			pops = pops + 1;
+			if (priority > dist[v]) {
+				continue;	//a stale duplicate
+			}
+			for (e = g->first[v]; e < g->first[v + 1]; e++) {
+				int u = g->target[e];
+				int d = priority + g->weight[e];
+				if (d < dist[u]) {
+					dist[u] = d;
+					if (run == 0) {
+						pq_insert(pq, d, u);
+					} else {
+						rh_insert(rh, d, u);
+					}
+				}
+			}
+		}
+		for (v = 0; v < n; v++) {
+			check[run] += (dist[v] == 0x7FFFFFFF) ? 0 : dist[v];
+		}
+		printf("%-20s %10i vertices  %10lli pops  %8.3f s\n",
+				(run == 0) ? "dijkstra pqueue" : "dijkstra radix heap", n, pops, now_seconds() - start);
+		if (run == 0) {
+			free_pqueue(pq);
+		} else {
+			free_radixheap(rh);
+		}
+	}
+	if (check[0] != check[1]) {
+		printf("distances differ!\n");
+	}
+	free(dist);
+	free_graph(g);
+
+	int pending = 100000;
+	for (run = 0; run < 3; run++) {
+		unsigned long long state = 11;
+		double start = now_seconds();
+		binheap* h = (run < 2) ? create_dary_binheap(pending, (run == 0) ? 2 : 4) : NULL;
+		radixheap* rh = (run == 2) ? create_radixheap() : NULL;
+		long long sum = 0;
+		int i;
+		for (i = 0; i < pending; i++) {
+			int t = (int)(next_random(&state) % 100000);
+			if (run < 2) {
+				insert(h, t);
+			} else {
+				rh_insert(rh, t, i);
+			}
+		}
+		for (i = 0; i < n; i++) {
+			int t = (run < 2) ? delete_min(h) : rh_delete_min(rh, NULL);
+			sum += t;
+			t = t + 1 + (int)(next_random(&state) % 100000);
+			if (run < 2) {
+				insert(h, t);
+			} else {
+				rh_insert(rh, t, i);
+			}
+		}
+		printf("%-20s %10i holds  %8.3f s  (check %lli)\n",
+				(run == 0) ? "hold binheap" : (run == 1) ? "hold 4-ary binheap" : "hold radix heap", n,
+				now_seconds() - start, sum);
+		if (run < 2) {
+			free_binheap(h);
+		} else {
+			free_radixheap(rh);
+		}
+	}
+}
+
+
+
+/* what the timer wheel's callback in bench_timers needs */
+typedef struct {
+	timerwheel* tw;
+	int* handle;                // the timer of every connection
+	long long now;              // the time, in microseconds
+	long long timeout;
+	long long fired;
+} timeout_state;
+
+static void reschedule_idle(int handle, int payload, void* arg) {
+	timeout_state* s = arg;
+	(void)handle;
+	s->fired = s->fired + 1;	//the connection closes and a new one takes its place
+	s->handle[payload] = tw_schedule(s->tw, s->now + s->timeout, payload);
+}
+
+/*
+ * connection timeouts: 100000 connections with a 30 s idle timeout on a
+ * 1 ms clock, activity on a random connection every 60 us pushing its
+ * timeout back, so well over 99% of the timers are cancelled before they
+ * fire.  The pqueue removes and inserts, or raises the key in place,
+ * against cancel and schedule on a timer wheel.
+ */
+static void bench_timers(int n) {
+	int conns = 100000;
+	long long timeout = 30000000;
+	long long step = 60;
+	int* handle = myMalloc(conns * sizeof(int));
+	int run, i;
+	for (run = 0; run < 3; run++) {
+		unsigned long long state = 5;
+		double start = now_seconds();
+		timeout_state s;
+		s.handle = handle;
+		s.now = 0;
+		s.timeout = timeout;
+		s.fired = 0;
+		s.tw = (run == 2) ? create_timerwheel(1000, 0) : NULL;
+		pqueue* pq = (run < 2) ? create_pqueue(conns) : NULL;
+		for (i = 0; i < conns; i++) {
+			if (run < 2) {
+				handle[i] = pq_insert(pq, (int)((s.now + timeout + 999) / 1000), i);
+			} else {
+				handle[i] = tw_schedule(s.tw, s.now + timeout, i);
+			}
+		}
+		for (i = 0; i < n; i++) {
+			s.now = s.now + step;
+			int c = (int)(next_random(&state) % conns);
+			int due = (int)((s.now + timeout + 999) / 1000);
+			if (run == 0) {
+				pq_remove(pq, handle[c]);
+				handle[c] = pq_insert(pq, due, c);
+			} else if (run == 1) {
+				pq_increase_key(pq, handle[c], due);
+			} else {
+				tw_cancel(s.tw, handle[c]);
+				handle[c] = tw_schedule(s.tw, s.now + timeout, c);
+			}
+			if (run < 2) {
+				int priority, idle;
+				while (pq_find_min(pq, &priority, &idle) >= 0 && priority <= s.now / 1000) {
+					pq_delete_min(pq, NULL, NULL);
+					s.fired = s.fired + 1;
+					handle[idle] = pq_insert(pq, (int)((s.now + timeout + 999) / 1000), idle);
+				}
+			} else {
+				tw_advance(s.tw, s.now, reschedule_idle, &s);
+			}
+		}
+		printf("%-20s %10i touches  %8lli fired  %8.3f s\n",
+				(run == 0) ? "pqueue remove+insert" : (run == 1) ? "pqueue increase_key" : "timer wheel", n, s.fired,
+				now_seconds() - start);
+		if (run < 2) {
+			free_pqueue(pq);
+		} else {
+			free_timerwheel(s.tw);
+		}
+	}
+	free(handle);
+}
+
+
+
+int main(int argc, char** argv) {
+	const char* which = (argc > 1) ? argv[1] : "all";
+	int n = (argc > 2) ? atoi(argv[2]) : 1000000;
+	int all = (strcmp(which, "all") == 0);
+
+	if (all || strcmp(which, "grow") == 0) {
+		bench_grow(n);
+	}
+	if (all || strcmp(which, "dary") == 0) {
+		bench_dary(n);
+	}
+	if (all || strcmp(which, "dijkstra") == 0) {
+		bench_dijkstra(n);
+	}
+	if (all || strcmp(which, "multiqueue") == 0) {
+		bench_multiqueue(n);
+	}
+	if (all || strcmp(which, "sort") == 0) {
+		bench_sort(n);
+	}
+	if (all || strcmp(which, "extsort") == 0) {
+		bench_extsort(n);
+	}
+	if (all || strcmp(which, "topk") == 0) {
+		bench_topk(n);
+	}
+	if (all || strcmp(which, "minmax") == 0) {
+		bench_minmax(n);
+	}
+	if (all || strcmp(which, "radix") == 0) {
+		bench_radix(n);
+	}
+	if (all || strcmp(which, "timers") == 0) {
+		bench_timers(n);
+	}
+	return 0;
+}
+#endif
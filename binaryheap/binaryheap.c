@@ -1,29 +1,247 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
-#include "binheap.h"
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
 #include "utils.h"
+#include "binaryheap.h"
+
+#define PARENT(h, i) ((((i) - 2) >> (h)->shift) + 1)	// children of i are FIRST_CHILD(h, i) .. + arity - 1
+#define FIRST_CHILD(h, i) ((((long long)(i) - 1) << (h)->shift) + 2)	// past INT_MAX near the bottom of a big heap
+#define CLAMP(i, n) (((i) < (n)) ? (i) : (n))	// a prefetch index kept inside arr[0..n]
+
+#define MIN_HEAP_SIZE 4	// smallest room a heap is given
+#define MAX_ARITY 16		// a full sibling group still fits in one cache line
+#define HEAP_LINE 64		// cache line size arr is laid out for
+#define HEAP_PAD (HEAP_LINE / (int)sizeof(int) - 2)	// ints before arr[0] so that arr[2] starts a line
+
+/*
+ * gives the heap room for max_size keys, plus the unused slot 0.  The
+ * first sibling group starts at arr[2] and every group is arity keys
+ * long, so with arr[2] on a line boundary no group straddles two lines.
+ * realloc does not keep the alignment, so the keys are copied over.
+ */
+static void resize_binheap(binheap* h, int max_size) {
+	size_t bytes = ((size_t)HEAP_PAD + max_size + 1) * sizeof(int);
+	bytes = (bytes + HEAP_LINE - 1) / HEAP_LINE * HEAP_LINE;	//a multiple of the alignment, as aligned_alloc wants
+	int* mem = aligned_alloc(HEAP_LINE, bytes);
+	if (mem == NULL) {
+		fprintf(stderr, "Error allocating memory.\n");
+		exit(EXIT_FAILURE);
+	}
+	int* arr = mem + HEAP_PAD;
+	int keep = (h->cur_size < max_size) ? h->cur_size : max_size;
+	int i;
+	for (i = 1; i <= keep; i++) {
+		arr[i] = h->arr[i];
+	}
+	free(h->mem);
+	h->mem = mem;
+	h->arr = arr;
+	h->max_size = max_size;
+}
+
+
+
+/* index of the smallest of the count keys starting at first, without branches */
+static inline int min_of_group(const int* arr, int first, int count) {
+#if defined(__AVX2__)
+	if (count == 8) {
+		__m256i v = _mm256_load_si256((const __m256i*)(arr + first));
+		__m256i m = _mm256_min_epi32(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+		m = _mm256_min_epi32(m, _mm256_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+		m = _mm256_min_epi32(m, _mm256_permute2x128_si256(m, m, 1));
+		int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, m)));
+		return first + __builtin_ctz(mask);
+	}
+#endif
+#if defined(__SSE4_1__)
+	if (count == 4) {
+		__m128i v = _mm_load_si128((const __m128i*)(arr + first));
+		__m128i m = _mm_min_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+		m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, m)));
+		return first + __builtin_ctz(mask);
+	}
+#endif
+	int best = first;
+	int best_key = arr[first];
+	int i;
+	for (i = first + 1; i < first + count; i++) {	//the compiler turns these into conditional moves
+		int smaller = (arr[i] < best_key);
+		best = smaller ? i : best;
+		best_key = smaller ? arr[i] : best_key;
+	}
+	return best;
+}
+
+
+
+/* index of the smallest of the arity children starting at first, all of which exist */
+static inline int min_full_group(binheap* h, int first) {
+	switch (h->arity) {	//constant group sizes let the search unroll
+	case 2:
+		return first + (h->arr[first + 1] < h->arr[first]);
+	case 4:
+		return min_of_group(h->arr, first, 4);
+	case 8:
+		return min_of_group(h->arr, first, 8);
+	default:
+		return min_of_group(h->arr, first, h->arity);
+	}
+}
+
+
+
+/* index of the smallest child of node_idx, 0 if it has none */
+static inline int min_child(binheap* h, int node_idx) {
+	long long first = FIRST_CHILD(h, node_idx);
+	if (first > h->cur_size) {
+		return 0;
+	}
+	if (first + h->arity - 1 <= h->cur_size) {
+		return min_full_group(h, (int)first);
+	}
+	return min_of_group(h->arr, (int)first, h->cur_size - (int)first + 1);	//the last, partial group
+}
+
+
+
+/*
+ * moves the hole at node_idx down to a leaf, always into the smallest
+ * child, shifting that child up into the hole.  This compares children
+ * only, never the key that will fill the hole: that key came from the
+ * bottom of the heap and nearly always belongs back near the bottom, so
+ * comparing it on the way down would be wasted work and mispredicted
+ * branches.  Returns the leaf the hole ended at.
+ */
+static inline int sift_hole_down(binheap* h, int node_idx) {
+	int* arr = h->arr;	//locals, stores into arr could otherwise alias the fields of h
+	int n = h->cur_size;
+	int shift = h->shift;
+	int arity = h->arity;
+	long long first = (((long long)node_idx - 1) << shift) + 2;	//64-bit, children can be past INT_MAX
+	while (first + arity - 1 <= n) {	//full groups, no bounds checks inside
+		long long below = ((first - 1) << shift) + 2;	//children of the group, then grandchildren,
+		__builtin_prefetch(&arr[CLAMP(below, n)]);	//fetched before the compare picks one of them
+		__builtin_prefetch(&arr[CLAMP(((below - 1) << shift) + 2, n)]);
+		int child = min_full_group(h, (int)first);
+		arr[node_idx] = arr[child];
+		node_idx = child;
+		first = (((long long)node_idx - 1) << shift) + 2;
+	}
+	if (first <= n) {	//at most one partial group, at the end
+		int child = min_of_group(arr, (int)first, n - (int)first + 1);
+		arr[node_idx] = arr[child];
+		node_idx = child;
+	}
+	return node_idx;
+}
+
+
+
+/* moves the key at node_idx up while it is less than its parent, but no higher than top */
+static inline void sift_up_to(binheap* h, int node_idx, int top) {
+	int key = h->arr[node_idx];
+	while (node_idx > top && key < h->arr[PARENT(h, node_idx)]) {	//while key is less than parent...
+		int parent = PARENT(h, node_idx);
+		h->arr[node_idx] = h->arr[parent]; //copy parent to the child node
+		node_idx = parent;		//update index to be parent node
+	}
+	h->arr[node_idx] = key;	//copy key to the final node
+}
+
+
+
+/* percolates key down from the hole at node_idx, bottom-up: to a leaf, then back up to where key belongs */
+static inline void fill_hole(binheap* h, int node_idx, int key) {
+	int leaf = sift_hole_down(h, node_idx);
+	h->arr[leaf] = key;
+	sift_up_to(h, leaf, node_idx);
+}
+
+
+
+/*
+ * puts key in the hole at i of the max-heap arr[1..n] that heap_sort
+ * builds, bottom-up like fill_hole
+ */
+static inline void fill_hole_max(int* arr, int i, int n, int key) {
+	int top = i;
+	long long child = 2LL * i;	//64-bit, as in sift_hole_down
+	while (child < n) {
+		__builtin_prefetch(&arr[CLAMP(4 * child, n)]);	//grandchildren of both, as in sift_hole_down
+		__builtin_prefetch(&arr[CLAMP(8 * child, n)]);
+		child += (arr[child + 1] > arr[child]);
+		arr[i] = arr[child];
+		i = (int)child;
+		child = 2LL * i;
+	}
+	if (child == n) {	//an only child
+		arr[i] = arr[n];
+		i = n;
+	}
+	while (i > top && arr[i / 2] < key) {
+		arr[i] = arr[i / 2];
+		i = i / 2;
+	}
+	arr[i] = key;
+}
+
 
-#define PARENT(i) i/2
-#define LCHILD(i) 2*i
-#define RCHILD(i) 2*i+1
 
 /**********************************************************
  * Functions for the binheap
  ***********************************************************/
 
 binheap* create_binheap(int max_size) {
+	return create_dary_binheap(max_size, 2);
+}
+
+
+
+binheap* create_dary_binheap(int max_size, int arity) {
+	if (arity < 2 || arity > MAX_ARITY || (arity & (arity - 1)) != 0) {
+		fprintf(stderr, "create_dary_binheap: arity must be 2, 4, 8 or 16, got %i\n", arity);
+		exit(EXIT_FAILURE);
+	}
     binheap* bh = myMalloc(sizeof(binheap));
-	bh->max_size = max_size;
+	if (max_size < MIN_HEAP_SIZE) {
+		max_size = MIN_HEAP_SIZE;
+	}
 	bh->cur_size = 0;
-	int* array = myMalloc(max_size * sizeof(int));
-	bh->arr = array;
+	bh->min_size = max_size;
+	bh->auto_shrink = FALSE;
+	bh->arity = arity;
+	bh->shift = __builtin_ctz(arity);
+	bh->mem = NULL;
+	bh->arr = NULL;
+	resize_binheap(bh, max_size);
 	return bh;
 }
 
 
 
+void reserve_binheap(binheap* h, int max_size) {
+	if (max_size > h->max_size) {
+		resize_binheap(h, max_size);
+	}
+}
+
+
+
+void shrink_binheap(binheap* h) {
+	int max_size = (h->cur_size > h->min_size) ? h->cur_size : h->min_size;
+	if (max_size < h->max_size) {
+		resize_binheap(h, max_size);
+	}
+}
+
+
+
 void free_binheap(binheap* h) {
+	free(h->mem);
     free(h);
 }
 
@@ -40,52 +258,34 @@ int is_heap_empty(binheap* h) {
 
 
 int insert(binheap* h, int key) {
-	if (h->cur_size != h->max_size) {
-		h->cur_size = h->cur_size + 1;
-		h->arr[h->cur_size] = key;
-		percolate_up(h, h->cur_size);
-		return 1;
-	} else {
-		return 0;
+	if (h->cur_size == h->max_size) {	//doubling keeps the copying amortized O(1) per insert
+		if (h->max_size == MAX_HEAP_SIZE) {
+			fprintf(stderr, "insert: the heap is full at %i keys\n", MAX_HEAP_SIZE);
+			exit(EXIT_FAILURE);
+		}
+		resize_binheap(h, (h->max_size < MAX_HEAP_SIZE / 2) ? h->max_size * 2 : MAX_HEAP_SIZE);
 	}
+	h->cur_size = h->cur_size + 1;
+	h->arr[h->cur_size] = key;
+	percolate_up(h, h->cur_size);
+	return 1;
 }
 
 
 
 void percolate_up(binheap* h, int node_idx) {
-	int key = h->arr[node_idx];
-	while (node_idx/2 != 0 && key < h->arr[node_idx/2]) {	//while key is less than parent...
-		h->arr[node_idx] = h->arr[node_idx/2]; //copy parent to the child node
-		node_idx = node_idx/2;		//update index to be parent node
-	}
-	h->arr[node_idx] = key;	//copy key to the final node
+	sift_up_to(h, node_idx, 1);
 }
 
 
 
 void percolate_down(binheap* h, int node_idx) {
 	int key = h->arr[node_idx];	//store key to percolate
-	int small_child = 0;
-	
-	if (node_idx*2 > h->cur_size) { //if left child doesn't exist
-		small_child = node_idx;	//no canidate
-	} else if (((node_idx*2 + 1) > h->cur_size) || (h->arr[node_idx*2] < h->arr[node_idx*2 + 1])) { //if left child is only child or is smaller than right child
-		small_child = node_idx*2;	//left child is swap canidate
-	} else {
-		small_child = node_idx*2 + 1;	//right child is swap canidate
-	}
-	
-	while (key > h->arr[small_child] && small_child != 1) {	//while key is larger than smallest child...
+	int small_child = min_child(h, node_idx);
+	while (small_child != 0 && key > h->arr[small_child]) {	//while key is larger than smallest child...
 		h->arr[node_idx] = h->arr[small_child]; //copy small child to parent node
 		node_idx = small_child;		//update index to be small child node
-	
-		if (node_idx*2 > h->cur_size) { //find new small child
-			break;
-		} else if (((node_idx*2 + 1) > h->cur_size) || (h->arr[node_idx*2] < h->arr[node_idx*2 + 1])) {
-			small_child = node_idx*2;
-		} else {
-			small_child = node_idx*2 + 1;
-		}
+		small_child = min_child(h, node_idx);
 	}
 	h->arr[node_idx] = key;	//copy key to the final node
 }
@@ -97,10 +297,16 @@ int delete_min(binheap* h) {
 		return -1;
 	} else {
 		int root = h->arr[1];
-		h->arr[1] = h->arr[h->cur_size];	//so the last key is percolated down from root
+		int last = h->arr[h->cur_size];	//the last key is percolated down from root
 		h->cur_size = h->cur_size - 1;
-		percolate_down(h, 1);	
+		if (h->cur_size > 0) {
+			fill_hole(h, 1, last);
+		}
 		h->arr[h->cur_size + 1] = 0;
+		if (h->auto_shrink && h->cur_size < h->max_size / 4 && h->max_size > h->min_size) {
+			int half = h->max_size / 2;	//halving at a quarter leaves room to grow without thrashing
+			resize_binheap(h, (half > h->min_size) ? half : h->min_size);
+		}
 		return root;
 	}	
 }
@@ -108,26 +314,27 @@ int delete_min(binheap* h) {
 
 
 void build_heap(binheap* h) {
-	printf("Building Heap\n");
 	int size = h->cur_size;
-	int i = size / 2;
-	for (i = (size / 2); i > 0; i--) {
-		percolate_down(h, i);
+	int i;
+	for (i = (size > 1) ? PARENT(h, size) : 0; i > 0; i--) {	//Floyd: heapify the subtrees from the bottom up
+		fill_hole(h, i, h->arr[i]);
 	}
 }
 
 
 
 void heap_sort(binheap* h) {
-	build_heap(h);
-	printf("Sorting Heap\n");
+	int* arr = h->arr;
 	int size = h->cur_size;
-	int i = size;	
-	for (i = size; i > 0; i--) {
-		int root = delete_min(h);
-		h->arr[i] = root;
+	int i;
+	for (i = size / 2; i > 0; i--) {	//a max-heap, so each largest key can go straight to the end
+		fill_hole_max(arr, i, size, arr[i]);
+	}
+	for (i = size; i > 1; i--) {
+		int key = arr[i];
+		arr[i] = arr[1];
+		fill_hole_max(arr, 1, i - 1, key);
 	}
-	h->cur_size = size;
 }
 
 
@@ -311,32 +518,147 @@ int main(void) {
 	
     heap_sort(h);
     
-    // Verify that the build_heap function
-    // operates as expected
-    assert(h->arr[1] == 97);
-    assert(h->arr[2] == 63);
-    assert(h->arr[3] == 61);
-    assert(h->arr[4] == 55);
-    assert(h->arr[5] == 43);
-    assert(h->arr[6] == 37);
-    assert(h->arr[7] == 27);
-    assert(h->arr[8] == 22);
-    assert(h->arr[9] == 19);
-    assert(h->arr[10] == 17);
-    assert(h->arr[11] == 14);
-    assert(h->arr[12] == 13);    
-    assert(h->arr[13] == 9);
-    assert(h->arr[14] == 7);
-    assert(h->arr[15] == 3);
-    assert(h->arr[16] == 2);
-    assert(h->arr[17] == 1);
-    assert(h->arr[18] == 0);
+    // Verify that the heap_sort function
+    // sorts in ascending order
+    assert(h->arr[1] == 0);
+    assert(h->arr[2] == 1);
+    assert(h->arr[3] == 2);
+    assert(h->arr[4] == 3);
+    assert(h->arr[5] == 7);
+    assert(h->arr[6] == 9);
+    assert(h->arr[7] == 13);
+    assert(h->arr[8] == 14);
+    assert(h->arr[9] == 17);
+    assert(h->arr[10] == 19);
+    assert(h->arr[11] == 22);
+    assert(h->arr[12] == 27);
+    assert(h->arr[13] == 37);
+    assert(h->arr[14] == 43);
+    assert(h->arr[15] == 55);
+    assert(h->arr[16] == 61);
+    assert(h->arr[17] == 63);
+    assert(h->arr[18] == 97);
 
     free_binheap(h);
     ////////////////////////////////////////////
     // Done testing heap_sort function
     ////////////////////////////////////////////
 
+
+    ////////////////////////////////////////////
+    // Test growing and shrinking
+    ////////////////////////////////////////////
+    h = create_binheap(0);
+    assert(h->max_size == 4);
+    int i;
+    for (i = 1000; i > 0; i--) {
+        assert(insert(h, i) == 1);
+    }
+    assert(h->cur_size == 1000);
+    assert(h->max_size == 1024);
+    for (i = 1; i <= 500; i++) {
+        assert(delete_min(h) == i);
+    }
+    assert(h->max_size == 1024);	//no shrinking unless asked
+    shrink_binheap(h);
+    assert(h->max_size == 500);
+    h->auto_shrink = TRUE;
+    for (i = 501; i <= 900; i++) {
+        assert(delete_min(h) == i);
+    }
+    assert(h->max_size < 500 && h->max_size >= h->cur_size);
+    while (!is_heap_empty(h)) {
+        delete_min(h);
+    }
+    assert(h->max_size == 4);
+    reserve_binheap(h, 5000);
+    assert(h->max_size == 5000);
+    reserve_binheap(h, 10);
+    assert(h->max_size == 5000);
+    for (i = 0; i < 5000; i++) {
+        insert(h, i % 7);
+    }
+    assert(h->max_size == 5000);	//reserved room is used before growing
+    free_binheap(h);
+    ////////////////////////////////////////////
+    // Done testing growing and shrinking
+    ////////////////////////////////////////////
+
+
+    ////////////////////////////////////////////
+    // Test the d-ary layouts
+    ////////////////////////////////////////////
+    int arity;
+    for (arity = 4; arity <= 16; arity *= 2) {
+        h = create_dary_binheap(0, arity);
+        assert(((size_t)&h->arr[2] % 64) == 0);	//sibling groups start on a cache line
+        for (i = 0; i < 5000; i++) {
+            insert(h, (int)((long long)i * 7919 % 5000));
+        }
+        assert(((size_t)&h->arr[2] % 64) == 0);	//still after growing
+        int j;
+        for (j = 2; j <= h->cur_size; j++) {
+            assert(h->arr[(j - 2) / arity + 1] <= h->arr[j]);
+        }
+        for (i = 0; i < 2500; i++) {
+            assert(delete_min(h) == i);
+        }
+        for (i = 0; i < 100; i++) {	//reinsert some of the deleted keys
+            insert(h, i * 25);
+        }
+        for (i = 0; i < 100; i++) {
+            assert(delete_min(h) == i * 25);
+        }
+        for (i = 2500; i < 5000; i++) {
+            assert(delete_min(h) == i);
+        }
+        assert(is_heap_empty(h));
+        free_binheap(h);
+
+        h = create_dary_binheap(100, arity);
+        int keys[18] = {17, 22, 19, 55, 7, 43, 14, 97, 63, 61, 3, 2, 1, 13, 27, 37, 9, 0};
+        for (i = 0; i < 18; i++) {
+            h->arr[i + 1] = keys[i];
+        }
+        h->cur_size = 18;
+        heap_sort(h);
+        for (i = 1; i < 18; i++) {
+            assert(h->arr[i] < h->arr[i + 1]);
+        }
+        assert(h->arr[1] == 0 && h->arr[18] == 97);
+        assert(delete_min(h) == 0 && delete_min(h) == 1);	//still a heap
+        free_binheap(h);
+    }
+    ////////////////////////////////////////////
+    // Done testing the d-ary layouts
+    ////////////////////////////////////////////
+
+
+    ////////////////////////////////////////////
+    // Test heap_sort and build_heap at every size
+    ////////////////////////////////////////////
+    int size;
+    for (size = 0; size <= 300; size++) {
+        h = create_dary_binheap(size, (size % 2 == 0) ? 2 : 8);
+        for (i = 1; i <= size; i++) {
+            h->arr[i] = (int)((long long)i * 7919 % 37);	//plenty of duplicates
+        }
+        h->cur_size = size;
+        build_heap(h);
+        for (i = 2; i <= size; i++) {
+            assert(h->arr[(i - 2) / h->arity + 1] <= h->arr[i]);
+        }
+        heap_sort(h);
+        for (i = 2; i <= size; i++) {
+            assert(h->arr[i - 1] <= h->arr[i]);
+        }
+        assert(h->cur_size == size);
+        free_binheap(h);
+    }
+    ////////////////////////////////////////////
+    // Done testing heap_sort and build_heap
+    ////////////////////////////////////////////
+
     
     return 0;
 }
@@ -1,12 +1,30 @@
 #ifndef _binheap_h
 #define _binheap_h
 
+#include <limits.h>
 
-/* struct defining the heap */
+#define MAX_HEAP_SIZE (INT_MAX - 64)	// the most keys a heap holds, arr's padding and slot 0 still indexed by int
+
+
+/*
+ * struct defining the heap.  The keys live in arr[1..cur_size], slot 0 is
+ * unused.  Each node has arity children, those of node i being
+ * arity*(i-1)+2 .. arity*i+1, so with the default arity of 2 the parent of
+ * i is i/2.  A wider heap is shallower, and arr is aligned so that every
+ * group of siblings sits in a single cache line: a percolate_down step
+ * costs one cache miss whatever the arity.  arr doubles whenever it fills,
+ * so inserts cost amortized O(1) copying, and with auto_shrink set it
+ * halves again once a quarter full.
+ */
 typedef struct binheap_struct {
-    int cur_size;   // the current size of the heap
-    int max_size;   // the maximum size of the heap
-    int* arr;       // an integer array in which to store keys
+    int cur_size;     // the current size of the heap
+    int max_size;     // the number of keys arr currently has room for
+    int min_size;     // max_size never shrinks below this, the size asked for at creation
+    int auto_shrink;  // TRUE to give memory back as the heap empties, FALSE by default
+    int arity;        // children per node: 2, 4, 8 or 16
+    int shift;        // log2 of arity
+    int* arr;         // an integer array in which to store keys
+    int* mem;         // the allocation holding arr, arr starts a little way in for alignment
 } binheap;
 
 
@@ -16,11 +34,38 @@ typedef struct binheap_struct {
 
 /**
  * Creates and initializes a binheap. 
- * @param max_size - the maximum number of keys that can be inserted into the binheap
+ * @param max_size - the number of keys to make room for up front, the heap
+ *        grows past it as needed
  * @return a pointer to the newly created binheap
  **/
 binheap* create_binheap(int max_size);
 
+/**
+ * Creates and initializes a d-ary heap, a binheap whose nodes have arity
+ * children.  Deleting the minimum scans arity children per level over
+ * log base arity levels, so 4 or 8 trades a few compares for far fewer
+ * cache misses on large heaps.  All the binheap functions work on it.
+ * @param max_size - the number of keys to make room for up front, the heap
+ *        grows past it as needed
+ * @param arity - the number of children per node: 2, 4, 8 or 16
+ * @return a pointer to the newly created heap
+ **/
+binheap* create_dary_binheap(int max_size, int arity);
+
+/**
+ * Makes sure the binheap can hold at least max_size keys without growing
+ * @param h - a pointer to the binheap
+ * @param max_size - the number of keys to make room for
+ **/
+void reserve_binheap(binheap* h, int max_size);
+
+/**
+ * Releases the room the binheap has beyond its keys, down to the size it
+ * was created with
+ * @param h - a pointer to the binheap to shrink
+ **/
+void shrink_binheap(binheap* h);
+
 /**
  * Frees all the memory for the specified binheap
  * @param h - a pointer to the binheap to be freed
@@ -35,11 +80,11 @@ void free_binheap(binheap* h);
 int is_heap_empty(binheap* h);
 
 /**
- * Inserts a new key into the binary heap. Duplicate nodes ARE
- * allowed in the binheap.
+ * Inserts a new key into the binary heap, doubling its room if it is
+ * full. Duplicate nodes ARE allowed in the binheap.
  * @param h - a pointer to the binheap in which to insert the key
  * @param key - the key value to insert into the binheap
- * @return 1 if key was successfully inserted, 0 otherwise
+ * @return 1 as the key is always inserted
  **/
 int insert(binheap* h, int key);
 
@@ -54,8 +99,8 @@ void percolate_up(binheap* h, int node_idx);
 
 /**
  * Percolates a node down the binary heap. A node is continually 
- * swapped with the lesser of its two children if the smaller of 
- * its two children has a key value less than that of the node
+ * swapped with the least of its children if the smallest of 
+ * its children has a key value less than that of the node
  * @param h - a pointer to the binheap with the node to percolate
  * @param node_idx - the array index of the node in the heap that 
  *        is to be percolated
@@ -63,7 +108,11 @@ void percolate_up(binheap* h, int node_idx);
 void percolate_down(binheap* h, int node_idx);
                   
 /**
- * Deletes the minimum element from the provided binheap (the root)
+ * Deletes the minimum element from the provided binheap (the root).
+ * The hole left at the root is moved down to a leaf through the smallest
+ * children and the last key is percolated up from there, which takes
+ * about half the compares of percolating it down from the root.
+ * With auto_shrink set, halves the room once the heap is a quarter full.
  * @param h - a pointer to the binheap from which to delete the minimum
  * @return the key values of the minimum element that was deleted. If 
  *         no node is deleted (the binheap is emepty) then return -1
@@ -73,13 +122,15 @@ int delete_min(binheap* h);
 /**
  * Given a heap struct that is not necessarily in heap-order, this
  * function will heapify the input such that heap-order is restored.
+ * It runs in O(n), sifting each subtree from the bottom up (Floyd).
  * @param h - a pointer to the binheap to heapify
  **/
 void build_heap(binheap* h);
 
 /**
  * Given a heap struct that is not necessarily in heap-order, this
- * function will perform a heap_sort.
+ * function will sort arr[1..cur_size] into ascending order in place.
+ * A sorted array is in heap-order, so h is still a valid heap after.
  * @param h - a pointer to the binheap to sort
  **/
 void heap_sort(binheap* h);
@@ -0,0 +1,486 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <assert.h>
+#include "utils.h"
+#include "binaryheap.h"
+#include "pqueue.h"
+#include "extsort.h"
+
+#define MIN_MEMORY (64 * 1024)	// memory below this is raised to it
+
+
+/* struct defining a file read or written through a buffer of its own */
+typedef struct stream_struct {
+    FILE* file;          // the open file
+    int* buf;            // the buffer
+    int cap;             // ints buf has room for
+    int len;             // ints in buf, for a reader
+    int pos;             // next int to read, or ints written so far
+    long long bytes;     // bytes moved through the file so far
+} stream;
+
+
+/* struct defining the work shared by the threads generating runs */
+typedef struct rungen_struct {
+    FILE* in;                // the input, read one chunk at a time under lock
+    pthread_mutex_t lock;    // guards everything below
+    const char* tmp_dir;     // where runs go
+    int chunk;               // ints per chunk
+    char** runs;             // paths of the runs written so far
+    int num_runs;
+    int cap_runs;            // room in runs
+    long long keys;          // keys read
+    long long bytes_read;
+    long long bytes_written;
+    int failed;              // TRUE once a run could not be written
+} rungen;
+
+
+
+/* bytes of buffer per stream, shrunk from EXT_IO_BUFFER until at least 16 fit in memory */
+static size_t stream_buffer(size_t memory) {
+	size_t buf = EXT_IO_BUFFER;
+	while (buf > EXT_MIN_BUFFER && memory / buf < 16) {
+		buf = buf / 2;
+	}
+	return buf;
+}
+
+
+
+/* opens a stream on path with mode "rb" or "wb", FALSE if the file cannot be opened */
+static int open_stream(stream* s, const char* path, const char* mode, size_t buf_bytes) {
+	s->file = fopen(path, mode);
+	if (s->file == NULL) {
+		return FALSE;
+	}
+	s->cap = (int)(buf_bytes / sizeof(int));
+	s->buf = myMalloc(s->cap * sizeof(int));
+	s->len = 0;
+	s->pos = 0;
+	s->bytes = 0;
+	return TRUE;
+}
+
+
+
+/* reads the next key, FALSE at the end of the file */
+static inline int read_key(stream* s, int* key) {
+	if (s->pos == s->len) {
+		s->len = (int)fread(s->buf, sizeof(int), s->cap, s->file);
+		s->pos = 0;
+		s->bytes += (long long)s->len * sizeof(int);
+		if (s->len == 0) {
+			return FALSE;
+		}
+	}
+	*key = s->buf[s->pos];
+	s->pos = s->pos + 1;
+	return TRUE;
+}
+
+
+
+/* writes out the buffer of a writing stream, FALSE if the write failed */
+static int flush_stream(stream* s) {
+	size_t written = fwrite(s->buf, sizeof(int), s->pos, s->file);
+	s->bytes += (long long)written * sizeof(int);
+	int ok = (written == (size_t)s->pos);
+	s->pos = 0;
+	return ok;
+}
+
+
+
+/* appends a key to a writing stream, FALSE if a write failed */
+static inline int write_key(stream* s, int key) {
+	if (s->pos == s->cap && !flush_stream(s)) {
+		return FALSE;
+	}
+	s->buf[s->pos] = key;
+	s->pos = s->pos + 1;
+	return TRUE;
+}
+
+
+
+/* closes a stream, flushing it if writing; FALSE if that failed */
+static int close_stream(stream* s, int writing) {
+	int ok = TRUE;
+	if (writing) {
+		ok = flush_stream(s);
+	}
+	if (fclose(s->file) != 0) {
+		ok = FALSE;
+	}
+	free(s->buf);
+	return ok;
+}
+
+
+
+/* a new path for a run in tmp_dir, unique within the process */
+static char* new_run_path(const char* tmp_dir) {
+	static atomic_int next_run = 0;
+	size_t size = strlen(tmp_dir) + 64;
+	char* path = myMalloc(size);
+	snprintf(path, size, "%s/extsort-%ld-%d.run", tmp_dir, (long)getpid(), atomic_fetch_add(&next_run, 1));
+	return path;
+}
+
+
+
+/*
+ * merges num_inputs sorted files into output through a pqueue of the
+ * current key of each input: write the smallest, then replace it with the
+ * next key of the same input, which can only be larger
+ */
+static int merge_files(char** inputs, int num_inputs, const char* output, size_t buf_bytes, extsort_stats* stats) {
+	stream* in = myMalloc(num_inputs * sizeof(stream));
+	stream out;
+	pqueue* pq = create_pqueue(num_inputs);
+	int out_open = open_stream(&out, output, "wb", buf_bytes);
+	int ok = out_open;
+	int opened = 0;
+	int i, key;
+	for (i = 0; ok && i < num_inputs; i++) {
+		ok = open_stream(&in[i], inputs[i], "rb", buf_bytes);
+		if (ok) {
+			opened = opened + 1;
+			if (read_key(&in[i], &key)) {
+				pq_insert(pq, key, i);
+			}
+		}
+	}
+	long long keys = 0;
+	while (ok && !pq_is_empty(pq)) {
+		int source;
+		int handle = pq_find_min(pq, &key, &source);
+		ok = write_key(&out, key);
+		keys = keys + 1;
+		if (read_key(&in[source], &key)) {
+			pq_increase_key(pq, handle, key);	//sifts down from the root, no delete and insert
+		} else {
+			pq_remove(pq, handle);
+		}
+	}
+	for (i = 0; i < opened; i++) {
+		stats->bytes_read += in[i].bytes;
+		close_stream(&in[i], FALSE);
+	}
+	if (out_open) {
+		ok = close_stream(&out, TRUE) && ok;
+		stats->bytes_written += out.bytes;
+	}
+	stats->keys = keys;
+	free_pqueue(pq);
+	free(in);
+	return ok;
+}
+
+
+
+/*
+ * merges runs into output, first merging groups of runs into longer runs
+ * while there are more than fit in memory.  Runs flagged in temp are
+ * removed once merged, and so are their paths.
+ */
+static int merge_all(char** runs, int* temp, int num_runs, const char* output, const char* tmp_dir,
+		size_t memory, extsort_stats* stats) {
+	size_t buf_bytes = stream_buffer(memory);
+	int fan_in = (int)(memory / buf_bytes) - 1;	//one buffer is the output's
+	if (fan_in < 2) {
+		fan_in = 2;
+	}
+	int ok = TRUE;
+	int i;
+	while (ok && num_runs > fan_in) {
+		int merged = 0;
+		int first;
+		for (first = 0; first < num_runs; first += fan_in) {
+			int group = (num_runs - first < fan_in) ? num_runs - first : fan_in;
+			if (group == 1) {	//a lone run waits for the next pass
+				runs[merged] = runs[first];
+				temp[merged] = temp[first];
+			} else {
+				char* path = new_run_path(tmp_dir);
+				ok = ok && merge_files(runs + first, group, path, buf_bytes, stats);
+				for (i = first; i < first + group; i++) {
+					if (temp[i]) {
+						remove(runs[i]);
+						free(runs[i]);
+					}
+				}
+				runs[merged] = path;
+				temp[merged] = TRUE;
+			}
+			merged = merged + 1;
+		}
+		num_runs = merged;
+		stats->merge_passes = stats->merge_passes + 1;
+	}
+	ok = ok && merge_files(runs, num_runs, output, buf_bytes, stats);
+	stats->merge_passes = stats->merge_passes + 1;
+	for (i = 0; i < num_runs; i++) {
+		if (temp[i]) {
+			remove(runs[i]);
+			free(runs[i]);
+		}
+	}
+	return ok;
+}
+
+
+
+/* reads chunks, sorts each in place with heap_sort and writes it as a run */
+static void* generate_runs(void* arg) {
+	rungen* g = arg;
+	binheap* h = create_binheap(g->chunk);
+	for (;;) {
+		pthread_mutex_lock(&g->lock);
+		int n = g->failed ? 0 : (int)fread(&h->arr[1], sizeof(int), g->chunk, g->in);
+		g->keys += n;
+		g->bytes_read += (long long)n * sizeof(int);
+		pthread_mutex_unlock(&g->lock);
+		if (n == 0) {
+			break;
+		}
+		h->cur_size = n;
+		heap_sort(h);
+		char* path = new_run_path(g->tmp_dir);
+		FILE* run = fopen(path, "wb");
+		int ok = (run != NULL && fwrite(&h->arr[1], sizeof(int), n, run) == (size_t)n);
+		if (run != NULL && fclose(run) != 0) {
+			ok = FALSE;
+		}
+		pthread_mutex_lock(&g->lock);
+		if (g->num_runs == g->cap_runs) {
+			g->cap_runs = 2 * g->cap_runs;
+			g->runs = myRealloc(g->runs, g->cap_runs * sizeof(char*));
+		}
+		g->runs[g->num_runs] = path;	//recorded even when failed, so it is removed
+		g->num_runs = g->num_runs + 1;
+		g->bytes_written += ok ? (long long)n * sizeof(int) : 0;
+		g->failed = g->failed || !ok;
+		pthread_mutex_unlock(&g->lock);
+	}
+	free_binheap(h);
+	return NULL;
+}
+
+
+
+/**********************************************************
+ * Functions for external sorting
+ ***********************************************************/
+
+int external_sort(const char* input, const char* output, const char* tmp_dir, size_t memory,
+		int num_threads, extsort_stats* stats) {
+	extsort_stats local;
+	if (stats == NULL) {
+		stats = &local;
+	}
+	memset(stats, 0, sizeof(extsort_stats));
+	if (memory < MIN_MEMORY) {
+		memory = MIN_MEMORY;
+	}
+	if (num_threads < 1) {
+		num_threads = 1;
+	}
+	rungen g;
+	g.in = fopen(input, "rb");
+	if (g.in == NULL) {
+		return FALSE;
+	}
+	pthread_mutex_init(&g.lock, NULL);
+	g.tmp_dir = tmp_dir;
+	size_t chunk = memory / num_threads / sizeof(int);	//every thread holds one chunk
+	g.chunk = (chunk < MAX_HEAP_SIZE) ? (int)chunk : MAX_HEAP_SIZE;
+	g.cap_runs = 16;
+	g.runs = myMalloc(g.cap_runs * sizeof(char*));
+	g.num_runs = 0;
+	g.keys = 0;
+	g.bytes_read = 0;
+	g.bytes_written = 0;
+	g.failed = FALSE;
+	pthread_t* threads = myMalloc(num_threads * sizeof(pthread_t));
+	int i;
+	for (i = 0; i < num_threads; i++) {
+		pthread_create(&threads[i], NULL, generate_runs, &g);
+	}
+	for (i = 0; i < num_threads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	free(threads);
+	fclose(g.in);
+	pthread_mutex_destroy(&g.lock);
+	stats->runs = g.num_runs;
+	stats->bytes_read = g.bytes_read;
+	stats->bytes_written = g.bytes_written;
+
+	int* temp = myMalloc((g.num_runs + 1) * sizeof(int));
+	for (i = 0; i < g.num_runs; i++) {
+		temp[i] = TRUE;
+	}
+	int ok;
+	if (g.failed) {
+		for (i = 0; i < g.num_runs; i++) {
+			remove(g.runs[i]);
+			free(g.runs[i]);
+		}
+		ok = FALSE;
+	} else {
+		ok = merge_all(g.runs, temp, g.num_runs, output, tmp_dir, memory, stats);
+	}
+	free(temp);
+	free(g.runs);
+	return ok;
+}
+
+
+
+int merge_sorted_files(const char** inputs, int num_inputs, const char* output, const char* tmp_dir,
+		size_t memory, extsort_stats* stats) {
+	extsort_stats local;
+	if (stats == NULL) {
+		stats = &local;
+	}
+	memset(stats, 0, sizeof(extsort_stats));
+	if (memory < MIN_MEMORY) {
+		memory = MIN_MEMORY;
+	}
+	char** runs = myMalloc((num_inputs + 1) * sizeof(char*));
+	int* temp = myMalloc((num_inputs + 1) * sizeof(int));
+	int i;
+	for (i = 0; i < num_inputs; i++) {
+		runs[i] = (char*)inputs[i];	//never written or removed, temp is FALSE
+		temp[i] = FALSE;
+	}
+	int ok = merge_all(runs, temp, num_inputs, output, tmp_dir, memory, stats);
+	free(runs);
+	free(temp);
+	return ok;
+}
+
+
+
+/**********************************************************
+ * The following main function is for debugging the
+ * external sort.  Supply the DEBUG_EXTSORT flag to the
+ * compiler to compile it with this main function.
+ ***********************************************************/
+#ifdef DEBUG_EXTSORT
+
+static int compare_ints(const void* a, const void* b) {
+	int x = *(const int*)a;
+	int y = *(const int*)b;
+	return (x > y) - (x < y);
+}
+
+/* writes keys to path */
+static void write_file(const char* path, const int* keys, int n) {
+	FILE* f = fopen(path, "wb");
+	assert(f != NULL);
+	assert(fwrite(keys, sizeof(int), n, f) == (size_t)n);
+	fclose(f);
+}
+
+/* checks that path holds exactly the n keys of expect */
+static void check_file(const char* path, const int* expect, int n) {
+	FILE* f = fopen(path, "rb");
+	assert(f != NULL);
+	int* got = myMalloc((n + 1) * sizeof(int));
+	assert(fread(got, sizeof(int), n + 1, f) == (size_t)n);
+	fclose(f);
+	assert(memcmp(got, expect, n * sizeof(int)) == 0);
+	free(got);
+}
+
+int main(void) {
+	printf("=========================\n");
+	printf("Debugging External Sort\n");
+	printf("=========================\n");
+
+	char dir[] = "/tmp/extsortXXXXXX";
+	assert(mkdtemp(dir) != NULL);
+	char input[64], output[64];
+	snprintf(input, sizeof(input), "%s/input", dir);
+	snprintf(output, sizeof(output), "%s/output", dir);
+
+	int n = 1000000;
+	int* keys = myMalloc(n * sizeof(int));
+	int i;
+	unsigned int x = 12345;
+	for (i = 0; i < n; i++) {
+		x = x * 1103515245 + 12345;
+		keys[i] = (int)(x >> 1) - (1 << 30);	//negatives too
+		if (i % 10 == 0) {
+			keys[i] = 7;	//and plenty of duplicates
+		}
+	}
+	write_file(input, keys, n);
+	qsort(keys, n, sizeof(int), compare_ints);
+
+	// room for one pass of merging
+	extsort_stats stats;
+	assert(external_sort(input, output, dir, 1 << 20, 2, &stats) == TRUE);
+	check_file(output, keys, n);
+	printf("%lli keys, %i runs, %i merge passes, %lli bytes read, %lli bytes written\n",
+			stats.keys, stats.runs, stats.merge_passes, stats.bytes_read, stats.bytes_written);
+	assert(stats.keys == n && stats.runs == 8 && stats.merge_passes == 1);
+	assert(stats.bytes_read == 2LL * n * (long long)sizeof(int) && stats.bytes_written == stats.bytes_read);
+
+	// so little memory the runs are merged in several passes
+	assert(external_sort(input, output, dir, 64 * 1024, 3, &stats) == TRUE);
+	check_file(output, keys, n);
+	printf("%lli keys, %i runs, %i merge passes, %lli bytes read, %lli bytes written\n",
+			stats.keys, stats.runs, stats.merge_passes, stats.bytes_read, stats.bytes_written);
+	assert(stats.runs == 184 && stats.merge_passes == 2);	//184 runs of 5461 keys, 13 runs of 15, then the output
+
+	// merging sorted files directly, one of them empty
+	const char* parts[3];
+	char part_paths[3][64];
+	for (i = 0; i < 3; i++) {
+		snprintf(part_paths[i], sizeof(part_paths[i]), "%s/part%i", dir, i);
+		parts[i] = part_paths[i];
+	}
+	int* part = myMalloc(n * sizeof(int));
+	int counts[3] = {0, 0, 0};
+	for (i = 0; i < n; i++) {	//deal the sorted keys out to the first two files
+		int which = (keys[i] % 3 == 0) ? 0 : 1;
+		part[which * (n / 2) + counts[which]] = keys[i];
+		counts[which] = counts[which] + 1;
+		if (counts[which] == n / 2) {
+			break;
+		}
+	}
+	int total = counts[0] + counts[1];
+	write_file(parts[0], part, counts[0]);
+	write_file(parts[1], part + n / 2, counts[1]);
+	write_file(parts[2], part, 0);
+	assert(merge_sorted_files(parts, 3, output, dir, 1 << 20, &stats) == TRUE);
+	assert(stats.keys == total && stats.runs == 0 && stats.merge_passes == 1);
+	check_file(output, keys, total);
+
+	// empty input and missing input
+	write_file(input, keys, 0);
+	assert(external_sort(input, output, dir, 1 << 20, 2, &stats) == TRUE);
+	assert(stats.keys == 0);
+	check_file(output, keys, 0);
+	remove(input);
+	assert(external_sort(input, output, dir, 1 << 20, 2, &stats) == FALSE);
+
+	for (i = 0; i < 3; i++) {
+		remove(parts[i]);
+	}
+	remove(output);
+	assert(rmdir(dir) == 0);	//no run was left behind
+	free(part);
+	free(keys);
+	return 0;
+}
+#endif
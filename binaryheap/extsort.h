@@ -0,0 +1,62 @@
+#ifndef _extsort_h
+#define _extsort_h
+
+#include <stddef.h>
+
+#define EXT_IO_BUFFER (1 << 20)   // bytes per run buffer when memory allows
+#define EXT_MIN_BUFFER 4096       // smallest run buffer, used when memory is tight
+
+
+/* struct defining what an external sort or merge did, its I/O in particular */
+typedef struct extsort_stats_struct {
+    long long keys;            // keys in the output
+    int runs;                  // sorted runs written by run generation
+    int merge_passes;          // merges over the whole data set, the final one included
+    long long bytes_read;      // bytes read from the input, runs and inputs of the merge
+    long long bytes_written;   // bytes written to runs and the output
+} extsort_stats;
+
+
+
+/**********************************************************
+ * function prototypes
+ ***********************************************************/
+
+/**
+ * Sorts a file of native ints into ascending order, using at most about
+ * memory bytes however large the file is.  The input is read in chunks
+ * that fit in memory, each of which is sorted in place by heap_sort and
+ * written out as a run, with num_threads threads each working on its
+ * own chunk.  The runs are then merged by a k-way merge driven by a
+ * pqueue, reading every run through its own sequential buffer.  When
+ * there are more runs than buffers fit in memory, groups of runs are
+ * first merged into longer runs.  Runs are temporary files in tmp_dir,
+ * removed once merged.
+ * @param input - the file to sort
+ * @param output - the file to write, may not be input
+ * @param tmp_dir - directory for the runs
+ * @param memory - bytes of memory to use, at least 64 KB are used
+ * @param num_threads - the number of threads sorting chunks
+ * @param stats - filled in with what was done, may be NULL
+ * @return TRUE on success, FALSE if a file could not be opened or written
+ **/
+int external_sort(const char* input, const char* output, const char* tmp_dir, size_t memory,
+        int num_threads, extsort_stats* stats);
+
+/**
+ * Merges files of native ints that are each in ascending order into
+ * one ascending file, using about memory bytes whatever the number of
+ * inputs, in several passes if need be.
+ * @param inputs - the sorted files
+ * @param num_inputs - the number of sorted files
+ * @param output - the file to write, may not be one of the inputs
+ * @param tmp_dir - directory for intermediate runs when more than one pass is needed
+ * @param memory - bytes of memory to use, at least 64 KB are used
+ * @param stats - filled in with what was done, may be NULL
+ * @return TRUE on success, FALSE if a file could not be opened or written
+ **/
+int merge_sorted_files(const char** inputs, int num_inputs, const char* output, const char* tmp_dir,
+        size_t memory, extsort_stats* stats);
+
+
+#endif
@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "utils.h"
+#include "minmaxheap.h"
+
+/* TRUE for the min levels 0, 2, 4 ..., where i is the smallest of its subtree */
+#define IS_MIN_LEVEL(i) (((31 - __builtin_clz(i)) & 1) == 0)
+
+
+/*
+ * moves the key at i up through its grandparents, which are on the same
+ * kind of level: toward the root while smaller on a min level, while
+ * larger on a max level
+ */
+static void push_up_same(int* arr, int i, int min_level) {
+	int key = arr[i];
+	while (i > 3 && (min_level ? key < arr[i / 4] : key > arr[i / 4])) {
+		arr[i] = arr[i / 4];
+		i = i / 4;
+	}
+	arr[i] = key;
+}
+
+
+
+/* restores order after a key was placed at the leaf i */
+static void push_up(int* arr, int i) {
+	if (i == 1) {
+		return;
+	}
+	int parent = i / 2;
+	int min_level = IS_MIN_LEVEL(i);
+	if (min_level ? arr[i] > arr[parent] : arr[i] < arr[parent]) {	//belongs on the parent's kind of level
+		int key = arr[i];
+		arr[i] = arr[parent];
+		arr[parent] = key;
+		push_up_same(arr, parent, !min_level);
+	} else {
+		push_up_same(arr, i, min_level);
+	}
+}
+
+
+
+/*
+ * restores order below i after its key changed: the key sinks to the
+ * smallest (on a min level, largest on a max level) of the children and
+ * grandchildren of i, two levels a step, and swaps with its parent on
+ * the way if that is on the other kind of level and out of order
+ */
+static void push_down(int* arr, int n, int i) {
+	int min_level = IS_MIN_LEVEL(i);
+	for (;;) {
+		int first = 2 * i;
+		if (first > n) {
+			return;
+		}
+		int best = first;	//the best of up to 2 children and 4 grandchildren
+		int last = (first + 1 <= n) ? first + 1 : n;
+		int j;
+		for (j = first + 1; j <= last; j++) {
+			best = (min_level ? arr[j] < arr[best] : arr[j] > arr[best]) ? j : best;
+		}
+		int grand_last = (4 * i + 3 <= n) ? 4 * i + 3 : n;
+		for (j = 4 * i; j <= grand_last; j++) {
+			best = (min_level ? arr[j] < arr[best] : arr[j] > arr[best]) ? j : best;
+		}
+		if (!(min_level ? arr[best] < arr[i] : arr[best] > arr[i])) {
+			return;
+		}
+		int key = arr[i];
+		arr[i] = arr[best];
+		arr[best] = key;
+		if (best <= last) {	//a child, which has no children to push on to
+			return;
+		}
+		int parent = best / 2;
+		if (min_level ? arr[best] > arr[parent] : arr[best] < arr[parent]) {
+			key = arr[best];
+			arr[best] = arr[parent];
+			arr[parent] = key;
+		}
+		i = best;
+	}
+}
+
+
+
+/* index of the largest key, the heap has keys */
+static inline int max_index(binheap* h) {
+	if (h->cur_size == 1) {
+		return 1;
+	}
+	if (h->cur_size == 2) {
+		return 2;
+	}
+	return (h->arr[3] > h->arr[2]) ? 3 : 2;
+}
+
+
+
+/**********************************************************
+ * Functions for the min-max heap
+ ***********************************************************/
+
+binheap* create_minmax_heap(int max_size) {
+	return create_binheap(max_size);
+}
+
+
+
+void mm_insert(binheap* h, int key) {
+	if (h->cur_size == h->max_size) {	//doubling keeps the copying amortized O(1) per insert
+		reserve_binheap(h, h->max_size * 2);
+	}
+	h->cur_size = h->cur_size + 1;
+	h->arr[h->cur_size] = key;
+	push_up(h->arr, h->cur_size);
+}
+
+
+
+int mm_find_min(binheap* h) {
+	return is_heap_empty(h) ? -1 : h->arr[1];
+}
+
+
+
+int mm_find_max(binheap* h) {
+	return is_heap_empty(h) ? -1 : h->arr[max_index(h)];
+}
+
+
+
+int mm_delete_min(binheap* h) {
+	if (is_heap_empty(h)) {
+		return -1;
+	}
+	int min = h->arr[1];
+	h->arr[1] = h->arr[h->cur_size];
+	h->cur_size = h->cur_size - 1;
+	push_down(h->arr, h->cur_size, 1);
+	return min;
+}
+
+
+
+int mm_delete_max(binheap* h) {
+	if (is_heap_empty(h)) {
+		return -1;
+	}
+	int i = max_index(h);
+	int max = h->arr[i];
+	h->arr[i] = h->arr[h->cur_size];
+	h->cur_size = h->cur_size - 1;
+	if (i <= h->cur_size) {
+		push_down(h->arr, h->cur_size, i);
+	}
+	return max;
+}
+
+
+
+void build_minmax_heap(binheap* h) {
+	int i;
+	for (i = h->cur_size / 2; i > 0; i--) {
+		push_down(h->arr, h->cur_size, i);
+	}
+}
+
+
+
+/**********************************************************
+ * The following main function is for debugging the
+ * min-max heap.  Supply the DEBUG_MINMAXHEAP flag to the
+ * compiler to compile it with this main function.
+ ***********************************************************/
+#ifdef DEBUG_MINMAXHEAP
+
+/* checks that every key is within the bounds its min and max ancestors set */
+static void check_minmax(binheap* h) {
+	int i;
+	for (i = 2; i <= h->cur_size; i++) {
+		int a;
+		for (a = i / 2; a >= 1; a = a / 2) {
+			if (IS_MIN_LEVEL(a)) {
+				assert(h->arr[a] <= h->arr[i]);
+			} else {
+				assert(h->arr[a] >= h->arr[i]);
+			}
+		}
+	}
+}
+
+int main(void) {
+	printf("======================\n");
+	printf("Debugging Min-Max Heap\n");
+	printf("======================\n");
+
+	binheap* h = create_minmax_heap(0);
+	assert(mm_find_min(h) == -1 && mm_find_max(h) == -1);
+	assert(mm_delete_min(h) == -1 && mm_delete_max(h) == -1);
+	int keys[9] = {40, 10, 70, 20, 90, 30, 60, 80, 50};
+	int i;
+	for (i = 0; i < 9; i++) {
+		mm_insert(h, keys[i]);
+		check_minmax(h);
+	}
+	assert(mm_find_min(h) == 10 && mm_find_max(h) == 90);
+	print_binheap(h);
+	assert(mm_delete_max(h) == 90 && mm_delete_max(h) == 80);
+	assert(mm_delete_min(h) == 10 && mm_delete_min(h) == 20);
+	check_minmax(h);
+	assert(mm_find_min(h) == 30 && mm_find_max(h) == 70);
+	while (h->cur_size > 1) {
+		mm_delete_max(h);
+	}
+	assert(mm_find_min(h) == 30 && mm_find_max(h) == 30);
+	assert(mm_delete_max(h) == 30 && is_heap_empty(h));
+	free_binheap(h);
+
+	// both ends against a sorted reference, with duplicates
+	h = create_minmax_heap(0);
+	int n = 3000;
+	int* count = calloc(1000, sizeof(int));
+	int lo = 0, hi = 999;
+	int size = 0;
+	for (i = 0; i < n; i++) {
+		int key = (int)((long long)i * 7919 % 1000);
+		mm_insert(h, key);
+		count[key] = count[key] + 1;
+		size = size + 1;
+		if (i % 3 == 2) {	//take one from each end every third insert
+			while (count[lo] == 0) {
+				lo = lo + 1;
+			}
+			assert(mm_delete_min(h) == lo);
+			count[lo] = count[lo] - 1;
+			while (count[hi] == 0) {
+				hi = hi - 1;
+			}
+			assert(mm_delete_max(h) == hi);
+			count[hi] = count[hi] - 1;
+			size = size - 2;
+			lo = 0;	//later inserts may go below
+			hi = 999;
+		}
+	}
+	assert(h->cur_size == size);
+	check_minmax(h);
+	free(count);
+	free_binheap(h);
+
+	// build from an arbitrary array, every size
+	for (size = 0; size <= 200; size++) {
+		h = create_minmax_heap(size);
+		for (i = 1; i <= size; i++) {
+			h->arr[i] = (int)((long long)i * 7919 % 101);
+		}
+		h->cur_size = size;
+		build_minmax_heap(h);
+		check_minmax(h);
+		int last = -1;
+		while (!is_heap_empty(h)) {
+			int key = mm_delete_min(h);
+			assert(key >= last);
+			last = key;
+		}
+		free_binheap(h);
+	}
+	return 0;
+}
+#endif
@@ -0,0 +1,74 @@
+#ifndef _minmaxheap_h
+#define _minmaxheap_h
+
+#include "binaryheap.h"
+
+
+/*
+ * A min-max heap is a binheap whose levels alternate: a key on an even
+ * level (the root is level 0) is the smallest of its subtree, a key on an
+ * odd level the largest.  The smallest key is then the root and the
+ * largest one of its two children, so both ends of the queue are served
+ * from one array of keys.  It uses the binheap struct and storage as they
+ * are, arr[1..cur_size] growing by doubling, but must only be changed
+ * through the functions below, never insert or delete_min.
+ */
+
+
+
+/**********************************************************
+ * function prototypes
+ ***********************************************************/
+
+/**
+ * Creates and initializes an empty min-max heap
+ * @param max_size - the number of keys to make room for up front, the heap
+ *        grows past it as needed
+ * @return a pointer to the new heap, freed with free_binheap
+ **/
+binheap* create_minmax_heap(int max_size);
+
+/**
+ * Inserts a key.  Duplicate keys are allowed.
+ * @param h - a pointer to the min-max heap
+ * @param key - the key
+ **/
+void mm_insert(binheap* h, int key);
+
+/**
+ * Gives the smallest key
+ * @param h - a pointer to the min-max heap
+ * @return the smallest key, -1 if the heap is empty
+ **/
+int mm_find_min(binheap* h);
+
+/**
+ * Gives the largest key
+ * @param h - a pointer to the min-max heap
+ * @return the largest key, -1 if the heap is empty
+ **/
+int mm_find_max(binheap* h);
+
+/**
+ * Deletes the smallest key
+ * @param h - a pointer to the min-max heap
+ * @return the key deleted, -1 if the heap is empty
+ **/
+int mm_delete_min(binheap* h);
+
+/**
+ * Deletes the largest key
+ * @param h - a pointer to the min-max heap
+ * @return the key deleted, -1 if the heap is empty
+ **/
+int mm_delete_max(binheap* h);
+
+/**
+ * Given a binary heap struct that is not necessarily in min-max order,
+ * this function reorders arr[1..cur_size] into a min-max heap in O(n).
+ * @param h - a pointer to a binheap with arity 2
+ **/
+void build_minmax_heap(binheap* h);
+
+
+#endif
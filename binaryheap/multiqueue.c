@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <assert.h>
+#include "utils.h"
+#include "multiqueue.h"
+
+#define MQ_TRIES 8	// random picks before delete_min looks at every heap
+
+
+/* xorshift64*, one generator per thread so picking a heap touches no shared state */
+static __thread uint64_t mq_rng = 0;
+
+static inline uint32_t mq_random(void) {
+	uint64_t x = mq_rng;
+	if (x == 0) {	//first use on this thread
+		static atomic_ullong seeds = 0;
+		x = (atomic_fetch_add(&seeds, 1) + 1) * 0x9E3779B97F4A7C15ULL ^ (uint64_t)time(NULL);
+	}
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	mq_rng = x;
+	return (uint32_t)((x * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+
+
+/* a random heap, without the bias of % for heap counts that are not powers of two */
+static inline int random_heap(multiqueue* mq) {
+	return (int)(((uint64_t)mq_random() * (uint64_t)mq->num_heaps) >> 32);
+}
+
+
+
+/* publishes the new smallest key of a heap, the caller holds its lock */
+static inline void update_top(mqheap* q) {
+	int top = is_heap_empty(q->heap) ? MQ_EMPTY : q->heap->arr[1];
+	atomic_store_explicit(&q->top, top, memory_order_relaxed);
+}
+
+
+
+/* deletes the smallest key of heap q if it has one, the caller holds its lock */
+static inline int take_min(mqheap* q, int* key) {
+	if (is_heap_empty(q->heap)) {
+		return FALSE;
+	}
+	*key = delete_min(q->heap);
+	update_top(q);
+	return TRUE;
+}
+
+
+
+/**********************************************************
+ * Functions for the multiqueue
+ ***********************************************************/
+
+multiqueue* create_multiqueue(int num_threads, int heaps_per_thread) {
+	multiqueue* mq = myMalloc(sizeof(multiqueue));
+	if (num_threads < 1) {
+		num_threads = 1;
+	}
+	if (heaps_per_thread < 1) {
+		heaps_per_thread = 1;
+	}
+	mq->num_heaps = num_threads * heaps_per_thread;
+	if (mq->num_heaps < 2) {	//delete_min picks two
+		mq->num_heaps = 2;
+	}
+	mq->heaps = aligned_alloc(sizeof(mqheap), mq->num_heaps * sizeof(mqheap));
+	if (mq->heaps == NULL) {
+		fprintf(stderr, "Error allocating memory.\n");
+		exit(EXIT_FAILURE);
+	}
+	int i;
+	for (i = 0; i < mq->num_heaps; i++) {
+		pthread_mutex_init(&mq->heaps[i].lock, NULL);
+		atomic_init(&mq->heaps[i].top, MQ_EMPTY);
+		mq->heaps[i].heap = create_dary_binheap(0, MQ_ARITY);
+	}
+	return mq;
+}
+
+
+
+void free_multiqueue(multiqueue* mq) {
+	int i;
+	for (i = 0; i < mq->num_heaps; i++) {
+		pthread_mutex_destroy(&mq->heaps[i].lock);
+		free_binheap(mq->heaps[i].heap);
+	}
+	free(mq->heaps);
+	free(mq);
+}
+
+
+
+void mq_insert(multiqueue* mq, int key) {
+	mqheap* q;
+	int tries = 0;
+	for (;;) {	//a busy heap is as good as any other, try a different one
+		q = &mq->heaps[random_heap(mq)];
+		if (pthread_mutex_trylock(&q->lock) == 0) {
+			break;
+		}
+		tries = tries + 1;
+		if (tries == MQ_TRIES) {
+			pthread_mutex_lock(&q->lock);
+			break;
+		}
+	}
+	insert(q->heap, key);
+	if (key < atomic_load_explicit(&q->top, memory_order_relaxed)) {
+		atomic_store_explicit(&q->top, key, memory_order_relaxed);
+	}
+	pthread_mutex_unlock(&q->lock);
+}
+
+
+
+int mq_delete_min(multiqueue* mq, int* key) {
+	int tries;
+	for (tries = 0; tries < MQ_TRIES; tries++) {
+		int i = random_heap(mq);
+		int j = random_heap(mq);
+		if (i == j) {
+			j = (j + 1 < mq->num_heaps) ? j + 1 : 0;
+		}
+		int top_i = atomic_load_explicit(&mq->heaps[i].top, memory_order_relaxed);
+		int top_j = atomic_load_explicit(&mq->heaps[j].top, memory_order_relaxed);
+		if (top_i == MQ_EMPTY && top_j == MQ_EMPTY) {
+			continue;
+		}
+		mqheap* q = &mq->heaps[(top_j < top_i) ? j : i];
+		if (pthread_mutex_trylock(&q->lock) != 0) {
+			continue;	//another thread is on it, pick again
+		}
+		int found = take_min(q, key);	//the heap may have emptied since its top was read
+		pthread_mutex_unlock(&q->lock);
+		if (found) {
+			return TRUE;
+		}
+	}
+	int i;
+	for (i = 0; i < mq->num_heaps; i++) {	//few keys left, or heavy contention: look everywhere
+		mqheap* q = &mq->heaps[i];
+		if (atomic_load_explicit(&q->top, memory_order_relaxed) == MQ_EMPTY) {
+			continue;
+		}
+		pthread_mutex_lock(&q->lock);
+		int found = take_min(q, key);
+		pthread_mutex_unlock(&q->lock);
+		if (found) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+
+
+int mq_size(multiqueue* mq) {
+	int size = 0;
+	int i;
+	for (i = 0; i < mq->num_heaps; i++) {
+		pthread_mutex_lock(&mq->heaps[i].lock);
+		size = size + mq->heaps[i].heap->cur_size;
+		pthread_mutex_unlock(&mq->heaps[i].lock);
+	}
+	return size;
+}
+
+
+
+/**********************************************************
+ * The following main function is for debugging the
+ * multiqueue.  Supply the DEBUG_MULTIQUEUE flag to the
+ * compiler to compile it with this main function.
+ ***********************************************************/
+#ifdef DEBUG_MULTIQUEUE
+
+#define DEBUG_THREADS 4
+#define DEBUG_KEYS 20000	// per thread
+
+static multiqueue* shared;
+static atomic_int seen[DEBUG_THREADS * DEBUG_KEYS];
+
+/* inserts its own keys, then deletes as many keys as it inserted */
+static void* worker(void* arg) {
+	int id = (int)(intptr_t)arg;
+	int i, key;
+	for (i = 0; i < DEBUG_KEYS; i++) {
+		mq_insert(shared, id * DEBUG_KEYS + i);
+		if (i % 2 == 1 && mq_delete_min(shared, &key)) {
+			atomic_fetch_add(&seen[key], 1);
+		}
+	}
+	for (i = 0; i < DEBUG_KEYS / 2; i++) {
+		if (mq_delete_min(shared, &key)) {
+			atomic_fetch_add(&seen[key], 1);
+		}
+	}
+	return NULL;
+}
+
+
+
+int main(void) {
+	printf("====================\n");
+	printf("Debugging MultiQueue\n");
+	printf("====================\n");
+
+	// one thread: every key comes out, roughly in order
+	multiqueue* mq = create_multiqueue(4, 2);
+	assert(mq->num_heaps == 8);
+	int key;
+	assert(mq_delete_min(mq, &key) == FALSE);
+	int i;
+	for (i = 0; i < 10000; i++) {
+		mq_insert(mq, (int)((long long)i * 7919 % 10000));
+	}
+	assert(mq_size(mq) == 10000);
+	int* out = myMalloc(10000 * sizeof(int));
+	long long error = 0;
+	for (i = 0; i < 10000; i++) {
+		assert(mq_delete_min(mq, &out[i]) == TRUE);
+		error += (out[i] > i) ? out[i] - i : i - out[i];	//how far from its place in sorted order
+	}
+	assert(mq_delete_min(mq, &key) == FALSE);
+	assert(mq_size(mq) == 0);
+	printf("mean displacement with %i heaps: %.2f\n", mq->num_heaps, (double)error / 10000);
+	assert(error / 10000 < 4 * mq->num_heaps);
+	int* count = calloc(10000, sizeof(int));
+	for (i = 0; i < 10000; i++) {
+		count[out[i]] = count[out[i]] + 1;
+	}
+	for (i = 0; i < 10000; i++) {
+		assert(count[i] == 1);
+	}
+	free(count);
+	free(out);
+	free_multiqueue(mq);
+
+	// several threads: no key lost or deleted twice
+	shared = create_multiqueue(DEBUG_THREADS, 2);
+	pthread_t threads[DEBUG_THREADS];
+	for (i = 0; i < DEBUG_THREADS; i++) {
+		pthread_create(&threads[i], NULL, worker, (void*)(intptr_t)i);
+	}
+	for (i = 0; i < DEBUG_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	int left = mq_size(shared);
+	while (mq_delete_min(shared, &key)) {
+		atomic_fetch_add(&seen[key], 1);
+		left = left - 1;
+	}
+	assert(left == 0);
+	for (i = 0; i < DEBUG_THREADS * DEBUG_KEYS; i++) {
+		assert(atomic_load(&seen[i]) == 1);
+	}
+	free_multiqueue(shared);
+
+	return 0;
+}
+#endif
@@ -0,0 +1,87 @@
+#ifndef _multiqueue_h
+#define _multiqueue_h
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "binaryheap.h"
+
+#define MQ_EMPTY INT_MAX   // top of a heap with no keys
+#define MQ_ARITY 4         // arity of the heaps, see create_dary_binheap
+
+
+/*
+ * struct defining one heap of a multiqueue.  top mirrors the heap's
+ * smallest key so other threads can compare heaps without taking the
+ * lock.  Each heap fills whole cache lines, so threads working on
+ * different heaps never write to the same line.
+ */
+typedef struct mqheap_struct {
+    pthread_mutex_t lock;   // guards heap
+    atomic_int top;         // the smallest key in heap, MQ_EMPTY when it is empty
+    binheap* heap;          // the keys
+} __attribute__((aligned(64))) mqheap;
+
+
+/*
+ * struct defining a multiqueue: a relaxed concurrent priority queue made
+ * of many independently locked heaps.  An insert goes to a random heap and
+ * a delete takes the smaller top of two random heaps, so threads rarely
+ * meet on a lock and the work spreads evenly.  The price is ordering:
+ * delete_min returns one of the smallest keys rather than the smallest,
+ * with a rank error that stays small on average, about the number of
+ * heaps, and does not grow with the number of keys.
+ */
+typedef struct multiqueue_struct {
+    int num_heaps;     // number of heaps
+    mqheap* heaps;     // the heaps
+} multiqueue;
+
+
+
+/**********************************************************
+ * function prototypes
+ ***********************************************************/
+
+/**
+ * Creates and initializes a multiqueue.  Good values are 2 to 4 heaps
+ * per thread.
+ * @param num_threads - the number of threads that will use it
+ * @param heaps_per_thread - the number of heaps for each thread, at least 1
+ * @return a pointer to the newly created multiqueue
+ **/
+multiqueue* create_multiqueue(int num_threads, int heaps_per_thread);
+
+/**
+ * Frees all the memory for the multiqueue.  No thread may be using it.
+ * @param mq - a pointer to the multiqueue to be freed
+ **/
+void free_multiqueue(multiqueue* mq);
+
+/**
+ * Inserts a key.  Safe to call from any number of threads. Duplicate
+ * keys are allowed.
+ * @param mq - a pointer to the multiqueue
+ * @param key - the key to insert, less than MQ_EMPTY
+ **/
+void mq_insert(multiqueue* mq, int key);
+
+/**
+ * Deletes one of the smallest keys.  Safe to call from any number of
+ * threads.
+ * @param mq - a pointer to the multiqueue
+ * @param key - set to the deleted key
+ * @return TRUE if a key was deleted, FALSE if every heap was found empty
+ **/
+int mq_delete_min(multiqueue* mq, int* key);
+
+/**
+ * Counts the keys.  Exact only while no other thread is changing the
+ * multiqueue.
+ * @param mq - a pointer to the multiqueue
+ * @return the number of keys
+ **/
+int mq_size(multiqueue* mq);
+
+
+#endif
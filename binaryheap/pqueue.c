@@ -0,0 +1,353 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "utils.h"
+#include "pqueue.h"
+
+#define MIN_PQUEUE_SIZE 4	// smallest room a queue is given
+
+/* gives the queue room for capacity entries, plus the unused heap slot 0 */
+static void resize_pqueue(pqueue* pq, int capacity) {
+	pq->heap = myRealloc(pq->heap, (capacity + 1) * sizeof(pqslot));
+	pq->entries = myRealloc(pq->entries, capacity * sizeof(pqentry));
+	pq->capacity = capacity;
+}
+
+
+
+/* puts slot at heap index i and tells its entry where it is */
+static inline void place(pqueue* pq, int i, pqslot slot) {
+	pq->heap[i] = slot;
+	pq->entries[slot.handle].pos = i;
+}
+
+
+
+/* moves the slot at i toward the root while it is smaller than its parent */
+static void sift_up(pqueue* pq, int i) {
+	pqslot slot = pq->heap[i];
+	while (i > 1 && slot.priority < pq->heap[i / 2].priority) {
+		place(pq, i, pq->heap[i / 2]);
+		i = i / 2;
+	}
+	place(pq, i, slot);
+}
+
+
+
+/* moves the slot at i toward the leaves while a child is smaller */
+static void sift_down(pqueue* pq, int i) {
+	pqslot slot = pq->heap[i];
+	int child = 2 * i;
+	while (child <= pq->size) {
+		child += (child < pq->size && pq->heap[child + 1].priority < pq->heap[child].priority);
+		if (pq->heap[child].priority >= slot.priority) {
+			break;
+		}
+		place(pq, i, pq->heap[child]);
+		i = child;
+		child = 2 * i;
+	}
+	place(pq, i, slot);
+}
+
+
+
+/* takes the entry out of the heap, filling its slot with the last one */
+static void unlink_slot(pqueue* pq, int handle) {
+	int i = pq->entries[handle].pos;
+	pqslot last = pq->heap[pq->size];
+	pq->size = pq->size - 1;
+	pq->entries[handle].pos = 0;
+	pq->entries[handle].next_free = pq->free_handle;
+	pq->free_handle = handle;
+	if (i <= pq->size) {
+		int old = pq->heap[i].priority;
+		place(pq, i, last);
+		if (last.priority < old) {
+			sift_up(pq, i);
+		} else {
+			sift_down(pq, i);
+		}
+	}
+}
+
+
+
+/**********************************************************
+ * Functions for the indexed priority queue
+ ***********************************************************/
+
+pqueue* create_pqueue(int capacity) {
+	pqueue* pq = myMalloc(sizeof(pqueue));
+	if (capacity < MIN_PQUEUE_SIZE) {
+		capacity = MIN_PQUEUE_SIZE;
+	}
+	pq->heap = NULL;
+	pq->entries = NULL;
+	resize_pqueue(pq, capacity);
+	clear_pqueue(pq);
+	return pq;
+}
+
+
+
+void free_pqueue(pqueue* pq) {
+	free(pq->heap);
+	free(pq->entries);
+	free(pq);
+}
+
+
+
+void clear_pqueue(pqueue* pq) {
+	pq->size = 0;
+	pq->num_handles = 0;
+	pq->free_handle = -1;
+}
+
+
+
+int pq_is_empty(pqueue* pq) {
+	return (pq->size == 0) ? TRUE : FALSE;
+}
+
+
+
+int pq_insert(pqueue* pq, int priority, int payload) {
+	if (pq->size == pq->capacity) {	//doubling keeps the copying amortized O(1) per insert
+		resize_pqueue(pq, pq->capacity * 2);
+	}
+	int handle;
+	if (pq->free_handle >= 0) {	//reuse handles so entries stays as small as the queue has been
+		handle = pq->free_handle;
+		pq->free_handle = pq->entries[handle].next_free;
+	} else {
+		handle = pq->num_handles;
+		pq->num_handles = pq->num_handles + 1;
+	}
+	pq->entries[handle].payload = payload;
+	pq->size = pq->size + 1;
+	pq->heap[pq->size].priority = priority;
+	pq->heap[pq->size].handle = handle;
+	sift_up(pq, pq->size);
+	return handle;
+}
+
+
+
+int pq_find_min(pqueue* pq, int* priority, int* payload) {
+	if (pq->size == 0) {
+		return -1;
+	}
+	int handle = pq->heap[1].handle;
+	if (priority != NULL) {
+		*priority = pq->heap[1].priority;
+	}
+	if (payload != NULL) {
+		*payload = pq->entries[handle].payload;
+	}
+	return handle;
+}
+
+
+
+int pq_delete_min(pqueue* pq, int* priority, int* payload) {
+	int handle = pq_find_min(pq, priority, payload);
+	if (handle >= 0) {
+		unlink_slot(pq, handle);
+	}
+	return handle;
+}
+
+
+
+int pq_contains(pqueue* pq, int handle) {
+	return (handle >= 0 && handle < pq->num_handles && pq->entries[handle].pos != 0) ? TRUE : FALSE;
+}
+
+
+
+int pq_priority(pqueue* pq, int handle) {
+	return pq->heap[pq->entries[handle].pos].priority;
+}
+
+
+
+int pq_payload(pqueue* pq, int handle) {
+	return pq->entries[handle].payload;
+}
+
+
+
+int pq_decrease_key(pqueue* pq, int handle, int priority) {
+	if (!pq_contains(pq, handle)) {
+		return FALSE;
+	}
+	int i = pq->entries[handle].pos;
+	if (priority > pq->heap[i].priority) {
+		return FALSE;
+	}
+	pq->heap[i].priority = priority;
+	sift_up(pq, i);
+	return TRUE;
+}
+
+
+
+int pq_increase_key(pqueue* pq, int handle, int priority) {
+	if (!pq_contains(pq, handle)) {
+		return FALSE;
+	}
+	int i = pq->entries[handle].pos;
+	if (priority < pq->heap[i].priority) {
+		return FALSE;
+	}
+	pq->heap[i].priority = priority;
+	sift_down(pq, i);
+	return TRUE;
+}
+
+
+
+int pq_remove(pqueue* pq, int handle) {
+	if (!pq_contains(pq, handle)) {
+		return FALSE;
+	}
+	unlink_slot(pq, handle);
+	return TRUE;
+}
+
+
+
+void pq_shift(pqueue* pq, int delta) {
+	int i;
+	for (i = 1; i <= pq->size; i++) {
+		pq->heap[i].priority = pq->heap[i].priority + delta;
+	}
+}
+
+
+
+/**********************************************************
+ * The following main function is for debugging the
+ * indexed priority queue.  Supply the DEBUG_PQUEUE flag
+ * to the compiler to compile it with this main function.
+ ***********************************************************/
+#ifdef DEBUG_PQUEUE
+
+/* checks heap order and that every queued entry knows its slot */
+static void check_pqueue(pqueue* pq) {
+	int i;
+	for (i = 1; i <= pq->size; i++) {
+		assert(i == 1 || pq->heap[i / 2].priority <= pq->heap[i].priority);
+		assert(pq->entries[pq->heap[i].handle].pos == i);
+	}
+}
+
+
+
+int main(void) {
+	printf("===============================\n");
+	printf("Debugging Indexed Priority Queue\n");
+	printf("===============================\n");
+
+	pqueue* pq = create_pqueue(0);
+	assert(pq_is_empty(pq) == TRUE);
+	assert(pq_find_min(pq, NULL, NULL) == -1);
+	assert(pq_delete_min(pq, NULL, NULL) == -1);
+
+	// payloads ride along with their priorities
+	int a = pq_insert(pq, 50, 500);
+	int b = pq_insert(pq, 20, 200);
+	int c = pq_insert(pq, 40, 400);
+	int d = pq_insert(pq, 10, 100);
+	int e = pq_insert(pq, 30, 300);
+	assert(pq->size == 5 && pq->capacity == 8);
+	check_pqueue(pq);
+	int priority = 0, payload = 0;
+	assert(pq_find_min(pq, &priority, &payload) == d && priority == 10 && payload == 100);
+
+	// change priorities through the handles
+	assert(pq_decrease_key(pq, a, 5) == TRUE);
+	assert(pq_find_min(pq, NULL, &payload) == a && payload == 500);
+	assert(pq_decrease_key(pq, b, 25) == FALSE);	//that would raise it
+	assert(pq_increase_key(pq, a, 45) == TRUE);
+	assert(pq_increase_key(pq, c, 1) == FALSE);
+	assert(pq_priority(pq, a) == 45 && pq_payload(pq, c) == 400);
+	check_pqueue(pq);
+
+	// remove from the middle
+	assert(pq_remove(pq, e) == TRUE);
+	assert(pq_remove(pq, e) == FALSE);
+	assert(pq_contains(pq, e) == FALSE);
+	assert(pq_decrease_key(pq, e, 0) == FALSE);
+	check_pqueue(pq);
+
+	// a rebase keeps the order
+	pq_shift(pq, -1000);
+	assert(pq_find_min(pq, &priority, NULL) == d && priority == -990);
+	pq_shift(pq, 1000);
+	check_pqueue(pq);
+
+	int order[4] = {100, 200, 400, 500};
+	int i;
+	for (i = 0; i < 4; i++) {
+		assert(pq_delete_min(pq, NULL, &payload) >= 0 && payload == order[i]);
+	}
+	assert(pq_is_empty(pq) == TRUE);
+
+	// handles are reused once their entries leave
+	int f = pq_insert(pq, 1, 1);
+	assert(f >= 0 && f < 5);
+	assert(pq->num_handles == 5);
+	clear_pqueue(pq);
+
+	// a mix of every operation against a slow reference
+	int n = 2000;
+	int* handles = myMalloc(n * sizeof(int));
+	int* prio = myMalloc(n * sizeof(int));
+	int* queued = myMalloc(n * sizeof(int));
+	for (i = 0; i < n; i++) {
+		prio[i] = (int)((long long)i * 7919 % 10007);
+		handles[i] = pq_insert(pq, prio[i], i);
+		queued[i] = TRUE;
+	}
+	for (i = 0; i < n; i++) {
+		int who = (int)((long long)i * 104729 % n);
+		switch (i % 4) {
+		case 0:
+			prio[who] = prio[who] - 5000;
+			assert(pq_decrease_key(pq, handles[who], prio[who]) == TRUE);
+			break;
+		case 1:
+			prio[who] = prio[who] + 5000;
+			assert(pq_increase_key(pq, handles[who], prio[who]) == TRUE);
+			break;
+		case 2:
+			assert(pq_remove(pq, handles[who]) == TRUE);
+			queued[who] = FALSE;
+			break;
+		default:
+			break;
+		}
+	}
+	check_pqueue(pq);
+	int last = -1000000;
+	int remaining = 0;
+	while (!pq_is_empty(pq)) {
+		pq_delete_min(pq, &priority, &payload);
+		assert(priority >= last && queued[payload] && prio[payload] == priority);
+		queued[payload] = FALSE;
+		last = priority;
+		remaining = remaining + 1;
+	}
+	assert(remaining == n - n / 4);
+	free(handles);
+	free(prio);
+	free(queued);
+
+	free_pqueue(pq);
+	return 0;
+}
+#endif
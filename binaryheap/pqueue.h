@@ -0,0 +1,160 @@
+#ifndef _pqueue_h
+#define _pqueue_h
+
+
+/* one slot of the heap: the priority sits next to the handle so sifting never leaves the array */
+typedef struct pqslot_struct {
+    int priority;     // the priority of the entry, smallest first
+    int handle;       // the entry this slot holds
+} pqslot;
+
+
+/* struct defining an entry, looked up by handle */
+typedef struct pqentry_struct {
+    int payload;      // the caller's data, a vertex or task id
+    int pos;          // index of the entry's slot in heap, 0 when the handle is not queued
+    int next_free;    // the next unused handle while this one is unused
+} pqentry;
+
+
+/*
+ * struct defining an indexed priority queue: a binary heap of
+ * (priority, payload) pairs, each reachable through the handle insert
+ * returned for it.  The entries remember where their slot is in the
+ * heap, so the priority of a queued entry can be changed, or the entry
+ * removed, in O(log n) instead of queueing a duplicate and skipping the
+ * stale copy later.  A handle stays valid until its entry leaves the
+ * queue, after which insert may hand it out again.
+ */
+typedef struct pqueue_struct {
+    int size;           // the number of queued entries
+    int capacity;       // the number of entries heap and entries have room for
+    int num_handles;    // handles handed out so far, used ones included
+    int free_handle;    // first unused handle below num_handles, -1 for none
+    pqslot* heap;       // the heap, in heap[1..size], slot 0 is unused
+    pqentry* entries;   // the entries, indexed by handle
+} pqueue;
+
+
+
+/**********************************************************
+ * function prototypes
+ ***********************************************************/
+
+/**
+ * Creates and initializes an indexed priority queue
+ * @param capacity - the number of entries to make room for up front, the
+ *        queue grows past it as needed
+ * @return a pointer to the newly created queue
+ **/
+pqueue* create_pqueue(int capacity);
+
+/**
+ * Frees all the memory for the specified queue
+ * @param pq - a pointer to the queue to be freed
+ **/
+void free_pqueue(pqueue* pq);
+
+/**
+ * Empties the queue, every handle becomes unused
+ * @param pq - a pointer to the queue
+ **/
+void clear_pqueue(pqueue* pq);
+
+/**
+ * Checks to see if the queue is empty
+ * @param pq - a pointer to the queue
+ * @return TRUE if empty, FALSE otherwise
+ **/
+int pq_is_empty(pqueue* pq);
+
+/**
+ * Queues a payload.  Duplicate priorities and payloads are allowed.
+ * @param pq - a pointer to the queue
+ * @param priority - the priority, the smallest is served first
+ * @param payload - the caller's data
+ * @return the handle of the new entry
+ **/
+int pq_insert(pqueue* pq, int priority, int payload);
+
+/**
+ * Looks at the entry with the smallest priority without removing it
+ * @param pq - a pointer to the queue
+ * @param priority - set to its priority, may be NULL
+ * @param payload - set to its payload, may be NULL
+ * @return its handle, -1 if the queue is empty
+ **/
+int pq_find_min(pqueue* pq, int* priority, int* payload);
+
+/**
+ * Removes the entry with the smallest priority.  Its handle becomes unused.
+ * @param pq - a pointer to the queue
+ * @param priority - set to its priority, may be NULL
+ * @param payload - set to its payload, may be NULL
+ * @return its handle, -1 if the queue is empty
+ **/
+int pq_delete_min(pqueue* pq, int* priority, int* payload);
+
+/**
+ * Checks whether a handle refers to a queued entry
+ * @param pq - a pointer to the queue
+ * @param handle - the handle
+ * @return TRUE if it does, FALSE otherwise
+ **/
+int pq_contains(pqueue* pq, int handle);
+
+/**
+ * Gives the priority of a queued entry
+ * @param pq - a pointer to the queue
+ * @param handle - the handle of a queued entry
+ * @return its priority
+ **/
+int pq_priority(pqueue* pq, int handle);
+
+/**
+ * Gives the payload of a queued entry
+ * @param pq - a pointer to the queue
+ * @param handle - the handle of a queued entry
+ * @return its payload
+ **/
+int pq_payload(pqueue* pq, int handle);
+
+/**
+ * Lowers the priority of a queued entry, moving it toward the front
+ * @param pq - a pointer to the queue
+ * @param handle - the handle of the entry
+ * @param priority - the new priority, no larger than the current one
+ * @return TRUE if the priority was changed, FALSE if the handle is not
+ *         queued or priority is larger than the current one
+ **/
+int pq_decrease_key(pqueue* pq, int handle, int priority);
+
+/**
+ * Raises the priority of a queued entry, moving it toward the back
+ * @param pq - a pointer to the queue
+ * @param handle - the handle of the entry
+ * @param priority - the new priority, no smaller than the current one
+ * @return TRUE if the priority was changed, FALSE if the handle is not
+ *         queued or priority is smaller than the current one
+ **/
+int pq_increase_key(pqueue* pq, int handle, int priority);
+
+/**
+ * Removes a queued entry, wherever it is in the queue.  Its handle
+ * becomes unused.
+ * @param pq - a pointer to the queue
+ * @param handle - the handle of the entry
+ * @return TRUE if it was removed, FALSE if the handle is not queued
+ **/
+int pq_remove(pqueue* pq, int handle);
+
+/**
+ * Adds delta to the priority of every queued entry.  Their order stays
+ * the same, so nothing moves; callers keying by time use it to rebase.
+ * @param pq - a pointer to the queue
+ * @param delta - the amount to add, no priority may overflow
+ **/
+void pq_shift(pqueue* pq, int delta);
+
+
+#endif
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "utils.h"
+#include "radixheap.h"
+
+#define MIN_BUCKET_SIZE 8	// smallest room a bucket is given
+
+/* the bucket of key: 0 when it equals last, else one more than the highest bit where they differ */
+#define BUCKET_OF(key, last) ((key) == (last) ? 0 : 32 - __builtin_clz((unsigned)(key) ^ (unsigned)(last)))
+
+
+/* appends an item to a bucket, doubling its room when full */
+static inline void push_item(rhbucket* b, int key, int payload) {
+	if (b->size == b->cap) {
+		b->cap = (b->cap == 0) ? MIN_BUCKET_SIZE : 2 * b->cap;
+		b->items = myRealloc(b->items, b->cap * sizeof(rhitem));
+	}
+	b->items[b->size].key = key;
+	b->items[b->size].payload = payload;
+	b->size = b->size + 1;
+}
+
+
+
+/**********************************************************
+ * Functions for the radix heap
+ ***********************************************************/
+
+radixheap* create_radixheap(void) {
+	radixheap* rh = myMalloc(sizeof(radixheap));
+	rh->size = 0;
+	rh->last = 0;
+	int i;
+	for (i = 0; i < RH_BUCKETS; i++) {
+		rh->buckets[i].size = 0;
+		rh->buckets[i].cap = 0;
+		rh->buckets[i].items = NULL;
+	}
+	return rh;
+}
+
+
+
+void free_radixheap(radixheap* rh) {
+	int i;
+	for (i = 0; i < RH_BUCKETS; i++) {
+		free(rh->buckets[i].items);
+	}
+	free(rh);
+}
+
+
+
+int rh_is_empty(radixheap* rh) {
+	return (rh->size == 0) ? TRUE : FALSE;
+}
+
+
+
+int rh_insert(radixheap* rh, int key, int payload) {
+	if (key < rh->last) {
+		return FALSE;
+	}
+	push_item(&rh->buckets[BUCKET_OF(key, rh->last)], key, payload);
+	rh->size = rh->size + 1;
+	return TRUE;
+}
+
+
+
+int rh_delete_min(radixheap* rh, int* payload) {
+	if (rh->size == 0) {
+		return -1;
+	}
+	rhbucket* zero = &rh->buckets[0];
+	if (zero->size == 0) {
+		int b = 1;
+		while (rh->buckets[b].size == 0) {
+			b = b + 1;
+		}
+		rhbucket* from = &rh->buckets[b];
+		int min = from->items[0].key;
+		int i;
+		for (i = 1; i < from->size; i++) {
+			min = (from->items[i].key < min) ? from->items[i].key : min;
+		}
+		rh->last = min;	//every key of the bucket now differs from last below bit b - 1
+		for (i = 0; i < from->size; i++) {
+			push_item(&rh->buckets[BUCKET_OF(from->items[i].key, min)], from->items[i].key, from->items[i].payload);
+		}
+		from->size = 0;
+	}
+	zero->size = zero->size - 1;
+	rh->size = rh->size - 1;
+	if (payload != NULL) {
+		*payload = zero->items[zero->size].payload;
+	}
+	return zero->items[zero->size].key;
+}
+
+
+
+/**********************************************************
+ * The following main function is for debugging the radix
+ * heap.  Supply the DEBUG_RADIXHEAP flag to the compiler
+ * to compile it with this main function.
+ ***********************************************************/
+#ifdef DEBUG_RADIXHEAP
+int main(void) {
+	printf("====================\n");
+	printf("Debugging Radix Heap\n");
+	printf("====================\n");
+
+	radixheap* rh = create_radixheap();
+	assert(rh_is_empty(rh) == TRUE);
+	assert(rh_delete_min(rh, NULL) == -1);
+	int keys[8] = {50, 7, 0, 1000000, 7, 64, 2147483647, 63};
+	int i;
+	for (i = 0; i < 8; i++) {
+		assert(rh_insert(rh, keys[i], i) == TRUE);
+	}
+	int payload;
+	assert(rh_delete_min(rh, &payload) == 0 && payload == 2);
+	assert(rh_delete_min(rh, NULL) == 7);
+	assert(rh_delete_min(rh, NULL) == 7);
+	assert(rh_insert(rh, 6, 0) == FALSE);	//below the last key deleted
+	assert(rh_insert(rh, 7, 99) == TRUE);	//equal is fine
+	assert(rh_delete_min(rh, &payload) == 7 && payload == 99);
+	assert(rh_delete_min(rh, NULL) == 50);
+	assert(rh_delete_min(rh, NULL) == 63);
+	assert(rh_delete_min(rh, NULL) == 64);
+	assert(rh_delete_min(rh, &payload) == 1000000 && payload == 3);
+	assert(rh_delete_min(rh, NULL) == 2147483647);
+	assert(rh_is_empty(rh) == TRUE);
+	free_radixheap(rh);
+
+	// an event simulation: take the next event, schedule later ones
+	rh = create_radixheap();
+	int* pending = calloc(1 << 20, sizeof(int));	//events per time
+	unsigned int x = 1;
+	for (i = 0; i < 1000; i++) {
+		x = x * 1103515245 + 12345;
+		int t = (int)(x >> 22);
+		rh_insert(rh, t, t);
+		pending[t] = pending[t] + 1;
+	}
+	int now = 0;
+	int steps;
+	for (steps = 0; steps < 100000; steps++) {
+		int t = rh_delete_min(rh, &payload);
+		assert(t >= now && payload == t);
+		while (pending[now] == 0) {	//nothing is pending between now and t
+			assert(now < t);
+			now = now + 1;
+		}
+		assert(now == t);
+		pending[t] = pending[t] - 1;
+		x = x * 1103515245 + 12345;
+		int later = t + (int)(x >> 28);	//0 to 15 later, sometimes the same time
+		if (later < (1 << 20)) {
+			rh_insert(rh, later, later);
+			pending[later] = pending[later] + 1;
+		}
+	}
+	assert(rh->size == 1000);
+	free(pending);
+	free_radixheap(rh);
+	return 0;
+}
+#endif
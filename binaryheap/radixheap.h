@@ -0,0 +1,85 @@
+#ifndef _radixheap_h
+#define _radixheap_h
+
+#define RH_BUCKETS 33   // bucket 0, then one per bit of a 32-bit key
+
+
+/* struct defining a key and the caller's data queued with it */
+typedef struct rhitem_struct {
+    int key;          // the priority, not negative
+    int payload;      // the caller's data, a vertex or task id
+} rhitem;
+
+
+/* struct defining one bucket: an unordered array of items */
+typedef struct rhbucket_struct {
+    int size;         // items in the bucket
+    int cap;          // room in items
+    rhitem* items;
+} rhbucket;
+
+
+/*
+ * struct defining a radix heap, a monotone priority queue for keys that
+ * are not negative: no key inserted may be smaller than the last key
+ * deleted, which holds for Dijkstra's algorithm and for event simulation.
+ * A key goes to the bucket numbered by the highest bit in which it
+ * differs from last, bucket 0 holding keys equal to last.  delete_min
+ * takes from bucket 0 or, when that is empty, empties the first
+ * non-empty bucket into the lower ones around its smallest key.  Each key
+ * only moves to lower buckets, at most 32 times in all, so the cost is
+ * O(1) per insert and amortized O(log C) per delete_min for keys up to
+ * C, with sequential scans of small arrays instead of the jumps of a
+ * heap.
+ */
+typedef struct radixheap_struct {
+    int size;                        // the number of keys queued
+    int last;                        // the last key deleted, the smallest that may be inserted
+    rhbucket buckets[RH_BUCKETS];
+} radixheap;
+
+
+
+/**********************************************************
+ * function prototypes
+ ***********************************************************/
+
+/**
+ * Creates and initializes an empty radix heap
+ * @return a pointer to the newly created heap
+ **/
+radixheap* create_radixheap(void);
+
+/**
+ * Frees all the memory for the specified heap
+ * @param rh - a pointer to the heap to be freed
+ **/
+void free_radixheap(radixheap* rh);
+
+/**
+ * Checks to see if the heap is empty
+ * @param rh - a pointer to the heap
+ * @return TRUE if empty, FALSE otherwise
+ **/
+int rh_is_empty(radixheap* rh);
+
+/**
+ * Inserts a key with a payload.  Duplicate keys are allowed.
+ * @param rh - a pointer to the heap
+ * @param key - the key, no smaller than the last key deleted
+ * @param payload - the caller's data
+ * @return TRUE if inserted, FALSE if key is smaller than the last key
+ *         deleted, which the heap cannot order
+ **/
+int rh_insert(radixheap* rh, int key, int payload);
+
+/**
+ * Deletes a smallest key
+ * @param rh - a pointer to the heap
+ * @param payload - set to the payload of the key, may be NULL
+ * @return the key deleted, -1 if the heap is empty
+ **/
+int rh_delete_min(radixheap* rh, int* payload);
+
+
+#endif
@@ -0,0 +1,337 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <assert.h>
+#include "utils.h"
+#include "timerwheel.h"
+
+#define MIN_TIMERS 16	// smallest room a wheel is given for timers
+
+/* the lowest level whose slots reach delta ticks ahead, delta < 2^24 */
+#define LEVEL_OF(delta) (((delta) < TW_SLOTS) ? 0 : (63 - __builtin_clzll(delta)) / TW_SLOT_BITS)
+
+/* the slot of heads that the level's slot for tick is in */
+#define SLOT_OF(level, tick) ((level) * TW_SLOTS + (int)(((tick) >> ((level) * TW_SLOT_BITS)) & (TW_SLOTS - 1)))
+
+
+/* puts the timer in the slot its expiry falls in, or in far when past the wheel's span */
+static void link_timer(timerwheel* tw, int handle) {
+	twtimer* t = &tw->timers[handle];
+	long long delta = t->expiry - tw->now;	//0 only while the tick is being processed
+	if (delta >= (1LL << TW_SPAN_BITS)) {
+		if (pq_is_empty(tw->far)) {
+			tw->far_base = tw->now >> TW_SPAN_BITS;
+		}
+		t->slot = TW_FAR;
+		t->far_handle = pq_insert(tw->far, (int)((t->expiry >> TW_SPAN_BITS) - tw->far_base), handle);
+		return;
+	}
+	int slot = SLOT_OF(LEVEL_OF(delta), t->expiry);
+	t->slot = slot;
+	t->prev = -1;
+	t->next = tw->heads[slot];
+	if (t->next >= 0) {
+		tw->timers[t->next].prev = handle;
+	}
+	tw->heads[slot] = handle;
+	tw->level_size[slot / TW_SLOTS] = tw->level_size[slot / TW_SLOTS] + 1;
+}
+
+
+
+/* takes the timer out of its slot or out of far */
+static void unlink_timer(timerwheel* tw, int handle) {
+	twtimer* t = &tw->timers[handle];
+	if (t->slot == TW_FAR) {
+		pq_remove(tw->far, t->far_handle);
+		return;
+	}
+	if (t->prev >= 0) {
+		tw->timers[t->prev].next = t->next;
+	} else {
+		tw->heads[t->slot] = t->next;
+	}
+	if (t->next >= 0) {
+		tw->timers[t->next].prev = t->prev;
+	}
+	tw->level_size[t->slot / TW_SLOTS] = tw->level_size[t->slot / TW_SLOTS] - 1;
+}
+
+
+
+/* makes the handle of an unlinked timer unused */
+static void release_timer(timerwheel* tw, int handle) {
+	tw->timers[handle].slot = TW_UNUSED;
+	tw->timers[handle].next = tw->free_handle;
+	tw->free_handle = handle;
+	tw->size = tw->size - 1;
+}
+
+
+
+/* empties the level's slot for tick into the levels below, as its timers are now near enough */
+static void cascade(timerwheel* tw, int level, long long tick) {
+	int slot = SLOT_OF(level, tick);
+	int handle = tw->heads[slot];
+	tw->heads[slot] = -1;
+	while (handle >= 0) {
+		int next = tw->timers[handle].next;
+		tw->level_size[level] = tw->level_size[level] - 1;
+		link_timer(tw, handle);
+		handle = next;
+	}
+}
+
+
+
+/*
+ * moves the timers of far due within the wheel's span of tick, the start
+ * of a span, into the wheel.  The keys left are blocks ahead of tick's, so
+ * rebasing them on an old far_base keeps them under 2^30 + 2^29.
+ */
+static void pull_far(timerwheel* tw, long long tick) {
+	long long now_block = tick >> TW_SPAN_BITS;
+	int block, handle;
+	while (pq_find_min(tw->far, &block, &handle) >= 0 && block <= now_block - tw->far_base) {
+		pq_delete_min(tw->far, NULL, NULL);
+		link_timer(tw, handle);
+	}
+	if (now_block - tw->far_base >= (1LL << TW_REBASE_BITS)) {
+		pq_shift(tw->far, (int)(tw->far_base - now_block));
+		tw->far_base = now_block;
+	}
+}
+
+
+
+/**********************************************************
+ * Functions for the timer wheel
+ ***********************************************************/
+
+timerwheel* create_timerwheel(long long resolution, long long start) {
+	timerwheel* tw = myMalloc(sizeof(timerwheel));
+	tw->resolution = (resolution < 1) ? 1 : resolution;
+	tw->now = start / tw->resolution;
+	tw->size = 0;
+	tw->capacity = MIN_TIMERS;
+	tw->num_handles = 0;
+	tw->free_handle = -1;
+	int i;
+	for (i = 0; i < TW_LEVELS; i++) {
+		tw->level_size[i] = 0;
+	}
+	for (i = 0; i < TW_LEVELS * TW_SLOTS; i++) {
+		tw->heads[i] = -1;
+	}
+	tw->timers = myMalloc(tw->capacity * sizeof(twtimer));
+	tw->far = create_pqueue(0);
+	tw->far_base = tw->now >> TW_SPAN_BITS;
+	return tw;
+}
+
+
+
+void free_timerwheel(timerwheel* tw) {
+	free_pqueue(tw->far);
+	free(tw->timers);
+	free(tw);
+}
+
+
+
+int tw_schedule(timerwheel* tw, long long when, int payload) {
+	long long tick = when / tw->resolution + (when % tw->resolution > 0);	//never early, and when + resolution could overflow
+	if (tick > tw->now && tick - tw->now >= (1LL << (TW_MAX_AHEAD_BITS + TW_SPAN_BITS))) {
+		return -1;
+	}
+	int handle;
+	if (tw->free_handle >= 0) {	//reuse handles so timers stays as small as the wheel has been
+		handle = tw->free_handle;
+		tw->free_handle = tw->timers[handle].next;
+	} else {
+		if (tw->num_handles == tw->capacity) {	//doubling keeps the copying amortized O(1) per timer
+			tw->capacity = tw->capacity * 2;
+			tw->timers = myRealloc(tw->timers, tw->capacity * sizeof(twtimer));
+		}
+		handle = tw->num_handles;
+		tw->num_handles = tw->num_handles + 1;
+	}
+	tw->timers[handle].expiry = (tick > tw->now) ? tick : tw->now + 1;
+	tw->timers[handle].payload = payload;
+	link_timer(tw, handle);
+	tw->size = tw->size + 1;
+	return handle;
+}
+
+
+
+int tw_is_scheduled(timerwheel* tw, int handle) {
+	return (handle >= 0 && handle < tw->num_handles && tw->timers[handle].slot != TW_UNUSED) ? TRUE : FALSE;
+}
+
+
+
+int tw_cancel(timerwheel* tw, int handle) {
+	if (!tw_is_scheduled(tw, handle)) {
+		return FALSE;
+	}
+	unlink_timer(tw, handle);
+	release_timer(tw, handle);
+	return TRUE;
+}
+
+
+
+int tw_advance(timerwheel* tw, long long now, tw_expire_fn fire, void* arg) {
+	long long target = now / tw->resolution;
+	int fired = 0;
+	while (tw->now < target) {
+		int lowest = 0;	//the lowest level with timers, TW_LEVELS for far
+		while (lowest < TW_LEVELS && tw->level_size[lowest] == 0) {
+			lowest = lowest + 1;
+		}
+		if (lowest > 0) {	//nothing happens before the level below lowest next wraps, skip to it
+			long long next = target;
+			if (lowest < TW_LEVELS || !pq_is_empty(tw->far)) {
+				int bits = lowest * TW_SLOT_BITS;
+				long long wrap = ((tw->now >> bits) + 1) << bits;
+				next = (wrap - 1 < target) ? wrap - 1 : target;
+			}
+			if (next > tw->now) {
+				tw->now = next;
+				continue;
+			}
+		}
+		long long tick = tw->now + 1;
+		tw->now = tick;
+		if ((tick & ((1LL << TW_SPAN_BITS) - 1)) == 0) {
+			pull_far(tw, tick);
+		}
+		int level;
+		for (level = TW_LEVELS - 1; level > 0; level--) {	//the highest first, its timers may land in the slots below
+			if ((tick & ((1LL << (level * TW_SLOT_BITS)) - 1)) == 0) {
+				cascade(tw, level, tick);
+			}
+		}
+		int slot = SLOT_OF(0, tick);
+		while (tw->heads[slot] >= 0) {	//one at a time, fire may cancel the others
+			int handle = tw->heads[slot];
+			int payload = tw->timers[handle].payload;
+			unlink_timer(tw, handle);
+			release_timer(tw, handle);
+			fired = fired + 1;
+			if (fire != NULL) {
+				fire(handle, payload, arg);
+			}
+		}
+	}
+	return fired;
+}
+
+
+
+/**********************************************************
+ * The following main function is for debugging the timer
+ * wheel.  Supply the DEBUG_TIMERWHEEL flag to the compiler
+ * to compile it with this main function.
+ ***********************************************************/
+#ifdef DEBUG_TIMERWHEEL
+
+/* what the checking callback needs */
+typedef struct {
+    timerwheel* tw;
+    long long* due;       // the tick every payload must fire on
+    int* handle;          // the handle of every payload, -1 once fired or cancelled
+    int fired;
+} check_state;
+
+static void check_fire(int handle, int payload, void* arg) {
+	check_state* s = arg;
+	assert(s->handle[payload] == handle);
+	assert(s->due[payload] == s->tw->now);
+	assert(!tw_is_scheduled(s->tw, handle));
+	s->handle[payload] = -1;
+	s->fired = s->fired + 1;
+}
+
+int main(void) {
+	printf("=====================\n");
+	printf("Debugging Timer Wheel\n");
+	printf("=====================\n");
+
+	// a millisecond wheel counting in microseconds
+	timerwheel* tw = create_timerwheel(1000, 5000);
+	assert(tw->now == 5);
+	int a = tw_schedule(tw, 7500, 1);	//fires on tick 8
+	int b = tw_schedule(tw, 1000, 2);	//in the past, fires on tick 6
+	int c = tw_schedule(tw, 5000 + 1000 * (1LL << 25), 3);	//past the span, in far
+	assert(tw->timers[c].slot == TW_FAR && tw->far->size == 1);
+	assert(tw_advance(tw, 5999, NULL, NULL) == 0);
+	assert(tw_advance(tw, 6000, NULL, NULL) == 1 && !tw_is_scheduled(tw, b));
+	assert(tw_cancel(tw, b) == FALSE);
+	assert(tw_advance(tw, 7999, NULL, NULL) == 0);
+	assert(tw_advance(tw, 8000, NULL, NULL) == 1 && !tw_is_scheduled(tw, a));
+	assert(tw_cancel(tw, c) == TRUE && tw->far->size == 0 && tw->size == 0);
+	assert(tw_advance(tw, 1LL << 40, NULL, NULL) == 0);	//an idle jump
+	assert(tw->now == (1LL << 40) / 1000);
+	free_timerwheel(tw);
+
+	// nanoseconds since the epoch, far past the ticks an int block can count from 0
+	long long epoch = 1760000000000000000LL;
+	tw = create_timerwheel(1, epoch);
+	int far = tw_schedule(tw, epoch + (1LL << 25), 4);
+	assert(far >= 0 && tw->timers[far].slot == TW_FAR);
+	assert(tw_schedule(tw, epoch + (1LL << 54), 5) == -1);	//too far ahead
+	assert(tw_schedule(tw, LLONG_MAX, 5) == -1);
+	assert(tw_advance(tw, epoch + (1LL << 25) - 1, NULL, NULL) == 0);
+	assert(tw_advance(tw, epoch + (1LL << 25), NULL, NULL) == 1 && tw->size == 0);
+	free_timerwheel(tw);
+
+	// random schedules, cancels and jumps against the ticks they were due on
+	int n = 20000;
+	check_state s;
+	tw = create_timerwheel(1, 0);
+	s.tw = tw;
+	s.due = myMalloc(n * sizeof(long long));
+	s.handle = myMalloc(n * sizeof(int));
+	s.fired = 0;
+	unsigned int x = 99;
+	int i, scheduled = 0, cancelled = 0;
+	long long now = 0;
+	for (i = 0; i < n; i++) {
+		x = x * 1103515245 + 12345;
+		long long delta;
+		switch ((x >> 16) % 4) {	//ticks ahead: near, middle levels, past the span
+			case 0: delta = (x >> 8) % 64; break;
+			case 1: delta = (x >> 8) % 5000; break;
+			case 2: delta = (x >> 4) % (1 << 22); break;
+			default: delta = (1LL << 24) + (long long)(x >> 4) * 7; break;
+		}
+		s.handle[i] = tw_schedule(tw, now + delta, i);
+		s.due[i] = (delta > 0) ? now + delta : now + 1;
+		scheduled = scheduled + 1;
+		x = x * 1103515245 + 12345;
+		if ((x >> 16) % 3 == 0) {	//cancel an earlier one
+			int j = (int)((x >> 4) % (i + 1));
+			if (s.handle[j] >= 0) {
+				assert(tw_cancel(tw, s.handle[j]) == TRUE);
+				s.handle[j] = -1;
+				cancelled = cancelled + 1;
+			}
+		}
+		x = x * 1103515245 + 12345;
+		now = now + ((x >> 16) % 2000) + (((x >> 8) % 500 == 0) ? (1LL << 23) : 0);
+		tw_advance(tw, now, check_fire, &s);
+		assert(tw->size == scheduled - cancelled - s.fired);
+	}
+	tw_advance(tw, now + (1LL << 32), check_fire, &s);
+	assert(s.fired + cancelled == n && tw->size == 0 && tw->far->size == 0);
+	for (i = 0; i < n; i++) {
+		assert(s.handle[i] == -1);
+	}
+	free(s.due);
+	free(s.handle);
+	free_timerwheel(tw);
+	return 0;
+}
+#endif
@@ -0,0 +1,123 @@
+#ifndef _timerwheel_h
+#define _timerwheel_h
+
+#include "pqueue.h"
+
+#define TW_SLOT_BITS 6                              // 64 slots a level
+#define TW_SLOTS (1 << TW_SLOT_BITS)
+#define TW_LEVELS 4                                 // the wheel spans 64^4 = 2^24 ticks
+#define TW_SPAN_BITS (TW_SLOT_BITS * TW_LEVELS)
+#define TW_MAX_AHEAD_BITS 30                        // timers are due within 2^30 spans, 2^54 ticks
+#define TW_REBASE_BITS 29                           // far is rebased once its base is 2^29 spans old
+
+
+/* struct defining a timer, looked up by handle */
+typedef struct twtimer_struct {
+    long long expiry;   // the tick the timer fires on
+    int payload;        // the caller's data, a connection or task id
+    int slot;           // the wheel slot holding the timer, TW_FAR or TW_UNUSED otherwise
+    int prev;           // the neighbours in the slot's list, -1 at the ends
+    int next;           //   next is also the next unused handle while this one is unused
+    int far_handle;     // the timer's handle in far while slot is TW_FAR
+} twtimer;
+
+#define TW_FAR -1       // slot of a timer due past the wheel's span, queued in far
+#define TW_UNUSED -2    // slot of a handle that is not scheduled
+
+
+/*
+ * struct defining a hierarchical timing wheel.  Time is counted in ticks
+ * of resolution caller units.  Level L has 64 slots of 64^L ticks each, a
+ * timer going to the lowest level whose span reaches its expiry, into a
+ * doubly linked list so that scheduling and cancelling are O(1) with no
+ * ordering work at all.  When a level wraps, the next slot of the level
+ * above is emptied into the levels below, so every timer is moved at
+ * most TW_LEVELS times before it fires with the other timers of its
+ * tick, and runs of ticks with nothing to fire or move are skipped.
+ * Timers due past the 2^24 ticks the wheel spans wait in a pqueue keyed
+ * by their 2^24 tick block until the wheel reaches that block.  The key
+ * counts blocks from far_base rather than from tick 0, so that it fits
+ * an int whatever the absolute tick, and far is rebased before it drifts
+ * out of range.
+ * Workloads that cancel nearly every timer, like connection timeouts,
+ * never pay for more than the O(1) list operations.
+ */
+typedef struct timerwheel_struct {
+    long long resolution;              // caller units a tick
+    long long now;                     // the last tick processed
+    int size;                          // the number of scheduled timers
+    int level_size[TW_LEVELS];         // those of them on every level, the rest are in far
+    int capacity;                      // the number of timers timers has room for
+    int num_handles;                   // handles handed out so far, used ones included
+    int free_handle;                   // first unused handle below num_handles, -1 for none
+    int heads[TW_LEVELS * TW_SLOTS];   // the first timer of every slot, -1 for none
+    twtimer* timers;                   // the timers, indexed by handle
+    pqueue* far;                       // timers past the wheel's span, payload is the handle
+    long long far_base;                // the block far's keys count from, at most now's block
+} timerwheel;
+
+
+/* called for every timer that fires, the handle is unused again by then */
+typedef void (*tw_expire_fn)(int handle, int payload, void* arg);
+
+
+
+/**********************************************************
+ * function prototypes
+ ***********************************************************/
+
+/**
+ * Creates and initializes an empty timer wheel
+ * @param resolution - the caller's time units a tick, at least 1
+ * @param start - the current time, in the caller's units
+ * @return a pointer to the newly created timer wheel
+ **/
+timerwheel* create_timerwheel(long long resolution, long long start);
+
+/**
+ * Frees all the memory for the specified timer wheel
+ * @param tw - a pointer to the timer wheel to be freed
+ **/
+void free_timerwheel(timerwheel* tw);
+
+/**
+ * Schedules a timer.  It fires on the first tick at or after when, and
+ * on the next tick if that has passed.
+ * @param tw - a pointer to the timer wheel
+ * @param when - the time to fire at, in the caller's units
+ * @param payload - the caller's data
+ * @return the handle of the timer, valid until it fires or is cancelled,
+ *         -1 if when is 2^54 ticks or more ahead
+ **/
+int tw_schedule(timerwheel* tw, long long when, int payload);
+
+/**
+ * Cancels a scheduled timer
+ * @param tw - a pointer to the timer wheel
+ * @param handle - the handle tw_schedule returned
+ * @return TRUE if cancelled, FALSE if the handle is not scheduled
+ **/
+int tw_cancel(timerwheel* tw, int handle);
+
+/**
+ * Checks whether a handle is scheduled
+ * @param tw - a pointer to the timer wheel
+ * @param handle - the handle to check
+ * @return TRUE if it is, FALSE otherwise
+ **/
+int tw_is_scheduled(timerwheel* tw, int handle);
+
+/**
+ * Moves the time forward, firing the timers of every tick passed, a tick
+ * at a time and in no particular order within a tick.  fire may schedule
+ * and cancel timers.
+ * @param tw - a pointer to the timer wheel
+ * @param now - the current time, in the caller's units
+ * @param fire - the function called for every timer that fires
+ * @param arg - passed on to fire
+ * @return the number of timers fired
+ **/
+int tw_advance(timerwheel* tw, long long now, tw_expire_fn fire, void* arg);
+
+
+#endif
@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <assert.h>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+#include "utils.h"
+#include "topk.h"
+
+
+/* keeps key in place of the smallest key kept, which it is larger than */
+static inline void replace_root(binheap* h, int key) {
+	h->arr[1] = key;
+	percolate_down(h, 1);
+}
+
+
+
+/* offers key to a heap keeping the k largest keys, without counting it */
+static inline int offer(binheap* h, int k, int key) {
+	if (h->cur_size < k) {
+		insert(h, key);
+		return TRUE;
+	}
+	if (key <= h->arr[1]) {	//the one compare most keys cost
+		return FALSE;
+	}
+	replace_root(h, key);
+	return TRUE;
+}
+
+
+
+/* struct defining the work of one thread of topk_parallel */
+typedef struct topk_task_struct {
+    const int* keys;     // the slice to select from, NULL when merging
+    long long n;         // keys in the slice
+    int k;
+    topk* t;             // the selection made, or merged into
+    topk* other;         // the selection merged from
+} topk_task;
+
+static void* run_topk_task(void* arg) {
+	topk_task* task = arg;
+	if (task->keys != NULL) {
+		task->t = create_topk(task->k);
+		topk_offer_batch(task->t, task->keys, task->n);
+	} else {
+		topk_merge(task->t, task->other);
+		free_topk(task->other);
+	}
+	return NULL;
+}
+
+
+
+/**********************************************************
+ * Functions for the top-k selection
+ ***********************************************************/
+
+topk* create_topk(int k) {
+	topk* t = myMalloc(sizeof(topk));
+	if (k < 1) {
+		k = 1;
+	}
+	t->k = k;
+	t->heap = create_binheap(k);	//never grows, it holds at most k keys
+	t->seen = 0;
+	return t;
+}
+
+
+
+void free_topk(topk* t) {
+	free_binheap(t->heap);
+	free(t);
+}
+
+
+
+int topk_threshold(topk* t) {
+	return (t->heap->cur_size < t->k) ? INT_MIN : t->heap->arr[1];
+}
+
+
+
+int topk_offer(topk* t, int key) {
+	t->seen = t->seen + 1;
+	return offer(t->heap, t->k, key);
+}
+
+
+
+void topk_offer_batch(topk* t, const int* keys, long long n) {
+	binheap* h = t->heap;
+	long long i = 0;
+	for (; i < n && h->cur_size < t->k; i++) {	//fill the heap first, every key is kept
+		insert(h, keys[i]);
+	}
+#if defined(__SSE2__)
+	int threshold = h->arr[1];	//read again only when it changes
+#endif
+#if defined(__AVX2__)
+	for (; i + 8 <= n; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(keys + i));
+		int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, _mm256_set1_epi32(threshold))));
+		while (mask != 0) {	//rare once the threshold has risen
+			int j = __builtin_ctz(mask);
+			mask = mask & (mask - 1);
+			if (keys[i + j] > threshold) {	//the threshold may have risen since the compare
+				replace_root(h, keys[i + j]);
+				threshold = h->arr[1];
+			}
+		}
+	}
+#elif defined(__SSE2__)
+	for (; i + 4 <= n; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(keys + i));
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, _mm_set1_epi32(threshold))));
+		while (mask != 0) {	//rare once the threshold has risen
+			int j = __builtin_ctz(mask);
+			mask = mask & (mask - 1);
+			if (keys[i + j] > threshold) {	//the threshold may have risen since the compare
+				replace_root(h, keys[i + j]);
+				threshold = h->arr[1];
+			}
+		}
+	}
+#endif
+	for (; i < n; i++) {
+		offer(h, t->k, keys[i]);
+	}
+	t->seen = t->seen + n;
+}
+
+
+
+void topk_merge(topk* into, topk* from) {
+	long long seen = into->seen;
+	topk_offer_batch(into, &from->heap->arr[1], from->heap->cur_size);
+	into->seen = seen + from->seen;
+}
+
+
+
+int topk_result(topk* t, int* out) {
+	int n = t->heap->cur_size;
+	binheap* sorted = create_binheap(n);
+	memcpy(&sorted->arr[1], &t->heap->arr[1], n * sizeof(int));
+	sorted->cur_size = n;
+	heap_sort(sorted);	//ascending
+	int i;
+	for (i = 0; i < n; i++) {
+		out[i] = sorted->arr[n - i];
+	}
+	free_binheap(sorted);
+	return n;
+}
+
+
+
+topk* topk_parallel(const int* keys, long long n, int k, int num_threads) {
+	if (num_threads < 1) {
+		num_threads = 1;
+	}
+	pthread_t* threads = myMalloc(num_threads * sizeof(pthread_t));
+	topk_task* tasks = myMalloc(num_threads * sizeof(topk_task));
+	int i;
+	for (i = 0; i < num_threads; i++) {
+		long long first = n * i / num_threads;
+		tasks[i].keys = keys + first;
+		tasks[i].n = n * (i + 1) / num_threads - first;
+		tasks[i].k = k;
+		pthread_create(&threads[i], NULL, run_topk_task, &tasks[i]);
+	}
+	for (i = 0; i < num_threads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	int step;
+	for (step = 1; step < num_threads; step *= 2) {	//merge in pairs, log2(num_threads) rounds
+		for (i = 0; i + step < num_threads; i += 2 * step) {
+			tasks[i].keys = NULL;
+			tasks[i].other = tasks[i + step].t;
+			pthread_create(&threads[i], NULL, run_topk_task, &tasks[i]);
+		}
+		for (i = 0; i + step < num_threads; i += 2 * step) {
+			pthread_join(threads[i], NULL);
+		}
+	}
+	topk* t = tasks[0].t;
+	free(tasks);
+	free(threads);
+	return t;
+}
+
+
+
+/**********************************************************
+ * The following main function is for debugging the top-k
+ * selection.  Supply the DEBUG_TOPK flag to the compiler
+ * to compile it with this main function.
+ ***********************************************************/
+#ifdef DEBUG_TOPK
+
+static int compare_desc(const void* a, const void* b) {
+	int x = *(const int*)a;
+	int y = *(const int*)b;
+	return (x < y) - (x > y);
+}
+
+int main(void) {
+	printf("===============\n");
+	printf("Debugging Top-k\n");
+	printf("===============\n");
+
+	topk* t = create_topk(3);
+	assert(topk_threshold(t) == INT_MIN);
+	assert(topk_offer(t, 5) == TRUE);
+	assert(topk_offer(t, 1) == TRUE);
+	assert(topk_offer(t, 9) == TRUE);
+	assert(topk_threshold(t) == 1);
+	assert(topk_offer(t, 0) == FALSE);
+	assert(topk_offer(t, 1) == FALSE);	//ties keep the first
+	assert(topk_offer(t, 7) == TRUE);
+	assert(topk_threshold(t) == 5);
+	int out[3];
+	assert(topk_result(t, out) == 3);
+	assert(out[0] == 9 && out[1] == 7 && out[2] == 5);
+	assert(t->seen == 6);
+	free_topk(t);
+
+	// fewer keys than k
+	t = create_topk(10);
+	int few[4] = {3, -2, 8, 3};
+	topk_offer_batch(t, few, 4);
+	int got[10];
+	assert(topk_result(t, got) == 4);
+	assert(got[0] == 8 && got[1] == 3 && got[2] == 3 && got[3] == -2);
+	free_topk(t);
+
+	// a long stream, one at a time, batched, merged and in parallel
+	int n = 200003;
+	int k = 100;
+	int* keys = myMalloc(n * sizeof(int));
+	int i;
+	unsigned int x = 777;
+	for (i = 0; i < n; i++) {
+		x = x * 1103515245 + 12345;
+		keys[i] = (int)x;
+	}
+	keys[n - 1] = INT_MAX;	//last key, and one past the end of a whole SIMD batch
+	int* sorted = myMalloc(n * sizeof(int));
+	memcpy(sorted, keys, n * sizeof(int));
+	qsort(sorted, n, sizeof(int), compare_desc);
+	int* result = myMalloc(k * sizeof(int));
+
+	t = create_topk(k);
+	for (i = 0; i < n; i++) {
+		topk_offer(t, keys[i]);
+	}
+	assert(topk_result(t, result) == k && memcmp(result, sorted, k * sizeof(int)) == 0);
+	free_topk(t);
+
+	t = create_topk(k);
+	topk_offer_batch(t, keys, 1000);
+	topk_offer_batch(t, keys + 1000, n - 1000);
+	assert(t->seen == n);
+	assert(topk_result(t, result) == k && memcmp(result, sorted, k * sizeof(int)) == 0);
+	free_topk(t);
+
+	topk* a = create_topk(k);
+	topk* b = create_topk(k);
+	topk_offer_batch(a, keys, n / 3);
+	topk_offer_batch(b, keys + n / 3, n - n / 3);
+	topk_merge(a, b);
+	assert(a->seen == n);
+	assert(topk_result(a, result) == k && memcmp(result, sorted, k * sizeof(int)) == 0);
+	free_topk(a);
+	free_topk(b);
+
+	int threads;
+	for (threads = 1; threads <= 7; threads++) {
+		t = topk_parallel(keys, n, k, threads);
+		assert(t->seen == n);
+		assert(topk_result(t, result) == k && memcmp(result, sorted, k * sizeof(int)) == 0);
+		free_topk(t);
+	}
+
+	free(result);
+	free(sorted);
+	free(keys);
+	return 0;
+}
+#endif
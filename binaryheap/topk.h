@@ -0,0 +1,95 @@
+#ifndef _topk_h
+#define _topk_h
+
+#include "binaryheap.h"
+
+
+/*
+ * struct defining a top-k selection: the k largest keys of a stream, kept
+ * in a binheap of at most k keys.  The root of that min-heap is the
+ * smallest key kept, the threshold a new key has to beat, so once the
+ * heap is full most keys of a long stream cost one compare against the
+ * root and never touch the heap.  Memory is O(k) however long the
+ * stream.
+ */
+typedef struct topk_struct {
+    int k;              // the number of keys to keep
+    binheap* heap;      // the kept keys, the smallest at the root
+    long long seen;     // keys offered so far
+} topk;
+
+
+
+/**********************************************************
+ * function prototypes
+ ***********************************************************/
+
+/**
+ * Creates and initializes a top-k selection
+ * @param k - the number of largest keys to keep, at least 1
+ * @return a pointer to the newly created selection
+ **/
+topk* create_topk(int k);
+
+/**
+ * Frees all the memory for the selection
+ * @param t - a pointer to the selection to be freed
+ **/
+void free_topk(topk* t);
+
+/**
+ * Gives the key a new key must be larger than to be kept
+ * @param t - a pointer to the selection
+ * @return the smallest key kept once k keys are kept, INT_MIN before
+ **/
+int topk_threshold(topk* t);
+
+/**
+ * Offers one key from the stream.  A key equal to the threshold is not
+ * kept, so ties keep the keys that came first.
+ * @param t - a pointer to the selection
+ * @param key - the key
+ * @return TRUE if the key is now among those kept, FALSE otherwise
+ **/
+int topk_offer(topk* t, int key);
+
+/**
+ * Offers an array of keys, the same as offering each in turn but faster:
+ * keys are compared against the threshold several at a time with SIMD
+ * and only the ones above it go to the heap.
+ * @param t - a pointer to the selection
+ * @param keys - the keys
+ * @param n - the number of keys
+ **/
+void topk_offer_batch(topk* t, const int* keys, long long n);
+
+/**
+ * Offers every key kept by another selection, so into holds the top keys
+ * of both streams
+ * @param into - a pointer to the selection to add to
+ * @param from - a pointer to the selection to read, left unchanged
+ **/
+void topk_merge(topk* into, topk* from);
+
+/**
+ * Copies out the keys kept, largest first
+ * @param t - a pointer to the selection
+ * @param out - room for k keys
+ * @return the number of keys copied, k unless fewer were offered
+ **/
+int topk_result(topk* t, int* out);
+
+/**
+ * Selects the k largest keys of an array with num_threads threads: each
+ * takes a slice into its own selection with topk_offer_batch, then the
+ * selections are merged in pairs, the pairs of each round in parallel.
+ * @param keys - the keys
+ * @param n - the number of keys
+ * @param k - the number of largest keys to keep
+ * @param num_threads - the number of threads
+ * @return a pointer to a new selection holding the result
+ **/
+topk* topk_parallel(const int* keys, long long n, int k, int num_threads);
+
+
+#endif
@@ -20,3 +20,24 @@ void* myMalloc(size_t size) {
     return ptr;
 }
 
+
+
+
+/**
+ * Attempts to resize a block of memory. If reallocation fails, the
+ * program terminates. This function is handy as it handles all
+ * of the error checking that is required each time a user calls
+ * 'realloc'.
+ * @param ptr - the block to resize, or NULL to allocate a new one
+ * @param size - the number of bytes requested
+ * @return a pointer to the resized memory if reallocation is
+ *  successful.
+ **/
+void* myRealloc(void* ptr, size_t size) {
+    void *p;
+    if ((p = realloc(ptr, size)) == NULL) {
+        fprintf(stderr, "Error allocating memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
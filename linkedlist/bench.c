@@ -0,0 +1,271 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "utils.h"
+#include "linkedlist.h"
+#include "idxlist.h"
+#include "deque.h"
+
+
+/**********************************************************
+ * Benchmarks for the linkedlist.  Built as linkedlist_bench
+ * with the BENCH_LINKEDLIST flag, usage:
+ *   linkedlist_bench [benchmark] [n] [threads]
+ ***********************************************************/
+#ifdef BENCH_LINKEDLIST
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+
+static int compare_ints(const void* a, const void* b) {
+	int x = *(const int*)a;
+	int y = *(const int*)b;
+	return (x > y) - (x < y);
+}
+
+
+
+/* qsort hands us pointers to the array slots, which hold the data pointers */
+static int compare_int_ptrs(const void* a, const void* b) {
+	return compare_ints(*(void* const*)a, *(void* const*)b);
+}
+
+
+
+/* relinks the nodes in allocation order and gives them fresh random values,
+ * so every contender starts from the same memory layout */
+static void reset_list(linkedlist* l, llnode** nodes, int* vals, int n) {
+	int i;
+	for (i = 0; i < n; i++) {
+		vals[i] = rand();
+		nodes[i]->data = &vals[i];
+		nodes[i]->prev = (i > 0) ? nodes[i - 1] : NULL;
+		nodes[i]->next = (i < n - 1) ? nodes[i + 1] : NULL;
+	}
+	l->head = nodes[0];
+	l->tail = nodes[n - 1];
+	l->cur = NULL;
+}
+
+
+
+/* compares sort_list, sort_list_parallel and copying the list to an array for qsort */
+static void bench_sort(int n, int threads) {
+	int* vals = myMalloc(n * sizeof(int));
+	llnode** nodes = myMalloc(n * sizeof(llnode*));
+	linkedlist* l = create_linkedlist();
+	double start;
+	int i;
+	for (i = 0; i < n; i++) {
+		append_list(l, &vals[i]);
+		nodes[i] = l->tail;
+	}
+
+	reset_list(l, nodes, vals, n);
+	start = now_seconds();
+	sort_list(l, compare_ints);
+	printf("sort_list            %10i items  %8.3f s\n", n, now_seconds() - start);
+
+	reset_list(l, nodes, vals, n);
+	start = now_seconds();
+	sort_list_parallel(l, compare_ints, threads);
+	printf("sort_list_parallel   %10i items  %8.3f s  (%i threads)\n", n, now_seconds() - start, threads);
+
+	reset_list(l, nodes, vals, n);
+	start = now_seconds();
+	void** arr = myMalloc(n * sizeof(void*));	//copy out, sort, and write back into the nodes
+	llnode* node;
+	i = 0;
+	for (node = l->head; node != NULL; node = node->next) {
+		arr[i++] = node->data;
+	}
+	qsort(arr, n, sizeof(void*), compare_int_ptrs);
+	i = 0;
+	for (node = l->head; node != NULL; node = node->next) {
+		node->data = arr[i++];
+	}
+	free(arr);
+	printf("array + qsort        %10i items  %8.3f s\n", n, now_seconds() - start);
+
+	free_linkedlist(l);
+	free(nodes);
+	free(vals);
+}
+
+
+
+/* compares walking a linkedlist of int pointers with an idxlist of inline ints */
+static void bench_traverse(int n) {
+	int* vals = myMalloc(n * sizeof(int));
+	linkedlist* l = create_linkedlist();
+	idxlist* il = create_idxlist(sizeof(int), 0);
+	int i;
+	for (i = 0; i < n; i++) {	//interleave ends so neither list is in memory order
+		vals[i] = i;
+		if (i % 2 == 0) {
+			append_list(l, &vals[i]);
+			append_idxlist(il, &vals[i]);
+		} else {
+			prepend_list(l, &vals[i]);
+			prepend_idxlist(il, &vals[i]);
+		}
+	}
+
+	long long sum = 0;
+	double start = now_seconds();
+	llnode* node;
+	for (node = l->head; node != NULL; node = node->next) {
+		sum += *(int*)node->data;
+	}
+	printf("linkedlist walk      %10i items  %8.3f s  (sum %lli)\n", n, now_seconds() - start, sum);
+
+	sum = 0;
+	start = now_seconds();
+	void* data;
+	for (data = get_idxlist_head(il); data != NULL; data = get_idxlist_next(il)) {
+		sum += *(int*)data;
+	}
+	printf("idxlist walk         %10i items  %8.3f s  (sum %lli)\n", n, now_seconds() - start, sum);
+
+	compact_idxlist(il);
+	sum = 0;
+	start = now_seconds();
+	for (data = get_idxlist_head(il); data != NULL; data = get_idxlist_next(il)) {
+		sum += *(int*)data;
+	}
+	printf("compacted idxlist    %10i items  %8.3f s  (sum %lli)\n", n, now_seconds() - start, sum);
+	printf("bytes per node: llnode %i + malloc header, idxlist %i\n", (int)sizeof(llnode), (int)il->stride);
+
+	free_idxlist(il);
+	free_linkedlist(l);
+	free(vals);
+}
+
+
+
+/* compares queue (append + remove head) and stack (prepend + remove head) traffic */
+static void bench_ends(int n) {
+	int* vals = myMalloc(n * sizeof(int));
+	int i, round;
+	for (i = 0; i < n; i++) {
+		vals[i] = i;
+	}
+	int batch = 1024;	//items in flight, so the structures stay small and hot
+	int rounds = n / batch;
+
+	linkedlist* l = create_linkedlist();
+	double start = now_seconds();
+	for (round = 0; round < rounds; round++) {
+		for (i = 0; i < batch; i++) {
+			append_list(l, &vals[round * batch + i]);
+		}
+		for (i = 0; i < batch; i++) {
+			remove_list_head(l);
+		}
+	}
+	printf("linkedlist queue     %10i items  %8.3f s\n", rounds * batch, now_seconds() - start);
+	start = now_seconds();
+	for (round = 0; round < rounds; round++) {
+		for (i = 0; i < batch; i++) {
+			prepend_list(l, &vals[round * batch + i]);
+		}
+		for (i = 0; i < batch; i++) {
+			remove_list_head(l);
+		}
+	}
+	printf("linkedlist stack     %10i items  %8.3f s\n", rounds * batch, now_seconds() - start);
+	free_linkedlist(l);
+
+	deque* dq = create_deque(0);
+	start = now_seconds();
+	for (round = 0; round < rounds; round++) {
+		for (i = 0; i < batch; i++) {
+			append_deque(dq, &vals[round * batch + i]);
+		}
+		for (i = 0; i < batch; i++) {
+			remove_deque_head(dq);
+		}
+	}
+	printf("deque queue          %10i items  %8.3f s\n", rounds * batch, now_seconds() - start);
+	start = now_seconds();
+	for (round = 0; round < rounds; round++) {
+		for (i = 0; i < batch; i++) {
+			prepend_deque(dq, &vals[round * batch + i]);
+		}
+		for (i = 0; i < batch; i++) {
+			remove_deque_head(dq);
+		}
+	}
+	printf("deque stack          %10i items  %8.3f s\n", rounds * batch, now_seconds() - start);
+	free_deque(dq);
+
+	free(vals);
+}
+
+
+
+/* compares building a list one append_list at a time with append_list_array */
+static void bench_load(int n) {
+	int* vals = myMalloc(n * sizeof(int));
+	void** items = myMalloc(n * sizeof(void*));
+	int i;
+	for (i = 0; i < n; i++) {
+		vals[i] = i;
+		items[i] = &vals[i];
+	}
+
+	double start = now_seconds();
+	linkedlist* l = create_linkedlist();
+	for (i = 0; i < n; i++) {
+		append_list(l, items[i]);
+	}
+	printf("append_list          %10i items  %8.3f s\n", n, now_seconds() - start);
+	start = now_seconds();
+	free_linkedlist(l);
+	printf("  free               %10i items  %8.3f s\n", n, now_seconds() - start);
+
+	start = now_seconds();
+	l = create_linkedlist();
+	append_list_array(l, items, n);
+	printf("append_list_array    %10i items  %8.3f s\n", n, now_seconds() - start);
+	start = now_seconds();
+	list_to_array(l, items);
+	printf("list_to_array        %10i items  %8.3f s\n", n, now_seconds() - start);
+	start = now_seconds();
+	free_linkedlist(l);
+	printf("  free               %10i items  %8.3f s\n", n, now_seconds() - start);
+
+	free(items);
+	free(vals);
+}
+
+
+
+int main(int argc, char** argv) {
+	const char* which = (argc > 1) ? argv[1] : "all";
+	int n = (argc > 2) ? atoi(argv[2]) : 1000000;
+	int threads = (argc > 3) ? atoi(argv[3]) : 4;
+	int all = (strcmp(which, "all") == 0);
+
+	srand(42);
+	if (all || strcmp(which, "sort") == 0) {
+		bench_sort(n, threads);
+	}
+	if (all || strcmp(which, "traverse") == 0) {
+		bench_traverse(n);
+	}
+	if (all || strcmp(which, "ends") == 0) {
+		bench_ends(n);
+	}
+	if (all || strcmp(which, "load") == 0) {
+		bench_load(n);
+	}
+	return 0;
+}
+#endif
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "utils.h"
+#include "deque.h"
+
+#define SLOT(dq, i) (((dq)->first + (i)) & ((dq)->capacity - 1))
+
+
+/* moves the items into a buffer of new_capacity slots, unwrapping them so the head is slot 0 */
+static void resize_deque(deque* dq, int new_capacity) {
+	void** items = myMalloc(new_capacity * sizeof(void*));
+	int head_part = dq->capacity - dq->first;	//items from first up to the end of the old buffer
+	if (head_part > dq->size) {
+		head_part = dq->size;
+	}
+	if (dq->size > 0) {
+		memcpy(items, dq->items + dq->first, head_part * sizeof(void*));
+		memcpy(items + head_part, dq->items, (dq->size - head_part) * sizeof(void*));
+	}
+	free(dq->items);
+	dq->items = items;
+	dq->capacity = new_capacity;
+	dq->first = 0;
+}
+
+
+
+/**********************************************************
+ * Functions for the deque
+ ***********************************************************/
+
+deque* create_deque(int capacity) {
+	deque* dq = myMalloc(sizeof(deque));
+	int cap = 8;
+	while (cap < capacity) {
+		cap = cap * 2;
+	}
+	dq->size = 0;
+	dq->capacity = cap;
+	dq->first = 0;
+	dq->items = myMalloc(cap * sizeof(void*));
+	return dq;
+}
+
+
+
+void free_deque(deque* dq) {
+	free(dq->items);
+	free(dq);
+}
+
+
+
+int is_deque_empty(deque* dq) {
+	if (dq->size == 0) {
+		return TRUE;
+	} else {
+		return FALSE;
+	}
+}
+
+
+
+void clear_deque(deque* dq) {
+	dq->size = 0;
+	dq->first = 0;
+}
+
+
+
+void reserve_deque(deque* dq, int capacity) {
+	int cap = dq->capacity;
+	while (cap < capacity) {
+		cap = cap * 2;
+	}
+	if (cap != dq->capacity) {
+		resize_deque(dq, cap);
+	}
+}
+
+
+
+void append_deque(deque* dq, void* data) {
+	if (dq->size == dq->capacity) {
+		resize_deque(dq, dq->capacity * 2);
+	}
+	dq->items[SLOT(dq, dq->size)] = data;
+	dq->size = dq->size + 1;
+}
+
+
+
+void prepend_deque(deque* dq, void* data) {
+	if (dq->size == dq->capacity) {
+		resize_deque(dq, dq->capacity * 2);
+	}
+	dq->first = (dq->first - 1) & (dq->capacity - 1);
+	dq->items[dq->first] = data;
+	dq->size = dq->size + 1;
+}
+
+
+
+void* remove_deque_head(deque* dq) {
+	if (dq->size == 0) {
+		return NULL;
+	}
+	void* data = dq->items[dq->first];
+	dq->first = (dq->first + 1) & (dq->capacity - 1);
+	dq->size = dq->size - 1;
+	return data;
+}
+
+
+
+void* remove_deque_tail(deque* dq) {
+	if (dq->size == 0) {
+		return NULL;
+	}
+	dq->size = dq->size - 1;
+	return dq->items[SLOT(dq, dq->size)];
+}
+
+
+
+void* get_deque_head(deque* dq) {
+	return get_deque_at(dq, 0);
+}
+
+
+
+void* get_deque_tail(deque* dq) {
+	return get_deque_at(dq, dq->size - 1);
+}
+
+
+
+void* get_deque_at(deque* dq, int index) {
+	if (index < 0 || index >= dq->size) {
+		return NULL;
+	}
+	return dq->items[SLOT(dq, index)];
+}
+
+
+
+void set_deque_at(deque* dq, int index, void* data) {
+	assert(index >= 0 && index < dq->size);
+	dq->items[SLOT(dq, index)] = data;
+}
+
+
+
+/**
+ * IMPORTANT: This function is used for debugging and can assume
+ * that all data stored in the deque are integers.
+ **/
+void print_deque(deque* dq) {
+	int i;
+	printf("Deque: ");
+	for (i = 0; i < dq->size; i++) {
+		printf("%i -> ", *(int*)get_deque_at(dq, i));
+	}
+	printf("NULL \n\n");
+}
+
+
+
+/**********************************************************
+ * The following main function is for debugging this
+ * deque.  Supply the DEBUG_DEQUE flag to the compiler
+ * to compile a deque containing this main function.
+ ***********************************************************/
+#ifdef DEBUG_DEQUE
+int main(void) {
+	printf("===============\n");
+	printf("Debugging deque\n");
+	printf("===============\n");
+
+	int vals[20];
+	int i;
+	for (i = 0; i < 20; i++) {
+		vals[i] = i;
+	}
+
+	deque* dq = create_deque(0);
+	assert(is_deque_empty(dq) == TRUE);
+	assert(remove_deque_head(dq) == NULL);
+	assert(remove_deque_tail(dq) == NULL);
+	print_deque(dq);
+
+	printf("Appending 5..9 and prepending 4..0\n");
+	for (i = 5; i < 10; i++) {
+		append_deque(dq, &vals[i]);
+	}
+	for (i = 4; i >= 0; i--) {	//wraps around the front of the buffer
+		prepend_deque(dq, &vals[i]);
+	}
+	print_deque(dq);
+	assert(dq->size == 10);
+	assert(dq->capacity == 16);
+	for (i = 0; i < 10; i++) {
+		assert(get_deque_at(dq, i) == &vals[i]);
+	}
+	assert(get_deque_at(dq, 10) == NULL);
+	assert(get_deque_head(dq) == &vals[0]);
+	assert(get_deque_tail(dq) == &vals[9]);
+
+	printf("Removing head and tail\n");
+	assert(remove_deque_head(dq) == &vals[0]);
+	assert(remove_deque_tail(dq) == &vals[9]);
+	set_deque_at(dq, 0, &vals[19]);
+	print_deque(dq);
+	assert(dq->size == 8);
+
+	printf("Growing while wrapped\n");
+	for (i = 10; i < 19; i++) {
+		append_deque(dq, &vals[i]);
+	}
+	print_deque(dq);
+	assert(dq->size == 17);
+	assert(dq->capacity == 32);
+	assert(get_deque_head(dq) == &vals[19]);
+	assert(get_deque_at(dq, 1) == &vals[2]);
+	assert(get_deque_tail(dq) == &vals[18]);
+
+	while (remove_deque_tail(dq) != NULL) { }
+	assert(is_deque_empty(dq) == TRUE);
+	reserve_deque(dq, 100);
+	assert(dq->capacity == 128);
+	free_deque(dq);
+
+	return 0;
+}
+#endif
@@ -0,0 +1,125 @@
+#ifndef _deque_h
+#define _deque_h
+
+
+/*
+ * struct defining a double-ended queue stored in a circular buffer.  The
+ * capacity is always a power of two so a position wraps with a mask instead
+ * of a division, and the buffer doubles when it fills.  It offers the same
+ * end operations as the linkedlist without allocating per item.
+ */
+typedef struct deque_struct {
+    int size;        // the number of items in the deque
+    int capacity;    // the number of slots in items, a power of two
+    int first;       // slot holding the head of the deque
+    void** items;    // the circular buffer of data pointers
+} deque;
+
+
+
+/**********************************************************
+* function prototypes
+***********************************************************/
+
+/**
+ * Creates and initializes a deque.
+ * @param capacity - the number of items to make room for up front, rounded
+ *  up to a power of two
+ * @return a pointer to the newly created deque
+ **/
+deque* create_deque(int capacity);
+
+/**
+ * Frees the memory for the deque.  The data items are not freed.
+ * @param dq - a pointer to the deque to be freed
+ **/
+void free_deque(deque* dq);
+
+/**
+ * Checks to see if the deque is empty
+ * @param dq - a pointer to the deque to check
+ * @return TRUE if empty, FALSE otherwise
+ **/
+int is_deque_empty(deque* dq);
+
+/**
+ * Removes all items from the deque, keeping its buffer
+ * @param dq - a pointer to the deque to clear
+ **/
+void clear_deque(deque* dq);
+
+/**
+ * Makes sure the deque can hold at least capacity items without growing
+ * @param dq - a pointer to the deque
+ * @param capacity - the number of items to make room for
+ **/
+void reserve_deque(deque* dq, int capacity);
+
+/**
+ * Adds the data to the tail of the deque
+ * @param dq - a pointer to the deque to append the data
+ * @param data - the data to append to the deque
+ **/
+void append_deque(deque* dq, void* data);
+
+/**
+ * Adds the data to the head of the deque
+ * @param dq - a pointer to the deque to prepend the data
+ * @param data - the data to prepend to the deque
+ **/
+void prepend_deque(deque* dq, void* data);
+
+/**
+ * Removes the data at the head of the deque
+ * @param dq - a pointer to the deque from which to remove the head
+ * @return the data at the head of the deque, NULL if the deque is empty
+ **/
+void* remove_deque_head(deque* dq);
+
+/**
+ * Removes the data at the tail of the deque
+ * @param dq - a pointer to the deque from which to remove the tail
+ * @return the data at the tail of the deque, NULL if the deque is empty
+ **/
+void* remove_deque_tail(deque* dq);
+
+/**
+ * Get the data at the head of the deque without removing it
+ * @param dq - a pointer to the deque
+ * @return the data at the head of the deque, NULL if the deque is empty
+ **/
+void* get_deque_head(deque* dq);
+
+/**
+ * Get the data at the tail of the deque without removing it
+ * @param dq - a pointer to the deque
+ * @return the data at the tail of the deque, NULL if the deque is empty
+ **/
+void* get_deque_tail(deque* dq);
+
+/**
+ * Get the data at a position counted from the head of the deque
+ * @param dq - a pointer to the deque
+ * @param index - position of the item, 0 is the head
+ * @return the data at that position, NULL if index is out of range
+ **/
+void* get_deque_at(deque* dq, int index);
+
+/**
+ * Replace the data at a position counted from the head of the deque
+ * @param dq - a pointer to the deque
+ * @param index - position of the item, 0 is the head, must be in range
+ * @param data - the data to store at that position
+ **/
+void set_deque_at(deque* dq, int index, void* data);
+
+/**
+ * Print the data of each item of the deque, head to tail.
+ * IMPORTANT: This function is used for debugging and can assume
+ * that all data stored in the deque are integers.
+ * @param dq - a pointer to the deque to print
+ **/
+void print_deque(deque* dq);
+
+
+#endif
@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "utils.h"
+#include "idxlist.h"
+
+#define LINK_BYTES (2 * sizeof(uint32_t))
+
+#define NODE(l, s) ((l)->nodes + (size_t)(s) * (l)->stride)
+#define PREV(l, s) (((uint32_t*)NODE(l, s))[0])
+#define NEXT(l, s) (((uint32_t*)NODE(l, s))[1])
+#define DATA(l, s) (NODE(l, s) + LINK_BYTES)
+
+
+/**********************************************************
+ * Helpers for managing the node array
+ ***********************************************************/
+
+/* hands out an unused slot, from the free chain first, growing the array if full */
+static uint32_t alloc_slot(idxlist* lst) {
+	if (lst->free_slot != IDXLIST_NIL) {
+		uint32_t s = lst->free_slot;
+		lst->free_slot = NEXT(lst, s);
+		return s;
+	}
+	if (lst->used == lst->capacity) {
+		uint32_t cap = (lst->capacity < 8) ? 16 : lst->capacity * 2;
+		if (cap <= lst->capacity || cap >= IDXLIST_NIL) {	//out of 32-bit slots
+			cap = IDXLIST_NIL - 1;
+			if (cap == lst->capacity) {
+				fprintf(stderr, "idxlist is full.\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+		lst->nodes = myRealloc(lst->nodes, (size_t)cap * lst->stride);
+		lst->capacity = cap;
+	}
+	return lst->used++;
+}
+
+
+
+/* pushes a slot onto the free chain */
+static void release_slot(idxlist* lst, uint32_t s) {
+	NEXT(lst, s) = lst->free_slot;
+	lst->free_slot = s;
+}
+
+
+
+/**********************************************************
+ * Functions for the idxlist
+ ***********************************************************/
+
+idxlist* create_idxlist(size_t elem_size, uint32_t capacity) {
+	idxlist* l = myMalloc(sizeof(idxlist));
+	size_t align = (elem_size >= 8) ? 8 : sizeof(uint32_t);	//keep pointer sized payloads aligned
+	l->elem_size = elem_size;
+	l->stride = (LINK_BYTES + elem_size + align - 1) / align * align;
+	l->capacity = capacity;
+	l->nodes = (capacity > 0) ? myMalloc((size_t)capacity * l->stride) : NULL;
+	l->size = 0;
+	l->used = 0;
+	l->free_slot = IDXLIST_NIL;
+	l->head = IDXLIST_NIL;
+	l->tail = IDXLIST_NIL;
+	l->cur = IDXLIST_NIL;
+	return l;
+}
+
+
+
+void free_idxlist(idxlist* lst) {
+	free(lst->nodes);
+	free(lst);
+}
+
+
+
+int is_idxlist_empty(idxlist* lst) {
+	return lst->size == 0;
+}
+
+
+
+void clear_idxlist(idxlist* lst) {
+	lst->size = 0;
+	lst->used = 0;
+	lst->free_slot = IDXLIST_NIL;
+	lst->head = IDXLIST_NIL;
+	lst->tail = IDXLIST_NIL;
+	lst->cur = IDXLIST_NIL;
+}
+
+
+
+uint32_t append_idxlist(idxlist* lst, const void* elem) {
+	uint32_t s = alloc_slot(lst);
+	memcpy(DATA(lst, s), elem, lst->elem_size);
+	PREV(lst, s) = lst->tail;
+	NEXT(lst, s) = IDXLIST_NIL;
+	if (lst->size == 0) {
+		lst->head = s;
+	} else {
+		NEXT(lst, lst->tail) = s;
+	}
+	lst->tail = s;
+	lst->size = lst->size + 1;
+	return s;
+}
+
+
+
+uint32_t prepend_idxlist(idxlist* lst, const void* elem) {
+	uint32_t s = alloc_slot(lst);
+	memcpy(DATA(lst, s), elem, lst->elem_size);
+	PREV(lst, s) = IDXLIST_NIL;
+	NEXT(lst, s) = lst->head;
+	if (lst->size == 0) {
+		lst->tail = s;
+	} else {
+		PREV(lst, lst->head) = s;
+	}
+	lst->head = s;
+	lst->size = lst->size + 1;
+	return s;
+}
+
+
+
+uint32_t insert_idxlist_after(idxlist* lst, uint32_t slot, const void* elem) {
+	if (slot == lst->tail) {
+		return append_idxlist(lst, elem);
+	}
+	uint32_t s = alloc_slot(lst);
+	uint32_t next = NEXT(lst, slot);
+	memcpy(DATA(lst, s), elem, lst->elem_size);
+	PREV(lst, s) = slot;
+	NEXT(lst, s) = next;
+	PREV(lst, next) = s;
+	NEXT(lst, slot) = s;
+	lst->size = lst->size + 1;
+	return s;
+}
+
+
+
+void remove_idxlist_slot(idxlist* lst, uint32_t slot, void* out) {
+	uint32_t prev = PREV(lst, slot);
+	uint32_t next = NEXT(lst, slot);
+	if (out != NULL) {
+		memcpy(out, DATA(lst, slot), lst->elem_size);
+	}
+	if (prev == IDXLIST_NIL) {
+		lst->head = next;
+	} else {
+		NEXT(lst, prev) = next;
+	}
+	if (next == IDXLIST_NIL) {
+		lst->tail = prev;
+	} else {
+		PREV(lst, next) = prev;
+	}
+	if (lst->cur == slot) {
+		lst->cur = IDXLIST_NIL;
+	}
+	release_slot(lst, slot);
+	lst->size = lst->size - 1;
+}
+
+
+
+int remove_idxlist_head(idxlist* lst, void* out) {
+	if (lst->size == 0) {
+		return FALSE;
+	}
+	remove_idxlist_slot(lst, lst->head, out);
+	return TRUE;
+}
+
+
+
+int remove_idxlist_tail(idxlist* lst, void* out) {
+	if (lst->size == 0) {
+		return FALSE;
+	}
+	remove_idxlist_slot(lst, lst->tail, out);
+	return TRUE;
+}
+
+
+
+void* get_idxlist_data(idxlist* lst, uint32_t slot) {
+	return DATA(lst, slot);
+}
+
+
+
+void compact_idxlist(idxlist* lst) {
+	if (lst->capacity == 0) {
+		return;
+	}
+	unsigned char* packed = myMalloc((size_t)lst->capacity * lst->stride);
+	uint32_t cur = IDXLIST_NIL;
+	uint32_t s = lst->head;
+	uint32_t i;
+	for (i = 0; i < lst->size; i++) {	//copy the nodes out in list order
+		unsigned char* n = packed + (size_t)i * lst->stride;
+		((uint32_t*)n)[0] = (i == 0) ? IDXLIST_NIL : i - 1;
+		((uint32_t*)n)[1] = (i == lst->size - 1) ? IDXLIST_NIL : i + 1;
+		memcpy(n + LINK_BYTES, DATA(lst, s), lst->elem_size);
+		if (s == lst->cur) {
+			cur = i;
+		}
+		s = NEXT(lst, s);
+	}
+	free(lst->nodes);
+	lst->nodes = packed;
+	lst->used = lst->size;
+	lst->free_slot = IDXLIST_NIL;
+	lst->head = (lst->size > 0) ? 0 : IDXLIST_NIL;
+	lst->tail = (lst->size > 0) ? lst->size - 1 : IDXLIST_NIL;
+	lst->cur = cur;
+}
+
+
+
+/**********************************************************
+ * Functions for the iterator portion of the idxlist
+ ***********************************************************/
+
+void* get_idxlist_head(idxlist* lst) {
+	lst->cur = lst->head;
+	return (lst->cur == IDXLIST_NIL) ? NULL : DATA(lst, lst->cur);
+}
+
+
+
+void* get_idxlist_tail(idxlist* lst) {
+	lst->cur = lst->tail;
+	return (lst->cur == IDXLIST_NIL) ? NULL : DATA(lst, lst->cur);
+}
+
+
+
+void* get_idxlist_next(idxlist* lst) {
+	if (lst->cur == IDXLIST_NIL || lst->cur == lst->tail) {
+		return NULL;
+	}
+	lst->cur = NEXT(lst, lst->cur);
+	return DATA(lst, lst->cur);
+}
+
+
+
+void* get_idxlist_prev(idxlist* lst) {
+	if (lst->cur == IDXLIST_NIL || lst->cur == lst->head) {
+		return NULL;
+	}
+	lst->cur = PREV(lst, lst->cur);
+	return DATA(lst, lst->cur);
+}
+
+
+
+/**
+ * IMPORTANT: This function is used for debugging and can assume
+ * that all payloads stored in the idxlist are ints.
+ **/
+void print_idxlist(idxlist* lst) {
+	uint32_t tmp = lst->cur;	// save the current state of the iterator
+
+	printf("List: ");
+	void* data = get_idxlist_head(lst);
+	while (data != NULL) {
+		printf("%i -> ", *(int*)data);
+		data = get_idxlist_next(lst);
+	}
+	printf("NULL \n\n");
+	lst->cur = tmp;	// restore the state of the iterator
+}
+
+
+
+/**********************************************************
+ * The following main function is for debugging this
+ * idxlist.  Supply the DEBUG_IDXLIST flag to the compiler
+ * to compile an idxlist containing this main function.
+ ***********************************************************/
+#ifdef DEBUG_IDXLIST
+int main(void) {
+	printf("=================\n");
+	printf("Debugging idxlist\n");
+	printf("=================\n");
+
+	idxlist* l = create_idxlist(sizeof(int), 2);	// ints are stored inline
+	printf("Node size is %i bytes\n", (int)l->stride);
+	assert(l->stride == 12);
+	assert(is_idxlist_empty(l));
+	print_idxlist(l);
+
+	int i;
+	for (i = 1; i <= 5; i++) {	//grows past the initial capacity
+		append_idxlist(l, &i);
+	}
+	int zero = 0;
+	prepend_idxlist(l, &zero);
+	print_idxlist(l);
+	assert(l->size == 6);
+	assert(*(int*)get_idxlist_data(l, l->head) == 0);
+	assert(*(int*)get_idxlist_data(l, l->tail) == 5);
+
+	int out = -1;
+	assert(remove_idxlist_head(l, &out) == TRUE && out == 0);
+	assert(remove_idxlist_tail(l, &out) == TRUE && out == 5);
+	print_idxlist(l);
+
+	printf("Removing 3 and inserting 30 after 2\n");
+	get_idxlist_head(l);
+	get_idxlist_next(l);
+	uint32_t two = l->cur;
+	assert(*(int*)get_idxlist_next(l) == 3);
+	remove_idxlist_slot(l, l->cur, NULL);
+	int thirty = 30;
+	uint32_t s = insert_idxlist_after(l, two, &thirty);
+	print_idxlist(l);
+	assert(s < 6);	//reused a freed slot instead of growing
+	assert(*(int*)get_idxlist_tail(l) == 4);
+	assert(*(int*)get_idxlist_prev(l) == 30);
+	assert(*(int*)get_idxlist_prev(l) == 2);
+
+	printf("Compacting\n");
+	compact_idxlist(l);
+	print_idxlist(l);
+	assert(l->head == 0 && l->tail == 3);
+	assert(*(int*)get_idxlist_data(l, 2) == 30);
+	assert(*(int*)get_idxlist_data(l, l->cur) == 2);
+
+	while (remove_idxlist_tail(l, NULL)) { }
+	assert(is_idxlist_empty(l));
+	print_idxlist(l);
+	free_idxlist(l);
+
+	l = create_idxlist(sizeof(void*), 0);	// pointers, like a linkedlist
+	printf("Node size for pointer payloads is %i bytes\n", (int)l->stride);
+	void* p = &thirty;
+	append_idxlist(l, &p);
+	assert(*(void**)get_idxlist_head(l) == &thirty);
+	free_idxlist(l);
+
+	return 0;
+}
+#endif
@@ -0,0 +1,178 @@
+#ifndef _idxlist_h
+#define _idxlist_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define IDXLIST_NIL UINT32_MAX   // link value meaning "no node"
+
+
+/*
+ * struct defining a doubly-linked list whose nodes live in one growable
+ * array and are linked by 32-bit slot indices.  Each node is laid out as
+ * [uint32 prev][uint32 next][payload of elem_size bytes], so an int payload
+ * takes 12 bytes per node and a pointer payload 16 bytes, compared with the
+ * 24 byte llnode plus its malloc header.  Removed slots are kept on a free
+ * chain (linked through next) and reused by later insertions.
+ */
+typedef struct idxlist_struct {
+    uint32_t size;        // the number of items in the list
+    uint32_t capacity;    // the number of node slots allocated
+    uint32_t used;        // the number of slots ever handed out, slots >= used are untouched
+    uint32_t free_slot;   // first slot of the free chain, IDXLIST_NIL if empty
+    uint32_t head;        // slot of the head of the list
+    uint32_t tail;        // slot of the tail of the list
+    uint32_t cur;         // slot of the current iterator item
+    size_t elem_size;     // bytes of payload stored inline in each node
+    size_t stride;        // bytes per node, links plus padded payload
+    unsigned char* nodes; // the node array
+} idxlist;
+
+
+
+/**********************************************************
+* function prototypes
+***********************************************************/
+
+/**
+ * Creates and initializes an index-linked list.
+ * @param elem_size - the number of payload bytes copied into each node, use
+ *  sizeof(void*) to store pointers like a linkedlist does
+ * @param capacity - the number of nodes to allocate room for up front (the
+ *  node array grows by doubling when it fills)
+ * @return a pointer to the newly created idxlist
+ **/
+idxlist* create_idxlist(size_t elem_size, uint32_t capacity);
+
+/**
+ * Frees the node array and the idxlist itself
+ * @param lst - a pointer to the idxlist to be freed
+ **/
+void free_idxlist(idxlist* lst);
+
+/**
+ * Checks to see if the idxlist is empty
+ * @param lst - a pointer to the idxlist to check
+ * @return TRUE if empty, FALSE otherwise
+ **/
+int is_idxlist_empty(idxlist* lst);
+
+/**
+ * Removes all items from the idxlist, keeping the node array for reuse
+ * @param lst - a pointer to the idxlist to clear
+ **/
+void clear_idxlist(idxlist* lst);
+
+/**
+ * Copies elem into a new node at the end of the list
+ * @param lst - a pointer to the idxlist to append to
+ * @param elem - pointer to elem_size bytes to store
+ * @return the slot of the new node
+ **/
+uint32_t append_idxlist(idxlist* lst, const void* elem);
+
+/**
+ * Copies elem into a new node at the front of the list
+ * @param lst - a pointer to the idxlist to prepend to
+ * @param elem - pointer to elem_size bytes to store
+ * @return the slot of the new node
+ **/
+uint32_t prepend_idxlist(idxlist* lst, const void* elem);
+
+/**
+ * Copies elem into a new node placed right after the node in slot
+ * @param lst - a pointer to the idxlist to insert into
+ * @param slot - slot of a node in the list
+ * @param elem - pointer to elem_size bytes to store
+ * @return the slot of the new node
+ **/
+uint32_t insert_idxlist_after(idxlist* lst, uint32_t slot, const void* elem);
+
+/**
+ * Unlinks the node in slot and puts the slot on the free chain.  If the
+ * iterator was on that node it is reset.
+ * @param lst - a pointer to the idxlist to remove from
+ * @param slot - slot of a node in the list
+ * @param out - if not NULL, receives a copy of the removed payload
+ **/
+void remove_idxlist_slot(idxlist* lst, uint32_t slot, void* out);
+
+/**
+ * Removes the head of the list
+ * @param lst - a pointer to the idxlist from which to remove the head
+ * @param out - if not NULL, receives a copy of the removed payload
+ * @return TRUE if a node was removed, FALSE if the list is empty
+ **/
+int remove_idxlist_head(idxlist* lst, void* out);
+
+/**
+ * Removes the tail of the list
+ * @param lst - a pointer to the idxlist from which to remove the tail
+ * @param out - if not NULL, receives a copy of the removed payload
+ * @return TRUE if a node was removed, FALSE if the list is empty
+ **/
+int remove_idxlist_tail(idxlist* lst, void* out);
+
+/**
+ * Gets the payload stored in slot.  The pointer refers into the node array
+ * and is only valid until the next insertion, which may grow the array.
+ * @param lst - a pointer to the idxlist
+ * @param slot - slot of a node in the list
+ * @return a pointer to the payload of that node
+ **/
+void* get_idxlist_data(idxlist* lst, uint32_t slot);
+
+/**
+ * Rewrites the node array so the nodes are stored in list order and the free
+ * chain is dropped.  Traversals afterwards walk memory sequentially.  Slot
+ * numbers handed out before this call are no longer valid.
+ * @param lst - a pointer to the idxlist to compact
+ **/
+void compact_idxlist(idxlist* lst);
+
+
+
+/**********************************************************
+* function prototypes for iterator portion of idxlist
+***********************************************************/
+
+/**
+ * Moves the iterator to the head of the list
+ * @param lst - a pointer to the idxlist
+ * @return a pointer to the payload of the head, NULL if the list is empty
+ **/
+void* get_idxlist_head(idxlist* lst);
+
+/**
+ * Moves the iterator to the tail of the list
+ * @param lst - a pointer to the idxlist
+ * @return a pointer to the payload of the tail, NULL if the list is empty
+ **/
+void* get_idxlist_tail(idxlist* lst);
+
+/**
+ * Advances the iterator one node.  Should only be used after the iterator is
+ * initialized by get_idxlist_head or get_idxlist_tail.
+ * @param lst - a pointer to the idxlist
+ * @return a pointer to the payload of the next node, NULL at the end
+ **/
+void* get_idxlist_next(idxlist* lst);
+
+/**
+ * Moves the iterator back one node.  Should only be used after the iterator
+ * is initialized by get_idxlist_head or get_idxlist_tail.
+ * @param lst - a pointer to the idxlist
+ * @return a pointer to the payload of the previous node, NULL at the start
+ **/
+void* get_idxlist_prev(idxlist* lst);
+
+/**
+ * Print the payload of each node of the idxlist.
+ * IMPORTANT: This function is used for debugging and assumes the payloads
+ * are ints stored inline (elem_size == sizeof(int)).
+ * @param lst - a pointer to the idxlist to print
+ **/
+void print_idxlist(idxlist* lst);
+
+
+#endif
@@ -1,8 +1,14 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
 #include "utils.h"
 #include "linkedlist.h"
 
+#define LLBLOCK_MIN 4	// nodes in the first block a list carves its single inserts from
+#define LLBLOCK_MAX 256	// the most nodes such a block gets, later ones match the list's size
+
 
 /**********************************************************
  * Functions for the linkedlist
@@ -13,6 +19,9 @@ linkedlist* create_linkedlist() {
     l->head = NULL;
     l->tail = NULL;
     l->cur  = NULL;
+    l->blocks = NULL;
+    l->spare = NULL;
+    l->index = NULL;
     return l;
 }
 
@@ -34,18 +43,208 @@ void free_llnode(llnode* node) {
 
 
 
-void free_linkedlist(linkedlist* lst) {
-    if (lst->size > 0) {
+/* allocates a block of count nodes and hands it to lst, the nodes are left unset */
+static llblock* alloc_llblock(linkedlist* lst, int count) {
+	llblock* b = myMalloc(sizeof(llblock) + count * sizeof(llnode));
+	b->next = lst->blocks;
+	lst->blocks = b;
+	return b;
+}
+
+
+
+/* takes a spare node of lst for data, carving a new block when there is none */
+static llnode* take_llnode(linkedlist* lst, void* data) {
+	if (lst->spare == NULL) {	//blocks grow with the list, so a node costs amortized O(1) and no malloc header
+		int count = (lst->size < LLBLOCK_MIN) ? LLBLOCK_MIN : lst->size;
+		count = (count > LLBLOCK_MAX) ? LLBLOCK_MAX : count;
+		llblock* b = alloc_llblock(lst, count);
 		int i;
-		int s = lst->size;
-		for(i = 1; i < s; i++) {
-			lst->tail = lst->tail->prev;	//move tail back
-			free_llnode(lst->tail->next);	//free the unneeded node
-			lst->size = lst->size - 1;
+		for (i = 0; i < count; i++) {
+			b->nodes[i].next = (i < count - 1) ? &b->nodes[i + 1] : NULL;
+		}
+		lst->spare = &b->nodes[0];
+	}
+	llnode* n = lst->spare;
+	lst->spare = n->next;
+	n->data = data;
+	n->prev = NULL;
+	n->next = NULL;
+	return n;
+}
+
+
+
+/* keeps a node removed from lst for the next insert, its block is freed by clear_list */
+static void release_llnode(linkedlist* lst, llnode* node) {
+	node->next = lst->spare;
+	lst->spare = node;
+}
+
+
+
+/**********************************************************
+ * Helpers that keep the positional index in step with the
+ * head and tail operations
+ ***********************************************************/
+
+#define LLINDEX_MIN_TARGET 16	// shortest preferred segment length
+
+/* marks the index stale after an edit it doesn't track */
+static void index_invalidate(linkedlist* lst) {
+	if (lst->index != NULL) {
+		lst->index->valid = FALSE;
+	}
+}
+
+
+
+static void index_reserve(llindex* idx, int count) {
+	if (count > idx->capacity) {
+		int cap = (idx->capacity < 8) ? 8 : idx->capacity;
+		while (cap < count) {
+			cap = cap * 2;
+		}
+		idx->first = myRealloc(idx->first, cap * sizeof(llnode*));
+		idx->len = myRealloc(idx->len, cap * sizeof(int));
+		idx->capacity = cap;
+	}
+}
+
+
+
+/* recuts the whole list into segments of about sqrt(size) nodes */
+static void index_rebuild(linkedlist* lst) {
+	llindex* idx = lst->index;
+	int target = LLINDEX_MIN_TARGET;
+	while (target * target < lst->size) {
+		target = target + 1;
+	}
+	idx->target = target;
+	idx->count = 0;
+	index_reserve(idx, lst->size / target + 1);
+	llnode* n = lst->head;
+	int i = 0;
+	for (n = lst->head; n != NULL; n = n->next) {
+		if (i % target == 0) {
+			idx->first[idx->count] = n;
+			idx->len[idx->count] = 0;
+			idx->count = idx->count + 1;
+		}
+		idx->len[idx->count - 1] = idx->len[idx->count - 1] + 1;
+		i = i + 1;
+	}
+	idx->valid = TRUE;
+}
+
+
+
+/* opens a hole for a segment at s, or closes the one there */
+static void index_insert_segment(llindex* idx, int s, llnode* first, int len) {
+	index_reserve(idx, idx->count + 1);
+	memmove(idx->first + s + 1, idx->first + s, (idx->count - s) * sizeof(llnode*));
+	memmove(idx->len + s + 1, idx->len + s, (idx->count - s) * sizeof(int));
+	idx->first[s] = first;
+	idx->len[s] = len;
+	idx->count = idx->count + 1;
+}
+
+
+
+static void index_remove_segment(llindex* idx, int s) {
+	memmove(idx->first + s, idx->first + s + 1, (idx->count - s - 1) * sizeof(llnode*));
+	memmove(idx->len + s, idx->len + s + 1, (idx->count - s - 1) * sizeof(int));
+	idx->count = idx->count - 1;
+}
+
+
+
+/* called after segment s grew, splits it in half once it is twice the target length */
+static void index_grew(linkedlist* lst, int s) {
+	llindex* idx = lst->index;
+	if (idx->len[s] <= 2 * idx->target) {
+		return;
+	}
+	if (idx->count >= 4 * idx->target) {	//the list outgrew the target length, recut everything
+		index_rebuild(lst);
+		return;
+	}
+	int half = idx->len[s] / 2;
+	llnode* n = idx->first[s];
+	int i;
+	for (i = 0; i < half; i++) {
+		n = n->next;
+	}
+	index_insert_segment(idx, s + 1, n, idx->len[s] - half);
+	idx->len[s] = half;
+}
+
+
+
+/*
+ * called after a node of segment s was unlinked, next is the node that
+ * followed it.  A segment under half the target length is merged into a
+ * neighbour, and once the list is down to a quarter of the size target
+ * was picked for the index is marked stale, so that positions stay
+ * O(sqrt n) in the current size.
+ */
+static void index_shrank(linkedlist* lst, int s, llnode* removed, llnode* next) {
+	llindex* idx = lst->index;
+	idx->len[s] = idx->len[s] - 1;
+	if (idx->len[s] == 0) {
+		index_remove_segment(idx, s);
+	} else {
+		if (idx->first[s] == removed) {
+			idx->first[s] = next;
+		}
+		if (idx->len[s] < idx->target / 2 && idx->count > 1) {
+			int keep = (s + 1 < idx->count) ? s : s - 1;	//keep absorbs the segment after it
+			idx->len[keep] = idx->len[keep] + idx->len[keep + 1];
+			index_remove_segment(idx, keep + 1);
+			index_grew(lst, keep);
 		}
-		free_llnode(lst->head);
-		lst->size = lst->size - 1;
 	}
+	if (idx->target > LLINDEX_MIN_TARGET && 4 * (lst->size - 1) < idx->target * idx->target) {
+		idx->valid = FALSE;
+	}
+}
+
+
+
+static void index_appended(linkedlist* lst) {
+	llindex* idx = lst->index;
+	if (idx == NULL || !idx->valid) {
+		return;
+	}
+	if (idx->count == 0) {
+		index_insert_segment(idx, 0, lst->tail, 1);
+	} else {
+		idx->len[idx->count - 1] = idx->len[idx->count - 1] + 1;
+		index_grew(lst, idx->count - 1);
+	}
+}
+
+
+
+static void index_prepended(linkedlist* lst) {
+	llindex* idx = lst->index;
+	if (idx == NULL || !idx->valid) {
+		return;
+	}
+	if (idx->count == 0) {
+		index_insert_segment(idx, 0, lst->head, 1);
+	} else {
+		idx->first[0] = lst->head;
+		idx->len[0] = idx->len[0] + 1;
+		index_grew(lst, 0);
+	}
+}
+
+
+
+void free_linkedlist(linkedlist* lst) {
+	clear_list(lst);
+	disable_list_index(lst);
 	free(lst);
 }
 
@@ -62,21 +261,88 @@ int is_list_empty(linkedlist* lst) {
 
 
 void clear_list(linkedlist* lst) {
-    int i;
-	int s = lst->size;
-    for(i = 1; i < s; i++) {
-		lst->tail = lst->tail->prev;	//move tail back
-		free_llnode(lst->tail->next);	//free the unneeded node
-		lst->size = lst->size - 1;
+	while (lst->blocks != NULL) {	//every node lives in a block, so there is no walk over the nodes
+		llblock* b = lst->blocks;
+		lst->blocks = b->next;
+		free(b);
 	}
-	free_llnode(lst->head);
-	lst->size = lst->size - 1;
+	lst->spare = NULL;
+	lst->head = NULL;
+	lst->tail = NULL;
+	lst->cur = NULL;
+	lst->size = 0;
+	if (lst->index != NULL) {
+		lst->index->count = 0;
+		lst->index->valid = TRUE;
+	}
+}
+
+
+
+/* allocates count nodes in one block, linked to each other in array order */
+static llblock* create_llblock(linkedlist* lst, void** items, int count) {
+	llblock* b = alloc_llblock(lst, count);
+	int i;
+	for (i = 0; i < count; i++) {
+		b->nodes[i].data = items[i];
+		b->nodes[i].prev = (i > 0) ? &b->nodes[i - 1] : NULL;
+		b->nodes[i].next = (i < count - 1) ? &b->nodes[i + 1] : NULL;
+	}
+	return b;
+}
+
+
+
+void append_list_array(linkedlist* lst, void** items, int count) {
+	if (count <= 0) {
+		return;
+	}
+	llblock* b = create_llblock(lst, items, count);
+	if (lst->size == 0) {
+		lst->head = &b->nodes[0];
+	} else {
+		b->nodes[0].prev = lst->tail;
+		lst->tail->next = &b->nodes[0];
+	}
+	lst->tail = &b->nodes[count - 1];
+	lst->size = lst->size + count;
+	index_invalidate(lst);
+}
+
+
+
+void prepend_list_array(linkedlist* lst, void** items, int count) {
+	if (count <= 0) {
+		return;
+	}
+	llblock* b = create_llblock(lst, items, count);
+	if (lst->size == 0) {
+		lst->tail = &b->nodes[count - 1];
+	} else {
+		b->nodes[count - 1].next = lst->head;
+		lst->head->prev = &b->nodes[count - 1];
+	}
+	lst->head = &b->nodes[0];
+	lst->size = lst->size + count;
+	index_invalidate(lst);
+}
+
+
+
+int list_to_array(linkedlist* lst, void** out) {
+	int i = 0;
+	llnode* n;
+	for (n = lst->head; n != NULL; n = n->next) {
+		out[i] = n->data;
+		i = i + 1;
+	}
+	return i;
 }
 
 
 
 void append_list(linkedlist* lst, void* data) {
-    llnode* new_node = create_llnode(data);
+    llnode* new_node = take_llnode(lst, data);
 	if (lst->size == 0) {
 		lst->tail = new_node;
 		lst->head = new_node;
@@ -86,12 +352,13 @@ void append_list(linkedlist* lst, void* data) {
 		lst->tail = new_node;
 	}
 	lst->size = lst->size + 1;
+	index_appended(lst);
 }
 
 
 
 void prepend_list(linkedlist* lst, void* data) {
-    llnode* new_node = create_llnode(data);
+    llnode* new_node = take_llnode(lst, data);
 	if (lst->size == 0) {
 		lst->tail = new_node;
 		lst->head = new_node;
@@ -101,6 +368,7 @@ void prepend_list(linkedlist* lst, void* data) {
 		lst->head = new_node;
 	}
 	lst->size = lst->size + 1;
+	index_prepended(lst);
 }
 
 
@@ -110,11 +378,22 @@ void* remove_list_head(linkedlist* lst) {
 		return NULL;
 	} else {
 		llnode* temp = lst->head;
+		void* data = temp->data;
 		lst->head = lst->head->next;	//move head pointer
-		lst->head->prev = NULL;
-		free(lst->head->prev);		//free location head was pointing to
+		if (lst->head == NULL) {		//removed the only node
+			lst->tail = NULL;
+		} else {
+			lst->head->prev = NULL;
+		}
+		if (lst->cur == temp) {
+			lst->cur = NULL;
+		}
+		if (lst->index != NULL && lst->index->valid) {
+			index_shrank(lst, 0, temp, lst->head);
+		}
+		release_llnode(lst, temp);	//free location head was pointing to
 		lst->size = lst->size - 1;	//decrease size
-		return temp->data;
+		return data;
 	}
 }
 
@@ -125,10 +404,22 @@ void* remove_list_tail(linkedlist* lst) {
 		return NULL;
 	} else {
 		llnode* temp = lst->tail;
+		void* data = temp->data;
 		lst->tail = lst->tail->prev;	//move tail pointer
-		free(lst->tail->next);		//free location tail was pointing to
+		if (lst->tail == NULL) {		//removed the only node
+			lst->head = NULL;
+		} else {
+			lst->tail->next = NULL;
+		}
+		if (lst->cur == temp) {
+			lst->cur = NULL;
+		}
+		if (lst->index != NULL && lst->index->valid) {
+			index_shrank(lst, lst->index->count - 1, temp, NULL);
+		}
+		release_llnode(lst, temp);	//free location tail was pointing to
 		lst->size = lst->size - 1;	//decrease size
-		return temp->data;
+		return data;
 	}
 }
 
@@ -183,7 +474,7 @@ void* get_list_prev(linkedlist* lst) {
 
 
 void insert_node_before_cur(linkedlist* lst, void* data) {
-	llnode* new_node = create_llnode(data);
+	llnode* new_node = take_llnode(lst, data);
 	if (lst->size == 0 || lst->cur == NULL) {
 		lst->head = new_node;
 		lst->tail = new_node;
@@ -197,12 +488,13 @@ void insert_node_before_cur(linkedlist* lst, void* data) {
 		}
 		lst->size = lst->size + 1;
 	}
+	index_invalidate(lst);
 }
 
 
 
 void insert_node_after_cur(linkedlist* lst, void* data) {
-	llnode* new_node = create_llnode(data);
+	llnode* new_node = take_llnode(lst, data);
 	if (lst->size == 0 || lst->cur == NULL) {
 		lst->head = new_node;
 		lst->tail = new_node;	
@@ -216,6 +508,7 @@ void insert_node_after_cur(linkedlist* lst, void* data) {
 		}
 		lst->size = lst->size + 1;
 	}
+	index_invalidate(lst);
 }
 
 
@@ -239,12 +532,335 @@ void print_list(linkedlist* lst) {
 
 
 
+/**********************************************************
+ * Functions for positional access to the linkedlist
+ ***********************************************************/
+
+void enable_list_index(linkedlist* lst) {
+	if (lst->index == NULL) {
+		llindex* idx = myMalloc(sizeof(llindex));
+		idx->count = 0;
+		idx->capacity = 0;
+		idx->target = LLINDEX_MIN_TARGET;
+		idx->first = NULL;
+		idx->len = NULL;
+		lst->index = idx;
+	}
+	index_rebuild(lst);
+}
+
+
+
+void disable_list_index(linkedlist* lst) {
+	if (lst->index != NULL) {
+		free(lst->index->first);
+		free(lst->index->len);
+		free(lst->index);
+		lst->index = NULL;
+	}
+}
+
+
+
+/* finds the node at pos (which must be in range) and, when indexed, its segment */
+static llnode* locate_list_node(linkedlist* lst, int pos, int* segment) {
+	llnode* n;
+	int i;
+	if (lst->index != NULL) {
+		llindex* idx = lst->index;
+		int s = 0;
+		if (!idx->valid) {
+			index_rebuild(lst);
+		}
+		while (pos >= idx->len[s]) {	//skip whole segments
+			pos = pos - idx->len[s];
+			s = s + 1;
+		}
+		*segment = s;
+		n = idx->first[s];
+		for (i = 0; i < pos; i++) {
+			n = n->next;
+		}
+	} else if (pos <= lst->size / 2) {	//no index, walk in from the nearer end
+		n = lst->head;
+		for (i = 0; i < pos; i++) {
+			n = n->next;
+		}
+	} else {
+		n = lst->tail;
+		for (i = lst->size - 1; i > pos; i--) {
+			n = n->prev;
+		}
+	}
+	return n;
+}
+
+
+
+void* get_list_at(linkedlist* lst, int pos) {
+	int s;
+	if (pos < 0 || pos >= lst->size) {
+		return NULL;
+	}
+	return locate_list_node(lst, pos, &s)->data;
+}
+
+
+
+void insert_list_at(linkedlist* lst, int pos, void* data) {
+	int s = 0;
+	if (pos <= 0) {
+		prepend_list(lst, data);
+		return;
+	}
+	if (pos >= lst->size) {
+		append_list(lst, data);
+		return;
+	}
+	llnode* n = locate_list_node(lst, pos, &s);	//the new node goes right before n
+	llnode* new_node = take_llnode(lst, data);
+	new_node->prev = n->prev;
+	new_node->next = n;
+	n->prev->next = new_node;
+	n->prev = new_node;
+	lst->size = lst->size + 1;
+	if (lst->index != NULL) {
+		if (lst->index->first[s] == n) {
+			lst->index->first[s] = new_node;
+		}
+		lst->index->len[s] = lst->index->len[s] + 1;
+		index_grew(lst, s);
+	}
+}
+
+
+
+void* remove_list_at(linkedlist* lst, int pos) {
+	int s = 0;
+	if (pos < 0 || pos >= lst->size) {
+		return NULL;
+	}
+	if (pos == 0) {
+		return remove_list_head(lst);
+	}
+	if (pos == lst->size - 1) {
+		return remove_list_tail(lst);
+	}
+	llnode* n = locate_list_node(lst, pos, &s);
+	void* data = n->data;
+	n->prev->next = n->next;
+	n->next->prev = n->prev;
+	if (lst->cur == n) {
+		lst->cur = NULL;
+	}
+	if (lst->index != NULL) {
+		index_shrank(lst, s, n, n->next);
+	}
+	release_llnode(lst, n);
+	lst->size = lst->size - 1;
+	return data;
+}
+
+
+
+/**********************************************************
+ * Functions for sorting the linkedlist
+ ***********************************************************/
+
+#define SORT_MAX_PENDING  64	// pending runs of 2^0 .. 2^63 nodes
+#define SORT_MIN_PARALLEL 8192	// shorter lists are not worth a thread each
+
+/* one unit of work for the parallel sort: sort first, or merge first with other */
+typedef struct sort_task_struct {
+	llnode* first;
+	llnode* other;
+	llcompare cmp;
+} sort_task;
+
+
+
+/* merges two sorted runs linked through next, prev links are left stale */
+static llnode* merge_runs(llnode* a, llnode* b, llcompare cmp) {
+	llnode head;
+	llnode* tail = &head;
+	while (a != NULL && b != NULL) {
+		if (cmp(a->data, b->data) <= 0) {	//take from a on ties so the sort is stable
+			tail->next = a;
+			a = a->next;
+		} else {
+			tail->next = b;
+			b = b->next;
+		}
+		tail = tail->next;
+	}
+	tail->next = (a != NULL) ? a : b;
+	return head.next;
+}
+
+
+
+/* sorts a NULL terminated run linked through next, returns its new first node */
+static llnode* sort_run(llnode* first, llcompare cmp) {
+	llnode* pending[SORT_MAX_PENDING];	// pending[i] is a sorted run of 2^i nodes, or NULL
+	int top = 0;
+	int i;
+	for (i = 0; i < SORT_MAX_PENDING; i++) {
+		pending[i] = NULL;
+	}
+	
+	while (first != NULL) {
+		llnode* run = first;
+		first = first->next;
+		run->next = NULL;
+		for (i = 0; pending[i] != NULL; i++) {	//carry like a binary counter, so runs are merged while still hot in cache
+			run = merge_runs(pending[i], run, cmp);
+			pending[i] = NULL;
+		}
+		pending[i] = run;
+		if (i > top) {
+			top = i;
+		}
+	}
+	
+	llnode* result = NULL;
+	for (i = 0; i <= top; i++) {	//lower slots hold the later nodes
+		if (pending[i] != NULL) {
+			result = merge_runs(pending[i], result, cmp);
+		}
+	}
+	return result;
+}
+
+
+
+/* makes first the head of the list and restores the prev links and tail */
+static void relink_list(linkedlist* lst, llnode* first) {
+	llnode* prev = NULL;
+	llnode* n = first;
+	while (n != NULL) {
+		n->prev = prev;
+		prev = n;
+		n = n->next;
+	}
+	lst->head = first;
+	lst->tail = prev;
+}
+
+
+
+static void* sort_worker(void* arg) {
+	sort_task* t = arg;
+	t->first = sort_run(t->first, t->cmp);
+	return NULL;
+}
+
+
+
+static void* merge_worker(void* arg) {
+	sort_task* t = arg;
+	t->first = merge_runs(t->first, t->other, t->cmp);
+	return NULL;
+}
+
+
+
+/* runs count tasks on their own threads, or inline if a thread can't be started */
+static void run_sort_tasks(sort_task* tasks, pthread_t* threads, int count, void* (*worker)(void*)) {
+	int* started = myMalloc(count * sizeof(int));
+	int i;
+	for (i = 0; i < count; i++) {
+		started[i] = (pthread_create(&threads[i], NULL, worker, &tasks[i]) == 0);
+		if (!started[i]) {
+			worker(&tasks[i]);
+		}
+	}
+	for (i = 0; i < count; i++) {
+		if (started[i]) {
+			pthread_join(threads[i], NULL);
+		}
+	}
+	free(started);
+}
+
+
+
+void sort_list(linkedlist* lst, llcompare cmp) {
+	if (lst->size < 2) {
+		return;
+	}
+	lst->tail->next = NULL;
+	relink_list(lst, sort_run(lst->head, cmp));
+	index_invalidate(lst);
+}
+
+
+
+void sort_list_parallel(linkedlist* lst, llcompare cmp, int num_threads) {
+	if (num_threads > lst->size / SORT_MIN_PARALLEL) {
+		num_threads = lst->size / SORT_MIN_PARALLEL;
+	}
+	if (num_threads < 2) {
+		sort_list(lst, cmp);
+		return;
+	}
+	
+	sort_task* tasks = myMalloc(num_threads * sizeof(sort_task));
+	pthread_t* threads = myMalloc(num_threads * sizeof(pthread_t));
+	
+	int chunk = lst->size / num_threads;
+	int extra = lst->size % num_threads;
+	llnode* n = lst->head;
+	int i, j;
+	for (i = 0; i < num_threads; i++) {	//cut the list into nearly equal chunks
+		int len = chunk + (i < extra ? 1 : 0);
+		tasks[i].first = n;
+		tasks[i].other = NULL;
+		tasks[i].cmp = cmp;
+		for (j = 1; j < len; j++) {
+			n = n->next;
+		}
+		llnode* next = n->next;
+		n->next = NULL;
+		n = next;
+	}
+	run_sort_tasks(tasks, threads, num_threads, sort_worker);
+	
+	int runs = num_threads;
+	while (runs > 1) {	//merge neighbouring runs pairwise, keeping them in order for stability
+		int pairs = runs / 2;
+		for (i = 0; i < pairs; i++) {
+			llnode* a = tasks[2*i].first;
+			llnode* b = tasks[2*i + 1].first;
+			tasks[i].first = a;
+			tasks[i].other = b;
+		}
+		if (runs % 2 == 1) {
+			tasks[pairs].first = tasks[runs - 1].first;
+		}
+		run_sort_tasks(tasks, threads, pairs, merge_worker);
+		runs = pairs + runs % 2;
+	}
+	
+	relink_list(lst, tasks[0].first);
+	index_invalidate(lst);
+	free(threads);
+	free(tasks);
+}
+
+
+
 /**********************************************************
  * The following main function is for debugging this 
  * linkedlist.  Supply the DEBUG flag to to compiler to 
  * compile a linkedlist containing this main function.
  ***********************************************************/
 #ifdef DEBUG_LINKEDLIST
+static int compare_ints(const void* a, const void* b) {
+	int x = *(const int*)a;
+	int y = *(const int*)b;
+	return (x > y) - (x < y);
+}
+
 int main(void) {
     printf("====================\n");
     printf("Debugging linkedlist\n");
@@ -325,6 +941,135 @@ int main(void) {
     printf("\n");
 	free_linkedlist(l);
     
+    printf("Bulk appending and prepending\n");
+    void* items[6] = {i1p, i2p, i3p, i4p, i5p, i6p};
+    void* exported[12];
+    l = create_linkedlist();
+    append_list(l, i6p);
+    append_list_array(l, items, 3);
+    prepend_list_array(l, items + 3, 3);
+    print_list(l);
+    assert(l->size == 7);
+    assert(list_to_array(l, exported) == 7);
+    assert(exported[0] == i4p && exported[2] == i6p && exported[3] == i6p);
+    assert(exported[4] == i1p && exported[6] == i3p);
+    assert(l->tail->prev->next == l->tail && l->head->next->prev == l->head);
+    remove_list_head(l);
+    remove_list_head(l);
+    llnode* removed = l->head;
+    remove_list_head(l);	//the removed nodes are kept for the next inserts
+    assert(l->spare == removed);
+    append_list(l, i1p);
+    assert(l->tail == removed && l->tail->data == i1p);
+    print_list(l);
+    clear_list(l);
+    assert(l->blocks == NULL && l->spare == NULL && l->size == 0);
+    int batch;
+    for (batch = 0; batch < 5; batch++) {	//one block per batch, freed together whatever order the nodes go in
+        append_list_array(l, items, 6);
+    }
+    remove_list_at(l, 14);
+    remove_list_tail(l);
+    clear_list(l);
+    assert(l->blocks == NULL && l->size == 0);
+    free_linkedlist(l);
+    
+    printf("Positional access with the index\n");
+    int seq[1000];
+    int i;
+    l = create_linkedlist();
+    enable_list_index(l);
+    for (i = 0; i < 1000; i++) {
+        seq[i] = i;
+    }
+    for (i = 0; i < 500; i++) {	//the index follows appends and prepends
+        append_list(l, &seq[500 + i]);
+        prepend_list(l, &seq[499 - i]);
+    }
+    assert(l->index->valid == TRUE && l->index->count > 1);
+    for (i = 0; i < 1000; i += 37) {
+        assert(get_list_at(l, i) == &seq[i]);
+    }
+    assert(remove_list_at(l, 500) == &seq[500]);
+    assert(get_list_at(l, 500) == &seq[501]);
+    insert_list_at(l, 500, &seq[500]);
+    assert(remove_list_at(l, 0) == &seq[0]);
+    assert(remove_list_tail(l) == &seq[999]);
+    insert_list_at(l, 0, &seq[0]);
+    insert_list_at(l, l->size, &seq[999]);
+    for (i = 0; i < 300; i++) {	//hammer one spot so segments split
+        insert_list_at(l, 10, &seq[10]);
+    }
+    for (i = 0; i < 300; i++) {
+        assert(remove_list_at(l, 10) == &seq[10]);
+    }
+    assert(l->size == 1000);
+    for (i = 0; i < 1000; i++) {
+        assert(get_list_at(l, i) == &seq[i]);
+    }
+    int total = 0;
+    for (i = 0; i < l->index->count; i++) {
+        total = total + l->index->len[i];
+    }
+    assert(total == l->size);
+    assert(get_list_at(l, 1000) == NULL);
+    sort_list(l, compare_ints);	//untracked edit, the index is rebuilt on the next access
+    assert(l->index->valid == FALSE);
+    assert(get_list_at(l, 123) == &seq[123]);
+    assert(l->index->valid == TRUE);
+    int target = l->index->target;
+    for (i = 0; i < 600; i++) {	//scattered removals, short segments are merged
+        remove_list_at(l, (int)((long long)i * 7919 % l->size));
+    }
+    assert(l->index->valid == TRUE && l->index->target == target);
+    assert(l->index->count <= l->size / (target / 2) + 1);
+    while (l->size > 100) {	//down to a quarter, the index is recut for the size left
+        remove_list_at(l, l->size / 2);
+    }
+    assert(get_list_at(l, 99) == l->tail->data);
+    assert(l->index->target == LLINDEX_MIN_TARGET && l->index->count <= 100 / LLINDEX_MIN_TARGET + 1);
+    clear_list(l);
+    free_linkedlist(l);
+    
+    printf("Sorting a list\n");
+    int vals[10] = {7, 3, 9, 1, 3, 8, 2, 6, 0, 5};
+    l = create_linkedlist();
+    for (i = 0; i < 10; i++) {
+        append_list(l, &vals[i]);
+    }
+    print_list(l);
+    sort_list(l, compare_ints);
+    print_list(l);
+    assert(l->size == 10);
+    assert(*(int*)l->head->data == 0);
+    assert(*(int*)l->tail->data == 9);
+    assert(l->head->next->next->next->data == &vals[1]);	//equal keys keep their order
+    assert(l->head->next->next->next->next->data == &vals[4]);
+    assert(l->tail->prev->next == l->tail);
+    free_linkedlist(l);
+    
+    printf("Sorting a list in parallel\n");
+    int n = 100000;
+    int* big = myMalloc(n * sizeof(int));
+    l = create_linkedlist();
+    for (i = 0; i < n; i++) {
+        big[i] = rand() % 1000;
+        append_list(l, &big[i]);
+    }
+    sort_list_parallel(l, compare_ints, 4);
+    assert(l->size == n);
+    llnode* node = l->head;
+    assert(node->prev == NULL);
+    for (i = 1; i < n; i++) {
+        assert(node->next->prev == node);
+        assert(compare_ints(node->data, node->next->data) <= 0);
+        node = node->next;
+    }
+    assert(node == l->tail && node->next == NULL);
+    printf("Sorted %i items\n\n", n);
+    free_linkedlist(l);
+    free(big);
+    
     return 0;
 }
 #endif
@@ -10,12 +10,38 @@ typedef struct llnode_struct {
 } llnode;
 
 
+/* struct defining a block of nodes allocated at once, owned by one list */
+typedef struct llblock_struct {
+    struct llblock_struct* next; // the list's other blocks
+    llnode nodes[];              // the nodes themselves
+} llblock;
+
+
+/*
+ * struct defining the optional positional index of a linkedlist.  The list is
+ * cut into consecutive segments of roughly sqrt(size) nodes and the index
+ * keeps the first node and length of each one, so a position is found by
+ * summing segment lengths and then walking inside a single segment.
+ */
+typedef struct llindex_struct {
+    int count;       // the number of segments
+    int capacity;    // the number of segments there is room for in first/len
+    int target;      // preferred segment length, segments are split at twice this
+    int valid;       // FALSE after an operation the index doesn't track, rebuilt on next use
+    llnode** first;  // first node of each segment
+    int* len;        // number of nodes in each segment
+} llindex;
+
+
 /* struct defining the doubly-linked list */
 typedef struct linkedlist_struct {
     int size;       // the size of the list, initialize to 0
     llnode* head;   // pointer to head of list
     llnode* tail;   // pointer to tail of list
     llnode* cur;    // pointer to current iterator item
+    llblock* blocks; // every node of the list is carved from these, freed by clear_list
+    llnode* spare;   // removed and not yet used nodes of the blocks, linked through next
+    llindex* index;  // positional index, NULL unless enabled with enable_list_index
 } linkedlist;
 
 
@@ -39,6 +65,9 @@ llnode* create_llnode(void* data);
 
 /**
  * Frees the memory for the specified linkedlist node
+ * NOTE: The nodes of a list belong to blocks owned by the list.  A removed
+ * node is kept for the next insert, and the blocks are freed together by
+ * clear_list and free_linkedlist, never by this function.
  * @param node - a pointer to the node to be freed
  **/
 void free_llnode(llnode* node);
@@ -77,6 +106,33 @@ void append_list(linkedlist* lst, void* data);
  **/
 void prepend_list(linkedlist* lst, void* data);
 
+/**
+ * Appends count data items to the list in array order.  All the nodes come
+ * from a single allocation and are linked in one pass.
+ * @param lst - a pointer to the linkedlist to append the data
+ * @param items - an array of the data to append to the linkedlist
+ * @param count - the number of items in the array
+ **/
+void append_list_array(linkedlist* lst, void** items, int count);
+
+/**
+ * Prepends count data items to the list so that items[0] becomes the new
+ * head and the items keep their array order.  All the nodes come from a
+ * single allocation and are linked in one pass.
+ * @param lst - a pointer to the linkedlist to prepend the data
+ * @param items - an array of the data to prepend to the linkedlist
+ * @param count - the number of items in the array
+ **/
+void prepend_list_array(linkedlist* lst, void** items, int count);
+
+/**
+ * Copies the data of every node, head to tail, into an array.
+ * @param lst - a pointer to the linkedlist to export
+ * @param out - an array with room for at least lst->size items
+ * @return the number of items written into out
+ **/
+int list_to_array(linkedlist* lst, void** out);
+
 /**
  * Removes the node from the head of the list and returns the data
  * contained within that node.
@@ -172,4 +228,82 @@ void insert_node_after_cur(linkedlist* lst, void* data);
 void print_list(linkedlist* lst);
 
 
+
+/**********************************************************
+* function prototypes for sorting the linkedlist
+***********************************************************/
+
+/* comparator used to order the data items of a list, returns <0, 0, >0 like strcmp */
+typedef int (*llcompare)(const void* a, const void* b);
+
+/**
+ * Sorts the list in place by relinking its nodes (no data is copied and no
+ * nodes are allocated).  Uses a bottom-up merge sort that keeps a small stack
+ * of pending sorted runs, so merges happen while the runs are still in cache.
+ * The sort is stable.  The iterator variable (cur) still points at the same
+ * node afterwards, which may now be at a different position in the list.
+ * @param lst - a pointer to the linkedlist to sort
+ * @param cmp - comparator called with the data pointers of two nodes
+ **/
+void sort_list(linkedlist* lst, llcompare cmp);
+
+/**
+ * Sorts the list in place like sort_list, but splits the list into 
+ * num_threads chunks that are sorted on worker threads and then merged
+ * pairwise, also in parallel.  Falls back to sort_list for short lists.
+ * @param lst - a pointer to the linkedlist to sort
+ * @param cmp - comparator called with the data pointers of two nodes, must be
+ *  safe to call from several threads at once
+ * @param num_threads - number of worker threads to use
+ **/
+void sort_list_parallel(linkedlist* lst, llcompare cmp, int num_threads);
+
+
+
+
+/**********************************************************
+* function prototypes for positional access to the linkedlist
+***********************************************************/
+
+/**
+ * Turns on the positional index of the list.  With the index, the *_list_at
+ * functions take O(sqrt n) instead of O(n).  The head and tail functions keep
+ * it up to date in O(1) time; other edits (the iterator inserts, bulk inserts
+ * and sorts) mark it stale and it is rebuilt by the next *_list_at call.
+ * @param lst - a pointer to the linkedlist to index
+ **/
+void enable_list_index(linkedlist* lst);
+
+/**
+ * Turns off and frees the positional index of the list.
+ * @param lst - a pointer to the linkedlist
+ **/
+void disable_list_index(linkedlist* lst);
+
+/**
+ * Get the data item at a position of the list.
+ * @param lst - a pointer to the linkedlist from which to get the data
+ * @param pos - the position of the item, 0 is the head
+ * @return the data item at that position, NULL if pos is out of range
+ **/
+void* get_list_at(linkedlist* lst, int pos);
+
+/**
+ * Creates a new node for the input data and inserts it so that it ends up at
+ * the given position.  Position lst->size appends to the list.
+ * @param lst - a pointer to the linkedlist to insert the data
+ * @param pos - the position for the new item, between 0 and lst->size
+ * @param data - the data to insert into the linkedlist
+ **/
+void insert_list_at(linkedlist* lst, int pos, void* data);
+
+/**
+ * Removes the node at a position of the list and returns its data.
+ * @param lst - a pointer to the linkedlist from which to remove the node
+ * @param pos - the position of the item, 0 is the head
+ * @return the data of the removed node, NULL if pos is out of range
+ **/
+void* remove_list_at(linkedlist* lst, int pos);
+
+
 #endif
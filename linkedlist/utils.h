@@ -6,4 +6,6 @@
 
 void* myMalloc(size_t size);
 
+void* myRealloc(void* ptr, size_t size);
+
 #endif
@@ -0,0 +1,426 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "utils.h"
+#include "skiplist.h"
+#include "bskiplist.h"
+#include "memtable.h"
+#include "sstable.h"
+#include "gskiplist.h"
+#include "lfskiplist.h"
+
+
+/**********************************************************
+ * Benchmarks for the skiplist.  Built as skiplist_bench
+ * with the BENCH_SKIPLIST flag, usage:
+ *   skiplist_bench [benchmark] [n]
+ ***********************************************************/
+#ifdef BENCH_SKIPLIST
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+
+/* nearly sorted keys, like timestamps arriving slightly out of order */
+static int* make_time_series(int n) {
+	int* keys = myMalloc(n * sizeof(int));
+	int i;
+	for (i = 0; i < n; i++) {
+		keys[i] = i * 4 + (i % 7 == 3 ? -9 : 0);
+	}
+	return keys;
+}
+
+
+
+/* compares insert and finger_insert on time series ingestion */
+static void bench_ingest(int n) {
+	int* keys = make_time_series(n);
+	int i;
+
+	skiplist* slst = create_skiplist(16, 0.5);
+	seed_skiplist(slst, 1);
+	double start = now_seconds();
+	for (i = 0; i < n; i++) {
+		insert(slst, keys[i]);
+	}
+	printf("insert               %10i keys  %8.3f s\n", n, now_seconds() - start);
+	free_skiplist(slst);
+
+	slst = create_skiplist(16, 0.5);
+	seed_skiplist(slst, 1);
+	slfinger f;
+	init_finger(&f, slst);
+	start = now_seconds();
+	for (i = 0; i < n; i++) {
+		finger_insert(&f, keys[i]);
+	}
+	printf("finger_insert        %10i keys  %8.3f s\n", n, now_seconds() - start);
+
+	start = now_seconds();
+	for (i = 0; i < n; i++) {
+		find(slst, keys[i]);
+	}
+	printf("find in key order    %10i keys  %8.3f s\n", n, now_seconds() - start);
+	init_finger(&f, slst);
+	start = now_seconds();
+	for (i = 0; i < n; i++) {
+		finger_find(&f, keys[i]);
+	}
+	printf("finger_find          %10i keys  %8.3f s\n", n, now_seconds() - start);
+	free_skiplist(slst);
+
+	free(keys);
+}
+
+
+
+/* compares n inserts of sorted keys with bulk_load */
+static void bench_build(int n) {
+	int* keys = myMalloc(n * sizeof(int));
+	int i;
+	for (i = 0; i < n; i++) {
+		keys[i] = i * 2;
+	}
+
+	skiplist* slst = create_skiplist(16, 0.5);
+	double start = now_seconds();
+	for (i = 0; i < n; i++) {
+		insert(slst, keys[i]);
+	}
+	printf("insert sorted        %10i keys  %8.3f s\n", n, now_seconds() - start);
+	free_skiplist(slst);
+
+	slst = create_skiplist(16, 0.5);
+	start = now_seconds();
+	bulk_load(slst, keys, n, FALSE);
+	printf("bulk_load random     %10i keys  %8.3f s\n", n, now_seconds() - start);
+	start = now_seconds();
+	bulk_load(slst, keys, n, TRUE);
+	printf("bulk_load balanced   %10i keys  %8.3f s\n", n, now_seconds() - start);
+	start = now_seconds();
+	for (i = 0; i < n; i += 16) {
+		find(slst, keys[(long long)i * 7919 % n]);
+	}
+	printf("  find (balanced)    %10i keys  %8.3f s\n", n / 16, now_seconds() - start);
+	free_skiplist(slst);
+
+	free(keys);
+}
+
+
+
+static int compare_ints(const void* a, const void* b) {
+	int x = *(const int*)a;
+	int y = *(const int*)b;
+	return (x > y) - (x < y);
+}
+
+
+
+/* percentile queries over a changing set: select_at against copying and sorting the keys */
+static void bench_rank(int n) {
+	int queries = 20;
+	int i, q;
+	skiplist* slst = create_skiplist(16, 0.5);
+	seed_skiplist(slst, 1);
+	for (i = 0; i < n; i++) {
+		insert(slst, (int)((long long)i * 7919 % n) * 2);
+	}
+
+	int* copy = myMalloc(n * sizeof(int));
+	int pass;
+	for (pass = 0; pass < 2; pass++) {
+		double start = now_seconds();
+		long long sum = 0;
+		for (q = 0; q < queries; q++) {	//one update, then the p50, p90 and p99 keys
+			int key = (pass * queries + q) * 2;
+			delete(slst, key);
+			insert(slst, key + 1);
+			if (pass == 0) {
+				sum = sum + select_at(slst, slst->size / 2)->key + select_at(slst, slst->size / 10 * 9)->key
+						+ select_at(slst, slst->size / 100 * 99)->key;
+			} else {	//what the queries cost without ranks
+				sliter it;
+				int size = 0;
+				for (iter_seek_first(&it, slst); iter_valid(&it); iter_next(&it)) {
+					copy[size] = iter_key(&it);
+					size = size + 1;
+				}
+				qsort(copy, size, sizeof(int), compare_ints);
+				sum = sum + copy[size / 2] + copy[size / 10 * 9] + copy[size / 100 * 99];
+			}
+		}
+		printf("%-20s %10i queries  %8.3f s  (sum %lld)\n", (pass == 0) ? "select_at" : "copy and sort",
+				queries, now_seconds() - start, sum);
+	}
+	free(copy);
+	free_skiplist(slst);
+}
+
+
+
+/* random lookups in a skiplist with one key per node and in the blocked skiplist */
+static void bench_blocked(int n) {
+	int* keys = myMalloc(n * sizeof(int));
+	int i;
+	for (i = 0; i < n; i++) {
+		keys[i] = (int)((long long)i * 7919 % n) * 2;	//every even key below 2n, shuffled
+	}
+
+	skiplist* slst = create_skiplist(16, 0.5);
+	seed_skiplist(slst, 1);
+	double start = now_seconds();
+	for (i = 0; i < n; i++) {
+		insert(slst, keys[i]);
+	}
+	printf("insert               %10i keys  %8.3f s\n", n, now_seconds() - start);
+	start = now_seconds();
+	int found = 0;
+	for (i = 0; i < n; i++) {
+		found = found + (find(slst, keys[(long long)i * 104729 % n] + (i & 1)) != NULL);
+	}
+	printf("find                 %10i keys  %8.3f s  (%i found)\n", n, now_seconds() - start, found);
+	free_skiplist(slst);
+
+	bskiplist* bsl = create_bskiplist(32);
+	start = now_seconds();
+	for (i = 0; i < n; i++) {
+		bsl_insert(bsl, keys[i]);
+	}
+	printf("bsl_insert           %10i keys  %8.3f s  (%.1f keys per node)\n", n, now_seconds() - start,
+			(double)bsl->size / bsl->nodes);
+	start = now_seconds();
+	found = 0;
+	for (i = 0; i < n; i++) {
+		found = found + bsl_find(bsl, keys[(long long)i * 104729 % n] + (i & 1));
+	}
+	printf("bsl_find             %10i keys  %8.3f s  (%i found)\n", n, now_seconds() - start, found);
+	free_bskiplist(bsl);
+
+	free(keys);
+}
+
+
+
+/* writes through the memtable and its log, flushing to sorted files, then reads everything back */
+static void bench_store(int n) {
+	const size_t flush_at = 4 << 20;
+	char value[100];
+	memset(value, 'v', sizeof(value));
+	int max_tables = 64;
+	sstable** tables = myMalloc(max_tables * sizeof(sstable*));
+	char path[64];
+	int num_tables = 0;
+	int i;
+
+	memtable* mt = create_memtable("/tmp/skiplist_bench.wal");
+	clear_memtable(mt);
+	double start = now_seconds();
+	for (i = 0; i < n; i++) {
+		int key = (int)((long long)i * 7919 % n);
+		memcpy(value, &i, sizeof(int));
+		mt_put(mt, key, value, sizeof(value));
+		if (mt->bytes >= flush_at && num_tables < max_tables) {
+			sprintf(path, "/tmp/skiplist_bench_%i.sst", num_tables);
+			flush_memtable(mt, path);
+			memmove(tables + 1, tables, num_tables * sizeof(sstable*));	//newest first
+			tables[0] = open_sstable(path);
+			num_tables = num_tables + 1;
+		}
+	}
+	printf("mt_put + flush       %10i keys  %8.3f s  (%i sorted files)\n", n, now_seconds() - start, num_tables);
+
+	start = now_seconds();
+	kvmerge* m = create_kvmerge(mt, tables, num_tables);
+	int seen = 0;
+	for (merge_seek_first(m); m->valid; merge_next(m)) {
+		seen = seen + 1;
+	}
+	free_kvmerge(m);
+	printf("merged scan          %10i keys  %8.3f s\n", seen, now_seconds() - start);
+
+	start = now_seconds();
+	int found = 0;
+	for (i = 0; i < n; i++) {
+		int key = (int)((long long)i * 104729 % n);
+		const char* v;
+		int len;
+		int status = mt_get(mt, key, &v, &len);
+		int t;
+		for (t = 0; t < num_tables && status == KV_NOT_FOUND; t++) {
+			status = sst_get(tables[t], key, &v, &len);
+		}
+		found = found + (status == KV_FOUND);
+	}
+	printf("point lookups        %10i keys  %8.3f s  (%i found)\n", n, now_seconds() - start, found);
+
+	for (i = 0; i < num_tables; i++) {
+		free_sstable(tables[i]);
+		sprintf(path, "/tmp/skiplist_bench_%i.sst", i);
+		remove(path);
+	}
+	free(tables);
+	free_memtable(mt);
+	remove("/tmp/skiplist_bench.wal");
+}
+
+
+
+GSKIPLIST_DEFINE(intmap, int, int, GSL_COMPARE_NUM)
+
+/* the generic skiplist on int keys against the int skiplist it generalizes */
+static void bench_generic(int n) {
+	int i;
+	skiplist* slst = create_skiplist(20, 0.5);
+	double start = now_seconds();
+	for (i = 0; i < n; i++) {
+		insert(slst, (int)((long long)i * 7919 % n));
+	}
+	printf("insert               %10i keys  %8.3f s\n", n, now_seconds() - start);
+	start = now_seconds();
+	int found = 0;
+	for (i = 0; i < n; i++) {
+		found = found + (find(slst, (int)((long long)i * 104729 % n)) != NULL);
+	}
+	printf("find                 %10i keys  %8.3f s  (%i found)\n", n, now_seconds() - start, found);
+	free_skiplist(slst);
+
+	intmap* im = intmap_create(20);
+	start = now_seconds();
+	for (i = 0; i < n; i++) {
+		int key = (int)((long long)i * 7919 % n);
+		intmap_put(im, key, i);
+	}
+	printf("intmap_put           %10i keys  %8.3f s\n", n, now_seconds() - start);
+	start = now_seconds();
+	found = 0;
+	for (i = 0; i < n; i++) {
+		found = found + (intmap_get(im, (int)((long long)i * 104729 % n)) != NULL);
+	}
+	printf("intmap_get           %10i keys  %8.3f s  (%i found)\n", n, now_seconds() - start, found);
+	intmap_free(im);
+}
+
+
+
+/* what each thread of bench_lockfree runs */
+typedef struct {
+	lfskiplist* slst;
+	int range;                  // keys are drawn from [0, range)
+	int ops;                    // operations this thread runs
+	unsigned long long seed;
+	pthread_barrier_t* barrier;
+} lf_worker_args;
+
+static void* lf_worker(void* arg) {
+	lf_worker_args* a = arg;
+	lfhandle* h = attach_lfskiplist(a->slst);
+	unsigned long long x = a->seed;
+	pthread_barrier_wait(a->barrier);
+	int i;
+	for (i = 0; i < a->ops; i++) {
+		x ^= x >> 12;
+		x ^= x << 25;
+		x ^= x >> 27;
+		unsigned long long r = x * 0x2545F4914F6CDD1DULL;
+		int key = (int)((r >> 32) % a->range);
+		int op = (int)(r & 0xFF) % 10;
+		if (op == 0) {
+			lf_insert(h, key);
+		} else if (op == 1) {
+			lf_delete(h, key);
+		} else {
+			lf_find(h, key);
+		}
+	}
+	detach_lfskiplist(h);
+	return NULL;
+}
+
+/*
+ * throughput of the lock-free skiplist as threads are added: 80% finds,
+ * 10% inserts and 10% deletes over n keys, half of them present, 4n
+ * operations split among the threads.  Scaling needs as many cores as
+ * threads, the cores available are printed alongside.
+ */
+static void bench_lockfree(int n) {
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	int max_threads = (cores > 8) ? (int)cores : 8;
+	max_threads = (max_threads < 64) ? max_threads : 64;
+	double base = 0;
+	int threads;
+	for (threads = 1; threads <= max_threads; threads *= 2) {
+		lfskiplist* slst = create_lfskiplist(24);
+		lfhandle* h = attach_lfskiplist(slst);
+		int i;
+		for (i = 0; i < n; i += 2) {
+			lf_insert(h, (int)((long long)i * 7919 % n));
+		}
+		detach_lfskiplist(h);
+		pthread_t* tids = myMalloc(threads * sizeof(pthread_t));
+		lf_worker_args* args = myMalloc(threads * sizeof(lf_worker_args));
+		pthread_barrier_t barrier;
+		pthread_barrier_init(&barrier, NULL, threads + 1);
+		for (i = 0; i < threads; i++) {
+			args[i].slst = slst;
+			args[i].range = n;
+			args[i].ops = (int)(4LL * n / threads);
+			args[i].seed = 0x9E3779B97F4A7C15ULL * (i + 1);
+			args[i].barrier = &barrier;
+			pthread_create(&tids[i], NULL, lf_worker, &args[i]);
+		}
+		pthread_barrier_wait(&barrier);
+		double start = now_seconds();
+		for (i = 0; i < threads; i++) {
+			pthread_join(tids[i], NULL);
+		}
+		double rate = 4.0 * n / (now_seconds() - start) / 1e6;
+		base = (threads == 1) ? rate : base;
+		printf("lock-free %2i threads %10i ops   %8.2f Mops/s  x%.2f  (%li cores, %i keys)\n",
+				threads, 4 * n, rate, rate / base, cores, lf_size(slst));
+		pthread_barrier_destroy(&barrier);
+		free(args);
+		free(tids);
+		free_lfskiplist(slst);
+	}
+}
+
+
+
+int main(int argc, char** argv) {
+	const char* which = (argc > 1) ? argv[1] : "all";
+	int n = (argc > 2) ? atoi(argv[2]) : 1000000;
+	int all = (strcmp(which, "all") == 0);
+
+	if (all || strcmp(which, "ingest") == 0) {
+		bench_ingest(n);
+	}
+	if (all || strcmp(which, "build") == 0) {
+		bench_build(n);
+	}
+	if (all || strcmp(which, "rank") == 0) {
+		bench_rank(n);
+	}
+	if (all || strcmp(which, "blocked") == 0) {
+		bench_blocked(n);
+	}
+	if (all || strcmp(which, "store") == 0) {
+		bench_store(n);
+	}
+	if (all || strcmp(which, "generic") == 0) {
+		bench_generic(n);
+	}
+	if (all || strcmp(which, "lockfree") == 0) {
+		bench_lockfree(n);
+	}
+	return 0;
+}
+#endif
@@ -0,0 +1,399 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+#include "utils.h"
+#include "bskiplist.h"
+
+#define BSL_ALIGN 64                        // nodes and their keys start on a cache line
+#define BSL_MERGE_BELOW (BSL_NODE_KEYS / 4)    // a node this empty tries to take in its successor
+#define BSL_MERGE_UPTO (BSL_NODE_KEYS * 3 / 4) // as long as the result leaves room to insert
+
+
+/* offset of the keys in a node with num_levels levels, the first line boundary past the tower */
+#define BSL_KEYS_OFFSET(num_levels) \
+	((offsetof(bsnode, next) + (num_levels) * sizeof(bsnode*) + BSL_ALIGN - 1) & ~(size_t)(BSL_ALIGN - 1))
+
+/* the sorted keys of a node, the slots past count hold INT_MAX */
+#define BSL_KEYS(node) ((int*)((char*)(node) + BSL_KEYS_OFFSET((node)->levels)))
+
+
+/**********************************************************
+ * Helpers for the nodes
+ ***********************************************************/
+
+static bsnode* create_bsnode(int num_levels) {
+	size_t bytes = BSL_KEYS_OFFSET(num_levels) + BSL_NODE_KEYS * sizeof(int);	//a multiple of the alignment, as aligned_alloc wants
+	bsnode* node = aligned_alloc(BSL_ALIGN, bytes);
+	if (node == NULL) {
+		fprintf(stderr, "Error allocating memory.\n");
+		exit(EXIT_FAILURE);
+	}
+	node->first = INT_MAX;
+	node->count = 0;
+	node->levels = num_levels;
+	int* keys = BSL_KEYS(node);
+	int i;
+	for (i = 0; i < BSL_NODE_KEYS; i++) {
+		keys[i] = INT_MAX;
+	}
+	for (i = 0; i < num_levels; i++) {
+		node->next[i] = NULL;
+	}
+	return node;
+}
+
+
+
+/* counts the keys of the node below key; the INT_MAX padding never is, so this is where key belongs */
+static int count_below(bsnode* node, int key) {
+	const int* keys = BSL_KEYS(node);
+	int below = 0;
+	int i;
+#if defined(__AVX2__)
+	__m256i k = _mm256_set1_epi32(key);
+	for (i = 0; i < BSL_NODE_KEYS; i += 8) {
+		__m256i v = _mm256_load_si256((const __m256i*)(keys + i));
+		below += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, v))));
+	}
+#elif defined(__SSE2__)
+	__m128i k = _mm_set1_epi32(key);
+	for (i = 0; i < BSL_NODE_KEYS; i += 4) {
+		__m128i v = _mm_load_si128((const __m128i*)(keys + i));
+		below += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(v, k))));
+	}
+#else
+	for (i = 0; i < BSL_NODE_KEYS; i++) {	//branchless, the compiler can vectorize it
+		below += (keys[i] < key);
+	}
+#endif
+	return below;
+}
+
+
+
+/* a level with probability 1/2 per step */
+static int random_level(bskiplist* bsl) {
+	return half_level(&bsl->rng, bsl->max_levels);
+}
+
+
+
+/* finds the last node on each level whose smallest key is at most key, the head if there is none */
+static bsnode* find_node(bskiplist* bsl, int key, bsnode** preds) {
+	bsnode* cur = bsl->head;
+	int level;
+	for (level = bsl->cur_levels; level >= 0; level--) {
+		while (cur->next[level] != NULL && cur->next[level]->first <= key) {
+			cur = cur->next[level];
+		}
+		preds[level] = cur;
+	}
+	return cur;
+}
+
+
+
+/* removes node from every level it is on and frees it */
+static void unlink_node(bskiplist* bsl, bsnode* node) {
+	bsnode* cur = bsl->head;
+	int key = node->first;	//the nodes before it are the ones with a smaller first key
+	int level;
+	for (level = bsl->cur_levels; level >= 0; level--) {
+		while (cur->next[level] != NULL && cur->next[level] != node && cur->next[level]->first < key) {
+			cur = cur->next[level];
+		}
+		if (cur->next[level] == node) {
+			cur->next[level] = node->next[level];
+		}
+	}
+	free(node);
+	bsl->nodes = bsl->nodes - 1;
+	while (bsl->cur_levels > 0 && bsl->head->next[bsl->cur_levels] == NULL) {
+		bsl->cur_levels = bsl->cur_levels - 1;
+	}
+}
+
+
+
+/* links a new node with a random tower after the nodes in preds, which hold levels 0..cur_levels */
+static bsnode* link_new_node(bskiplist* bsl, bsnode** preds) {
+	int new_level = random_level(bsl);
+	int j;
+	for (j = new_level; j > bsl->cur_levels; j--) {
+		preds[j] = bsl->head;
+	}
+	bsnode* node = create_bsnode(new_level + 1);
+	for (j = 0; j <= new_level; j++) {
+		node->next[j] = preds[j]->next[j];
+		preds[j]->next[j] = node;
+	}
+	if (bsl->cur_levels < new_level) {
+		bsl->cur_levels = new_level;
+	}
+	bsl->nodes = bsl->nodes + 1;
+	return node;
+}
+
+
+
+/**********************************************************
+ * Functions for the blocked skiplist
+ ***********************************************************/
+
+bskiplist* create_bskiplist(int max_levels) {
+	bskiplist* bsl = myMalloc(sizeof(bskiplist));
+	if (max_levels < 1) {
+		max_levels = 1;
+	} else if (max_levels > BSL_MAX_LEVELS) {
+		max_levels = BSL_MAX_LEVELS;
+	}
+	bsl->size = 0;
+	bsl->nodes = 0;
+	bsl->max_levels = max_levels;
+	bsl->cur_levels = 0;
+	bsl->head = create_bsnode(max_levels);
+	bsl->rng = random_seed();
+	return bsl;
+}
+
+
+
+void free_bskiplist(bskiplist* bsl) {
+	bsnode* n = bsl->head;
+	while (n != NULL) {
+		bsnode* next = n->next[0];
+		free(n);
+		n = next;
+	}
+	free(bsl);
+}
+
+
+
+int bsl_find(bskiplist* bsl, int key) {
+	bsnode* preds[BSL_MAX_LEVELS];
+	bsnode* n = find_node(bsl, key, preds);
+	if (n == bsl->head) {	//key is below every node
+		return FALSE;
+	}
+	int pos = count_below(n, key);
+	return pos < n->count && BSL_KEYS(n)[pos] == key;
+}
+
+
+
+int bsl_insert(bskiplist* bsl, int key) {
+	bsnode* preds[BSL_MAX_LEVELS];
+	bsnode* n = find_node(bsl, key, preds);
+	int level;
+	if (n == bsl->head) {	//key goes first, into the first node if there is one
+		n = bsl->head->next[0];
+		if (n == NULL) {
+			n = link_new_node(bsl, preds);
+		}
+		for (level = 0; level < n->levels; level++) {	//the first node is its own predecessor from now on
+			preds[level] = n;
+		}
+	}
+	int pos = count_below(n, key);
+	int* keys = BSL_KEYS(n);
+	if (pos < n->count && keys[pos] == key) {
+		return FALSE;
+	}
+
+	if (n->count == BSL_NODE_KEYS) {	//split off the upper half into a node right after n
+		int half = BSL_NODE_KEYS / 2;
+		bsnode* upper = link_new_node(bsl, preds);
+		int* upper_keys = BSL_KEYS(upper);
+		memcpy(upper_keys, keys + half, (BSL_NODE_KEYS - half) * sizeof(int));
+		upper->count = BSL_NODE_KEYS - half;
+		upper->first = upper_keys[0];
+		for (level = half; level < BSL_NODE_KEYS; level++) {
+			keys[level] = INT_MAX;
+		}
+		n->count = half;
+		if (pos > half) {
+			n = upper;
+			keys = upper_keys;
+			pos = pos - half;
+		}
+	}
+	memmove(keys + pos + 1, keys + pos, (n->count - pos) * sizeof(int));
+	keys[pos] = key;
+	n->count = n->count + 1;
+	n->first = keys[0];
+	bsl->size = bsl->size + 1;
+	return TRUE;
+}
+
+
+
+int bsl_delete(bskiplist* bsl, int key) {
+	bsnode* preds[BSL_MAX_LEVELS];
+	bsnode* n = find_node(bsl, key, preds);
+	if (n == bsl->head) {
+		return FALSE;
+	}
+	int pos = count_below(n, key);
+	int* keys = BSL_KEYS(n);
+	if (pos >= n->count || keys[pos] != key) {
+		return FALSE;
+	}
+	bsl->size = bsl->size - 1;
+	if (n->count == 1) {	//the last key goes with its node
+		unlink_node(bsl, n);
+		return TRUE;
+	}
+	memmove(keys + pos, keys + pos + 1, (n->count - pos - 1) * sizeof(int));
+	n->count = n->count - 1;
+	keys[n->count] = INT_MAX;
+	n->first = keys[0];
+
+	bsnode* next = n->next[0];
+	if (n->count < BSL_MERGE_BELOW && next != NULL && n->count + next->count <= BSL_MERGE_UPTO) {
+		memcpy(keys + n->count, BSL_KEYS(next), next->count * sizeof(int));	//next's keys all follow n's
+		n->count = n->count + next->count;
+		unlink_node(bsl, next);
+	}
+	return TRUE;
+}
+
+
+
+void print_bskiplist(bskiplist* bsl) {
+	printf("Printing blocked skiplist\n");
+	bsnode* n = bsl->head->next[0];
+	if (n == NULL) {
+		printf("Empty skiplist------------------------\n");
+		return;
+	}
+	while (n != NULL) {
+		int i;
+		for (i = 0; i < n->levels; i++) {
+			printf("[]");
+		}
+		printf(" ");
+		for (i = 0; i < n->count; i++) {
+			printf("%i ", BSL_KEYS(n)[i]);
+		}
+		printf("\n");
+		n = n->next[0];
+	}
+	printf("--------------------------------------\n");
+}
+
+
+
+/**********************************************************
+ * The following main function is for debugging the
+ * blocked skiplist.  Supply the DEBUG_BSKIPLIST flag to
+ * the compiler to compile it with this main function.
+ ***********************************************************/
+#ifdef DEBUG_BSKIPLIST
+/* checks the order of the keys and of the nodes on every level */
+static void check_bskiplist(bskiplist* bsl) {
+	int level;
+	for (level = 0; level < bsl->max_levels; level++) {
+		bsnode* n = bsl->head->next[level];
+		assert(level <= bsl->cur_levels || n == NULL);
+		while (n != NULL && n->next[level] != NULL) {
+			assert(BSL_KEYS(n)[n->count - 1] < n->next[level]->first);
+			n = n->next[level];
+		}
+	}
+	int size = 0;
+	int nodes = 0;
+	bsnode* n;
+	for (n = bsl->head->next[0]; n != NULL; n = n->next[0]) {
+		int* keys = BSL_KEYS(n);
+		int i;
+		assert(n->count > 0 && n->count <= BSL_NODE_KEYS && n->first == keys[0]);
+		for (i = 1; i < BSL_NODE_KEYS; i++) {
+			assert(i < n->count ? keys[i - 1] < keys[i] : keys[i] == INT_MAX);
+		}
+		size = size + n->count;
+		nodes = nodes + 1;
+	}
+	assert(size == bsl->size && nodes == bsl->nodes);
+}
+
+
+
+int main(void) {
+	printf("==========================\n");
+	printf("Debugging blocked skiplist\n");
+	printf("==========================\n");
+
+	bskiplist* bsl = create_bskiplist(16);
+	assert(bsl_find(bsl, 5) == FALSE);
+	assert(bsl_delete(bsl, 5) == FALSE);
+	print_bskiplist(bsl);
+
+	assert(bsl_insert(bsl, 5) == TRUE);
+	assert(bsl_insert(bsl, 1) == TRUE);
+	assert(bsl_insert(bsl, 9) == TRUE);
+	assert(bsl_insert(bsl, 5) == FALSE);
+	assert(bsl_find(bsl, 1) && bsl_find(bsl, 5) && bsl_find(bsl, 9));
+	assert(!bsl_find(bsl, 0) && !bsl_find(bsl, 6) && !bsl_find(bsl, 10));
+	assert(bsl_find(bsl, INT_MAX) == FALSE);	//the padding is not a key
+	assert(bsl->size == 3 && bsl->nodes == 1);
+	print_bskiplist(bsl);
+
+	printf("Splitting nodes\n");
+	int i;
+	for (i = 100; i > 10; i--) {	//descending inserts always hit the first node
+		assert(bsl_insert(bsl, i) == TRUE);
+	}
+	check_bskiplist(bsl);
+	assert(bsl->size == 93 && bsl->nodes > 3);
+	print_bskiplist(bsl);
+
+	printf("Merging and removing nodes\n");
+	for (i = 11; i <= 100; i++) {
+		assert(bsl_delete(bsl, i) == TRUE);
+		check_bskiplist(bsl);
+	}
+	assert(bsl->size == 3 && bsl->nodes == 1);
+	assert(bsl_delete(bsl, 1) && bsl_delete(bsl, 9) && bsl_delete(bsl, 5));
+	assert(bsl->size == 0 && bsl->nodes == 0 && bsl->cur_levels == 0);
+	assert(bsl_insert(bsl, INT_MAX) == TRUE && bsl_find(bsl, INT_MAX) == TRUE);
+	assert(bsl_delete(bsl, INT_MAX) == TRUE);
+	free_bskiplist(bsl);
+
+	printf("Checking random operations\n");
+	bsl = create_bskiplist(16);
+	char present[20000];
+	memset(present, 0, sizeof(present));
+	srand(42);
+	for (i = 0; i < 200000; i++) {
+		int key = rand() % 20000;
+		int op = rand() % 3;
+		if (op == 0) {
+			assert(bsl_find(bsl, key) == present[key]);
+		} else if (op == 1 || i < 50000) {
+			assert(bsl_insert(bsl, key) == !present[key]);
+			present[key] = 1;
+		} else {
+			assert(bsl_delete(bsl, key) == present[key]);
+			present[key] = 0;
+		}
+		if (i % 20000 == 0) {
+			check_bskiplist(bsl);
+		}
+	}
+	check_bskiplist(bsl);
+	printf("%i keys in %i nodes, %.1f keys per node\n", bsl->size, bsl->nodes, (double)bsl->size / bsl->nodes);
+	for (i = 0; i < 20000; i++) {
+		assert(bsl_find(bsl, i) == present[i]);
+	}
+	free_bskiplist(bsl);
+
+	return 0;
+}
+#endif
@@ -0,0 +1,93 @@
+#ifndef _bskiplist_h
+#define _bskiplist_h
+
+#include <stdint.h>
+
+#define BSL_MAX_LEVELS 32   // hard limit on max_levels
+#define BSL_NODE_KEYS 32    // keys per node, 128 bytes: two cache lines searched with SIMD compares
+
+
+/*
+ * struct defining a blocked skiplist node.  Instead of one key it holds a
+ * sorted run of up to BSL_NODE_KEYS keys, and the smallest one orders the
+ * node among the others.  A lookup follows the towers to the one node whose
+ * run may hold the key and then compares the whole run at once, so it
+ * touches a couple of cache lines per node instead of one per key.
+ *
+ * The node header shares the first cache line with the tower, and first
+ * repeats the smallest key there, so each hop along a level reads one line.
+ * The keys start on the next line boundary after the tower.
+ */
+typedef struct bskiplist_node_struct {
+    int first;                            // smallest key of the node, a copy of its keys[0]
+    int count;                            // number of keys in the node
+    int levels;                           // height of the tower
+    struct bskiplist_node_struct* next[]; // the tower of next pointers, then the keys
+} bsnode;
+
+
+/* struct defining the blocked skiplist */
+typedef struct bskiplist_struct {
+    int size;        // number of keys currently in the skiplist
+    int nodes;       // number of nodes holding them
+    int max_levels;  // number of levels of the head
+    int cur_levels;  // highest level currently in use, cur_levels < max_levels
+    bsnode* head;    // head of the skiplist, holds no keys
+    uint64_t rng;    // xorshift64* state used to draw node levels
+} bskiplist;
+
+
+
+/**********************************************************
+ * function prototypes
+ ***********************************************************/
+
+/**
+ * Creates and initializes a blocked skiplist.  Levels are drawn with
+ * probability 1/2, per node rather than per key.
+ * @param max_levels - the number of levels, at most BSL_MAX_LEVELS
+ * @return a pointer to the newly created skiplist
+ **/
+bskiplist* create_bskiplist(int max_levels);
+
+/**
+ * Frees the skiplist and all of its nodes.
+ * @param bsl - a pointer to the skiplist to be freed
+ **/
+void free_bskiplist(bskiplist* bsl);
+
+/**
+ * Checks whether the key is in the skiplist.
+ * @param bsl - a pointer to the skiplist
+ * @param key - the key value for which to search
+ * @return TRUE if the key is present, FALSE otherwise
+ **/
+int bsl_find(bskiplist* bsl, int key);
+
+/**
+ * Inserts the key into the skiplist.  A full node is split in two halves
+ * first.
+ * @param bsl - a pointer to the skiplist
+ * @param key - the key value to insert
+ * @return TRUE if the key was inserted, FALSE if it was already present
+ **/
+int bsl_insert(bskiplist* bsl, int key);
+
+/**
+ * Deletes the key from the skiplist.  An emptied node is unlinked, and a
+ * node left under a quarter full takes in its successor when both fit in
+ * three quarters of a node.
+ * @param bsl - a pointer to the skiplist
+ * @param key - the key value to delete
+ * @return TRUE if the key was deleted, FALSE if it wasn't present
+ **/
+int bsl_delete(bskiplist* bsl, int key);
+
+/**
+ * Prints the keys of each node, one node per line.
+ * @param bsl - a pointer to the skiplist to print
+ **/
+void print_bskiplist(bskiplist* bsl);
+
+
+#endif
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "utils.h"
+#include "gskiplist.h"
+
+
+/**********************************************************
+ * The following main function is for debugging the
+ * generic skiplist in gskiplist.h.  Supply the
+ * DEBUG_GSKIPLIST flag to the compiler to compile it with
+ * this main function.
+ ***********************************************************/
+#ifdef DEBUG_GSKIPLIST
+
+/* a fixed size string key, stored inline in the node */
+typedef struct {
+    char s[16];
+} name16;
+
+static inline int compare_name16(name16 a, name16 b) {
+	return strcmp(a.s, b.s);
+}
+
+static name16 make_name(const char* s) {
+	name16 n;
+	memset(&n, 0, sizeof(n));
+	strncpy(n.s, s, sizeof(n.s) - 1);
+	return n;
+}
+
+
+/* a composite key, ordered by user then by sequence number */
+typedef struct {
+    int user;
+    int seq;
+} userseq;
+
+#define COMPARE_USERSEQ(a, b) \
+	((a).user != (b).user ? GSL_COMPARE_NUM((a).user, (b).user) : GSL_COMPARE_NUM((a).seq, (b).seq))
+
+
+GSKIPLIST_DEFINE(tsmap, int64_t, int, GSL_COMPARE_NUM)
+GSKIPLIST_DEFINE(namemap, name16, double, compare_name16)
+GSKIPLIST_DEFINE(eventmap, userseq, const char*, COMPARE_USERSEQ)
+
+
+int main(void) {
+	printf("===========================\n");
+	printf("Debugging generic skiplist\n");
+	printf("===========================\n");
+
+	printf("64-bit timestamp keys\n");
+	tsmap* ts = tsmap_create(16);
+	int64_t base = 1700000000000000LL;	//microseconds, far past what an int holds
+	int i;
+	for (i = 0; i < 1000; i++) {
+		assert(tsmap_put(ts, base + (int64_t)((i * 389) % 1000) * 1000, i) == TRUE);
+	}
+	assert(ts->size == 1000);
+	assert(tsmap_put(ts, base, -1) == FALSE);	//replaces the value
+	assert(*tsmap_get(ts, base) == -1);
+	assert(tsmap_get(ts, base + 1) == NULL);
+	assert(tsmap_seek(ts, base + 1)->key == base + 1000);
+	int64_t last = 0;
+	tsmap_node* tn;
+	for (tn = tsmap_first(ts); tn != NULL; tn = tn->next[0]) {
+		assert(tn->key > last);
+		last = tn->key;
+	}
+	int old;
+	int expect = *tsmap_get(ts, base + 5000);
+	assert(tsmap_delete(ts, base + 5000, &old) == TRUE && old == expect);
+	assert(tsmap_delete(ts, base + 5000, NULL) == FALSE);
+	for (i = 0; i < 1000; i++) {
+		tsmap_delete(ts, base + (int64_t)i * 1000, NULL);
+	}
+	assert(ts->size == 0 && tsmap_first(ts) == NULL && ts->cur_levels == 0);
+	tsmap_free(ts);
+
+	printf("Fixed size string keys\n");
+	namemap* names = namemap_create(8);
+	const char* words[] = {"pear", "apple", "fig", "banana", "cherry", "date"};
+	for (i = 0; i < 6; i++) {
+		namemap_put(names, make_name(words[i]), i * 1.5);
+	}
+	assert(*namemap_get(names, make_name("fig")) == 3.0);
+	assert(namemap_get(names, make_name("grape")) == NULL);
+	assert(strcmp(namemap_first(names)->key.s, "apple") == 0);
+	assert(strcmp(namemap_seek(names, make_name("c"))->key.s, "cherry") == 0);
+	double d;
+	assert(namemap_delete(names, make_name("apple"), &d) == TRUE && d == 1.5);
+	assert(strcmp(namemap_first(names)->key.s, "banana") == 0);
+	namemap_node* nn;
+	for (nn = namemap_first(names); nn != NULL; nn = nn->next[0]) {
+		printf("%s -> %.1f\n", nn->key.s, nn->value);
+	}
+	namemap_free(names);
+
+	printf("Composite keys\n");
+	eventmap* events = eventmap_create(16);
+	for (i = 0; i < 300; i++) {
+		userseq k = {i % 3, 100 - i / 3};
+		eventmap_put(events, k, words[i % 6]);
+	}
+	userseq from = {1, 0};
+	eventmap_node* en = eventmap_seek(events, from);	//user 1's events in sequence order
+	assert(en->key.user == 1 && en->key.seq == 1);
+	int count = 0;
+	for (; en != NULL && en->key.user == 1; en = en->next[0]) {
+		count = count + 1;
+	}
+	assert(count == 100);
+	userseq k = {2, 50};
+	assert(*eventmap_get(events, k) != NULL);
+	eventmap_free(events);
+
+	return 0;
+}
+#endif
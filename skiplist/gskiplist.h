@@ -0,0 +1,218 @@
+#ifndef _gskiplist_h
+#define _gskiplist_h
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "utils.h"
+
+#define GSL_MAX_LEVELS 32   // hard limit on max_levels
+
+/*
+ * Comparators for GSKIPLIST_DEFINE.  A comparator takes two keys and
+ * returns a negative number, zero or a positive number, like strcmp.  The
+ * functions are static inline, so a comparator made of plain operators,
+ * like GSL_COMPARE_NUM for integers, timestamps and doubles, compiles down
+ * to a single compare in every search loop.
+ */
+#define GSL_COMPARE_NUM(a, b) (((a) > (b)) - ((a) < (b)))
+
+/*
+ * The default node allocator for GSKIPLIST_IMPLEMENT.  An allocator is a
+ * pair of macros or functions alloc(ctx, bytes) and release(ctx, node),
+ * ctx being the alloc_ctx given to name_create_in.  An arena can hand
+ * out the nodes and make release a no-op, dropping them all at once.
+ */
+#define GSL_MALLOC(ctx, bytes) ((void)(ctx), myMalloc(bytes))
+#define GSL_FREE(ctx, node) ((void)(ctx), free(node))
+
+
+/*
+ * Defines a skiplist type called name mapping keys of type ktype to values
+ * of type vtype, ordered by compare.  Keys and values are stored inline
+ * in the nodes, so a fixed size key like a struct holding a char array
+ * needs no separate allocation.  It defines:
+ *
+ *   name_node                 a node: key, value and the tower of next pointers
+ *   name                      the skiplist
+ *   name* name_create(int max_levels)
+ *   name* name_create_in(int max_levels, void* alloc_ctx)  nodes come from the allocator's ctx
+ *   void name_free(name* l)
+ *   vtype* name_get(name* l, ktype key)       the value of key, NULL if absent
+ *   int name_put(name* l, ktype key, vtype v)  TRUE if key was added, FALSE if its value was replaced
+ *   int name_delete(name* l, ktype key, vtype* old)  TRUE if key was removed, old may be NULL
+ *   name_node* name_seek(name* l, ktype key)     first node at or after key, NULL past the end
+ *   name_node* name_first(name* l)               node with the smallest key, walk on through next[0]
+ *
+ * Example, a map from 64-bit timestamps to records:
+ *   GSKIPLIST_DEFINE(tsmap, int64_t, record*, GSL_COMPARE_NUM)
+ *
+ * GSKIPLIST_DEFINE allocates nodes with GSL_MALLOC.  To give them another
+ * allocator, use GSKIPLIST_DECLARE for the types, in a header if need be,
+ * and GSKIPLIST_IMPLEMENT with the allocator where it is visible.
+ */
+#define GSKIPLIST_DEFINE(name, ktype, vtype, compare)                                 \
+    GSKIPLIST_DECLARE(name, ktype, vtype)                                             \
+    GSKIPLIST_IMPLEMENT(name, ktype, vtype, compare, GSL_MALLOC, GSL_FREE)
+
+
+/* defines the node and skiplist types of GSKIPLIST_DEFINE */
+#define GSKIPLIST_DECLARE(name, ktype, vtype)                                         \
+                                                                                      \
+typedef struct name##_node_struct {                                                   \
+    ktype key;                                                                        \
+    vtype value;                                                                      \
+    int levels;                                                                       \
+    struct name##_node_struct* next[];                                                \
+} name##_node;                                                                        \
+                                                                                      \
+typedef struct name##_struct {                                                        \
+    int size;                                                                         \
+    int max_levels;                                                                   \
+    int cur_levels;                                                                   \
+    name##_node* head;                                                                \
+    uint64_t rng;                                                                     \
+    void* alloc_ctx;                                                                  \
+} name;
+
+
+/* defines the functions of GSKIPLIST_DEFINE, taking nodes from alloc and giving them to release */
+#define GSKIPLIST_IMPLEMENT(name, ktype, vtype, compare, alloc, release)              \
+                                                                                      \
+static inline name##_node* name##_new_node(name* l, int num_levels) {                 \
+    name##_node* node = alloc(l->alloc_ctx, offsetof(name##_node, next)               \
+            + num_levels * sizeof(name##_node*));                                     \
+    node->levels = num_levels;                                                        \
+    int i;                                                                            \
+    for (i = 0; i < num_levels; i++) {                                                \
+        node->next[i] = NULL;                                                         \
+    }                                                                                 \
+    return node;                                                                      \
+}                                                                                     \
+                                                                                      \
+static inline name* name##_create_in(int max_levels, void* alloc_ctx) {               \
+    name* l = myMalloc(sizeof(name));                                                 \
+    if (max_levels < 1) {                                                             \
+        max_levels = 1;                                                               \
+    } else if (max_levels > GSL_MAX_LEVELS) {                                         \
+        max_levels = GSL_MAX_LEVELS;                                                  \
+    }                                                                                 \
+    l->size = 0;                                                                      \
+    l->max_levels = max_levels;                                                       \
+    l->cur_levels = 0;                                                                \
+    l->alloc_ctx = alloc_ctx;                                                         \
+    /* the head is allocated with the list, only the nodes come from alloc */         \
+    l->head = myMalloc(offsetof(name##_node, next)                                    \
+            + max_levels * sizeof(name##_node*));                                     \
+    l->head->levels = max_levels;                                                     \
+    int i;                                                                            \
+    for (i = 0; i < max_levels; i++) {                                                \
+        l->head->next[i] = NULL;                                                      \
+    }                                                                                 \
+    l->rng = random_seed();                                                           \
+    return l;                                                                         \
+}                                                                                     \
+                                                                                      \
+static inline name* name##_create(int max_levels) {                                   \
+    return name##_create_in(max_levels, NULL);                                        \
+}                                                                                     \
+                                                                                      \
+static inline void name##_free(name* l) {                                             \
+    name##_node* n = l->head->next[0];                                                \
+    while (n != NULL) {                                                               \
+        name##_node* next = n->next[0];                                               \
+        release(l->alloc_ctx, n);                                                     \
+        n = next;                                                                     \
+    }                                                                                 \
+    free(l->head);                                                                    \
+    free(l);                                                                          \
+}                                                                                     \
+                                                                                      \
+/* a level with probability 1/2 per step */                                           \
+static inline int name##_random_level(name* l) {                                      \
+    return half_level(&l->rng, l->max_levels);                                        \
+}                                                                                     \
+                                                                                      \
+/* finds the last node before key on every level */                                   \
+static inline void name##_find_before(name* l, ktype key, name##_node** before) {     \
+    name##_node* cur = l->head;                                                       \
+    int level;                                                                        \
+    for (level = l->cur_levels; level >= 0; level--) {                                \
+        while (cur->next[level] != NULL && compare(cur->next[level]->key, key) < 0) { \
+            cur = cur->next[level];                                                   \
+        }                                                                             \
+        before[level] = cur;                                                          \
+    }                                                                                 \
+}                                                                                     \
+                                                                                      \
+static inline name##_node* name##_seek(name* l, ktype key) {                          \
+    name##_node* cur = l->head;                                                       \
+    int level;                                                                        \
+    for (level = l->cur_levels; level >= 0; level--) {                                \
+        while (cur->next[level] != NULL && compare(cur->next[level]->key, key) < 0) { \
+            cur = cur->next[level];                                                   \
+        }                                                                             \
+    }                                                                                 \
+    return cur->next[0];                                                              \
+}                                                                                     \
+                                                                                      \
+static inline name##_node* name##_first(name* l) {                                    \
+    return l->head->next[0];                                                          \
+}                                                                                     \
+                                                                                      \
+static inline vtype* name##_get(name* l, ktype key) {                                 \
+    name##_node* n = name##_seek(l, key);                                             \
+    return (n != NULL && compare(n->key, key) == 0) ? &n->value : NULL;               \
+}                                                                                     \
+                                                                                      \
+static inline int name##_put(name* l, ktype key, vtype value) {                       \
+    name##_node* before[GSL_MAX_LEVELS];                                              \
+    name##_find_before(l, key, before);                                               \
+    name##_node* n = before[0]->next[0];                                              \
+    if (n != NULL && compare(n->key, key) == 0) {                                     \
+        n->value = value;                                                             \
+        return FALSE;                                                                 \
+    }                                                                                 \
+    int new_level = name##_random_level(l);                                           \
+    int j;                                                                            \
+    for (j = new_level; j > l->cur_levels; j--) {                                     \
+        before[j] = l->head;                                                          \
+    }                                                                                 \
+    n = name##_new_node(l, new_level + 1);                                            \
+    n->key = key;                                                                     \
+    n->value = value;                                                                 \
+    for (j = 0; j <= new_level; j++) {                                                \
+        n->next[j] = before[j]->next[j];                                              \
+        before[j]->next[j] = n;                                                       \
+    }                                                                                 \
+    if (l->cur_levels < new_level) {                                                  \
+        l->cur_levels = new_level;                                                    \
+    }                                                                                 \
+    l->size = l->size + 1;                                                            \
+    return TRUE;                                                                      \
+}                                                                                     \
+                                                                                      \
+static inline int name##_delete(name* l, ktype key, vtype* old) {                     \
+    name##_node* before[GSL_MAX_LEVELS];                                              \
+    name##_find_before(l, key, before);                                               \
+    name##_node* n = before[0]->next[0];                                              \
+    if (n == NULL || compare(n->key, key) != 0) {                                     \
+        return FALSE;                                                                 \
+    }                                                                                 \
+    int j;                                                                            \
+    for (j = 0; j < n->levels; j++) {                                                 \
+        before[j]->next[j] = n->next[j];                                              \
+    }                                                                                 \
+    if (old != NULL) {                                                                \
+        *old = n->value;                                                              \
+    }                                                                                 \
+    release(l->alloc_ctx, n);                                                         \
+    l->size = l->size - 1;                                                            \
+    while (l->cur_levels > 0 && l->head->next[l->cur_levels] == NULL) {               \
+        l->cur_levels = l->cur_levels - 1;                                            \
+    }                                                                                 \
+    return TRUE;                                                                      \
+}
+
+
+#endif
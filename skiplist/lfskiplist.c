@@ -0,0 +1,524 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include "utils.h"
+#include "lfskiplist.h"
+
+#define MARK(p)      ((p) | (uintptr_t)1)
+#define IS_MARKED(p) ((p) & (uintptr_t)1)
+#define PTR(p)       ((lfnode*)((p) & ~(uintptr_t)1))
+
+#define RETIRE_BATCH 64	// retired nodes a thread collects before trying to advance the epoch
+
+
+/**********************************************************
+ * Epoch based memory reclamation.  A thread pins the
+ * current epoch for the length of each operation; a node
+ * retired in epoch e is only freed once the global epoch
+ * has reached e+3, by which time every thread that could
+ * have seen the node has finished its operation.
+ ***********************************************************/
+
+static void free_limbo_list(lfnode* n) {
+	while (n != NULL) {
+		lfnode* next = n->retired_next;
+		free(n);
+		n = next;
+	}
+}
+
+
+
+static void pin(lfhandle* h) {
+	atomic_store(&h->active, TRUE);
+	unsigned e = atomic_load(&h->slst->epoch);
+	if (e != atomic_load_explicit(&h->epoch, memory_order_relaxed)) {
+		atomic_store(&h->epoch, e);
+		free_limbo_list(h->limbo[e % 3]);	//retired in epoch e-3 or earlier, no one can hold them
+		h->limbo[e % 3] = NULL;
+	}
+}
+
+
+
+static void unpin(lfhandle* h) {
+	atomic_store_explicit(&h->active, FALSE, memory_order_release);
+}
+
+
+
+/* counts keys in the thread's own handle, which only it writes, so no locked instruction is needed */
+static inline void add_size(lfhandle* h, int delta) {
+	int size = atomic_load_explicit(&h->size, memory_order_relaxed);
+	atomic_store_explicit(&h->size, size + delta, memory_order_relaxed);
+}
+
+
+
+/* moves the global epoch on if every active thread has caught up with it */
+static void try_advance_epoch(lfskiplist* slst) {
+	unsigned e = atomic_load(&slst->epoch);
+	lfhandle* h;
+	for (h = atomic_load(&slst->handles); h != NULL; h = h->next) {
+		if (atomic_load(&h->active) && atomic_load(&h->epoch) != e) {
+			return;
+		}
+	}
+	atomic_compare_exchange_strong(&slst->epoch, &e, e + 1);
+}
+
+
+
+static void retire(lfhandle* h, lfnode* node) {
+	unsigned e = atomic_load_explicit(&h->epoch, memory_order_relaxed);
+	node->retired_next = h->limbo[e % 3];
+	h->limbo[e % 3] = node;
+	h->limbo_count = h->limbo_count + 1;
+	if (h->limbo_count >= RETIRE_BATCH) {
+		h->limbo_count = 0;
+		try_advance_epoch(h->slst);
+	}
+}
+
+
+
+/* drops one of the two owners of a node, the inserter or the deleter; the last one retires it */
+static void release_owner(lfhandle* h, lfnode* node) {
+	if (atomic_fetch_sub(&node->owners, 1) == 1) {
+		retire(h, node);
+	}
+}
+
+
+
+/**********************************************************
+ * Helpers for the lock-free skiplist
+ ***********************************************************/
+
+static lfnode* create_lfnode(int key, int height) {
+	lfnode* node = myMalloc(offsetof(lfnode, next) + height * sizeof(node->next[0]));
+	node->key = key;
+	node->height = height;
+	atomic_init(&node->owners, 2);
+	node->retired_next = NULL;
+	int i;
+	for (i = 0; i < height; i++) {
+		atomic_init(&node->next[i], (uintptr_t)0);
+	}
+	return node;
+}
+
+
+
+/* draws a level with probability 1/2 per step from the thread's own generator */
+static int random_level(lfhandle* h) {
+	return half_level(&h->rng, h->slst->max_levels);
+}
+
+
+
+/*
+ * Fills preds/succs with the last node before key and the first node at or
+ * after key on every level, unlinking marked nodes met along the way.
+ * Returns TRUE if succs[0] holds key.
+ */
+static int search(lfskiplist* slst, int key, lfnode** preds, lfnode** succs) {
+	lfnode* pred;
+	lfnode* curr;
+	uintptr_t succ;
+	int level;
+retry:
+	pred = slst->head;
+	for (level = slst->max_levels - 1; level >= 0; level--) {
+		curr = PTR(atomic_load(&pred->next[level]));
+		while (curr != NULL) {
+			succ = atomic_load(&curr->next[level]);
+			while (IS_MARKED(succ)) {	//curr is deleted on this level, help unlink it
+				uintptr_t expected = (uintptr_t)curr;
+				if (!atomic_compare_exchange_strong(&pred->next[level], &expected, (uintptr_t)PTR(succ))) {
+					goto retry;	//pred changed or is being deleted itself
+				}
+				curr = PTR(succ);
+				if (curr == NULL) {
+					break;
+				}
+				succ = atomic_load(&curr->next[level]);
+			}
+			if (curr == NULL || curr->key >= key) {
+				break;
+			}
+			pred = curr;
+			curr = PTR(succ);
+		}
+		preds[level] = pred;
+		succs[level] = curr;
+	}
+	return succs[0] != NULL && succs[0]->key == key;
+}
+
+
+
+/**********************************************************
+ * Functions for the lock-free skiplist
+ ***********************************************************/
+
+lfskiplist* create_lfskiplist(int max_levels) {
+	lfskiplist* sl = myMalloc(sizeof(lfskiplist));
+	if (max_levels < 1) {
+		max_levels = 1;
+	} else if (max_levels > LF_MAX_LEVELS) {
+		max_levels = LF_MAX_LEVELS;
+	}
+	sl->max_levels = max_levels;
+	atomic_init(&sl->epoch, 0);
+	atomic_init(&sl->handles, NULL);
+	sl->head = create_lfnode(0, max_levels);
+	return sl;
+}
+
+
+
+void free_lfskiplist(lfskiplist* slst) {
+	lfnode* n = PTR(atomic_load(&slst->head->next[0]));
+	while (n != NULL) {	//nodes still linked, deleted or not
+		lfnode* next = PTR(atomic_load(&n->next[0]));
+		free(n);
+		n = next;
+	}
+	free(slst->head);
+	lfhandle* h = atomic_load(&slst->handles);
+	while (h != NULL) {	//nodes already unlinked and waiting to be freed
+		lfhandle* next = h->next;
+		int i;
+		for (i = 0; i < 3; i++) {
+			free_limbo_list(h->limbo[i]);
+		}
+		free(h);
+		h = next;
+	}
+	free(slst);
+}
+
+
+
+lfhandle* attach_lfskiplist(lfskiplist* slst) {
+	uint64_t seed = random_seed();
+	lfhandle* h;
+	for (h = atomic_load(&slst->handles); h != NULL; h = h->next) {	//reuse a detached handle
+		int unused = FALSE;
+		if (atomic_compare_exchange_strong(&h->in_use, &unused, TRUE)) {
+			h->rng = seed;
+			return h;
+		}
+	}
+	h = aligned_alloc(__alignof__(lfhandle), sizeof(lfhandle));	//sizeof is a whole number of lines
+	if (h == NULL) {
+		fprintf(stderr, "Error allocating memory.\n");
+		exit(EXIT_FAILURE);
+	}
+	h->slst = slst;
+	atomic_init(&h->epoch, atomic_load(&slst->epoch));
+	atomic_init(&h->active, FALSE);
+	atomic_init(&h->in_use, TRUE);
+	atomic_init(&h->size, 0);
+	h->limbo[0] = NULL;
+	h->limbo[1] = NULL;
+	h->limbo[2] = NULL;
+	h->limbo_count = 0;
+	h->rng = seed;
+	h->next = atomic_load(&slst->handles);
+	while (!atomic_compare_exchange_weak(&slst->handles, &h->next, h)) { }
+	return h;
+}
+
+
+
+void detach_lfskiplist(lfhandle* h) {
+	atomic_store(&h->in_use, FALSE);
+}
+
+
+
+int lf_size(lfskiplist* slst) {
+	int size = 0;
+	lfhandle* h;
+	for (h = atomic_load(&slst->handles); h != NULL; h = h->next) {	//detached handles keep their counts
+		size = size + atomic_load_explicit(&h->size, memory_order_relaxed);
+	}
+	return size;
+}
+
+
+
+int lf_find(lfhandle* h, int key) {
+	lfnode* pred = h->slst->head;
+	lfnode* curr = NULL;
+	int level;
+	pin(h);
+	for (level = h->slst->max_levels - 1; level >= 0; level--) {	//read only, marked nodes are stepped over
+		curr = PTR(atomic_load(&pred->next[level]));
+		while (curr != NULL) {
+			uintptr_t succ = atomic_load(&curr->next[level]);
+			while (IS_MARKED(succ)) {
+				curr = PTR(succ);
+				if (curr == NULL) {
+					break;
+				}
+				succ = atomic_load(&curr->next[level]);
+			}
+			if (curr == NULL || curr->key >= key) {
+				break;
+			}
+			pred = curr;
+			curr = PTR(succ);
+		}
+	}
+	int found = (curr != NULL && curr->key == key && !IS_MARKED(atomic_load(&curr->next[0])));
+	unpin(h);
+	return found;
+}
+
+
+
+int lf_insert(lfhandle* h, int key) {
+	lfskiplist* slst = h->slst;
+	lfnode* preds[LF_MAX_LEVELS];
+	lfnode* succs[LF_MAX_LEVELS];
+	int top = random_level(h);
+	lfnode* node = NULL;
+	int i;
+
+	pin(h);
+	while (TRUE) {	//link the bottom level, this is where the key becomes visible
+		if (search(slst, key, preds, succs)) {
+			unpin(h);
+			free(node);	//never published
+			return FALSE;
+		}
+		if (node == NULL) {
+			node = create_lfnode(key, top + 1);
+		}
+		for (i = 0; i <= top; i++) {
+			atomic_store_explicit(&node->next[i], (uintptr_t)succs[i], memory_order_relaxed);
+		}
+		uintptr_t expected = (uintptr_t)succs[0];
+		if (atomic_compare_exchange_strong(&preds[0]->next[0], &expected, (uintptr_t)node)) {
+			break;
+		}
+	}
+	add_size(h, 1);
+
+	for (i = 1; i <= top; i++) {	//then build the rest of the tower
+		while (TRUE) {
+			uintptr_t nxt = atomic_load(&node->next[i]);
+			if (IS_MARKED(nxt)) {
+				goto done;	//deleted meanwhile, stop building
+			}
+			if (PTR(nxt) != succs[i] && !atomic_compare_exchange_strong(&node->next[i], &nxt, (uintptr_t)succs[i])) {
+				continue;	//got marked, recheck
+			}
+			uintptr_t expected = (uintptr_t)succs[i];
+			if (atomic_compare_exchange_strong(&preds[i]->next[i], &expected, (uintptr_t)node)) {
+				break;
+			}
+			search(slst, key, preds, succs);
+			if (succs[0] != node) {
+				goto done;	//already deleted and unlinked from the bottom level
+			}
+		}
+	}
+done:
+	if (IS_MARKED(atomic_load(&node->next[0]))) {
+		search(slst, key, preds, succs);	//a deleter may have missed levels linked above, unlink them
+	}
+	release_owner(h, node);
+	unpin(h);
+	return TRUE;
+}
+
+
+
+int lf_delete(lfhandle* h, int key) {
+	lfskiplist* slst = h->slst;
+	lfnode* preds[LF_MAX_LEVELS];
+	lfnode* succs[LF_MAX_LEVELS];
+	int i;
+
+	pin(h);
+	if (!search(slst, key, preds, succs)) {
+		unpin(h);
+		return FALSE;
+	}
+	lfnode* node = succs[0];
+	for (i = node->height - 1; i >= 1; i--) {	//mark the upper levels top down
+		uintptr_t nxt = atomic_load(&node->next[i]);
+		while (!IS_MARKED(nxt)) {
+			atomic_compare_exchange_weak(&node->next[i], &nxt, MARK(nxt));
+		}
+	}
+	uintptr_t nxt = atomic_load(&node->next[0]);
+	while (TRUE) {	//whoever marks the bottom level owns the delete
+		if (IS_MARKED(nxt)) {
+			unpin(h);
+			return FALSE;
+		}
+		if (atomic_compare_exchange_weak(&node->next[0], &nxt, MARK(nxt))) {
+			break;
+		}
+	}
+	add_size(h, -1);
+	search(slst, key, preds, succs);	//unlink it from every level
+	release_owner(h, node);
+	unpin(h);
+	return TRUE;
+}
+
+
+
+int lf_range(lfhandle* h, int low, int high, void (*visit)(int key, void* arg), void* arg) {
+	lfnode* preds[LF_MAX_LEVELS];
+	lfnode* succs[LF_MAX_LEVELS];
+	int count = 0;
+	pin(h);
+	search(h->slst, low, preds, succs);
+	lfnode* curr = succs[0];
+	while (curr != NULL && curr->key <= high) {
+		uintptr_t nxt = atomic_load(&curr->next[0]);
+		if (!IS_MARKED(nxt)) {
+			visit(curr->key, arg);
+			count = count + 1;
+		}
+		curr = PTR(nxt);
+	}
+	unpin(h);
+	return count;
+}
+
+
+
+/**********************************************************
+ * The following main function is for debugging this
+ * lock-free skiplist.  Supply the DEBUG_LFSKIPLIST flag to
+ * the compiler to compile it with this main function.
+ ***********************************************************/
+#ifdef DEBUG_LFSKIPLIST
+
+#define THREADS         8
+#define KEYS_PER_THREAD 20000
+
+typedef struct worker_args_struct {
+	lfskiplist* slst;
+	int id;
+	int scans;
+	pthread_barrier_t* barrier;
+} worker_args;
+
+
+
+static void check_order(int key, void* arg) {
+	int* last = arg;
+	assert(key > *last);
+	*last = key;
+}
+
+
+
+/* each thread inserts its own keys, deletes the odd ones and range scans in between */
+static void* worker(void* arg) {
+	worker_args* a = arg;
+	lfhandle* h = attach_lfskiplist(a->slst);
+	int i;
+	for (i = 0; i < KEYS_PER_THREAD; i++) {
+		int key = i * THREADS + a->id;
+		assert(lf_insert(h, key) == TRUE);
+		if (i % 1000 == 0) {
+			int last = -1;
+			lf_range(h, 0, key, check_order, &last);
+			a->scans = a->scans + 1;
+		}
+	}
+	for (i = 1; i < KEYS_PER_THREAD; i += 2) {
+		assert(lf_delete(h, i * THREADS + a->id) == TRUE);
+	}
+	pthread_barrier_wait(a->barrier);
+	for (i = 0; i < KEYS_PER_THREAD; i += 2) {	//contend on a neighbour's keys while it does the same
+		lf_delete(h, i * THREADS + (a->id + 1) % THREADS);
+		lf_insert(h, i * THREADS + (a->id + 1) % THREADS);
+	}
+	detach_lfskiplist(h);
+	return NULL;
+}
+
+
+
+static void count_key(int key, void* arg) {
+	(void)key;
+	*(int*)arg = *(int*)arg + 1;
+}
+
+
+
+int main(void) {
+	printf("==============================\n");
+	printf("Debugging lock-free skiplist\n");
+	printf("==============================\n");
+
+	lfskiplist* slst = create_lfskiplist(16);
+	lfhandle* h = attach_lfskiplist(slst);
+
+	assert(lf_find(h, 5) == FALSE);
+	assert(lf_insert(h, 5) == TRUE);
+	assert(lf_insert(h, 1) == TRUE);
+	assert(lf_insert(h, 9) == TRUE);
+	assert(lf_insert(h, 5) == FALSE);
+	assert(lf_find(h, 5) == TRUE);
+	assert(lf_size(slst) == 3);
+	assert(lf_delete(h, 5) == TRUE);
+	assert(lf_delete(h, 5) == FALSE);
+	assert(lf_find(h, 5) == FALSE);
+	int n = 0;
+	assert(lf_range(h, 0, 100, count_key, &n) == 2 && n == 2);
+	printf("Single thread checks passed\n");
+
+	lf_delete(h, 1);
+	lf_delete(h, 9);
+	pthread_t threads[THREADS];
+	worker_args args[THREADS];
+	int i;
+	struct timespec start, end;
+	pthread_barrier_t barrier;
+	pthread_barrier_init(&barrier, NULL, THREADS);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < THREADS; i++) {
+		args[i].slst = slst;
+		args[i].id = i;
+		args[i].scans = 0;
+		args[i].barrier = &barrier;
+		pthread_create(&threads[i], NULL, worker, &args[i]);
+	}
+	for (i = 0; i < THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	pthread_barrier_destroy(&barrier);
+	printf("%i threads finished in %.3f s\n", THREADS,
+		(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+	int expected = THREADS * KEYS_PER_THREAD / 2;
+	n = 0;
+	lf_range(h, 0, THREADS * KEYS_PER_THREAD, count_key, &n);
+	printf("%i keys left (expected %i)\n", n, expected);
+	assert(n == expected);
+	assert(lf_size(slst) == expected);
+	for (i = 0; i < THREADS * KEYS_PER_THREAD; i++) {
+		assert(lf_find(h, i) == ((i / THREADS) % 2 == 0));
+	}
+
+	detach_lfskiplist(h);
+	free_lfskiplist(slst);
+	return 0;
+}
+#endif
@@ -0,0 +1,138 @@
+#ifndef _lfskiplist_h
+#define _lfskiplist_h
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define LF_MAX_LEVELS 32   // hard limit on max_levels
+
+
+/*
+ * struct defining a lock-free skiplist node.  The lowest bit of each next
+ * pointer is a deletion mark: once a node's next[i] is marked the node is
+ * logically gone from level i and any thread passing by may unlink it.
+ */
+typedef struct lfskiplist_node_struct {
+    int key;                      // node stores a single integer
+    int height;                   // number of levels in the tower
+    atomic_int owners;            // inserter and deleter, the last one to finish retires the node
+    struct lfskiplist_node_struct* retired_next; // link in a retire list once unlinked
+    _Atomic(uintptr_t) next[];    // the tower of (possibly marked) next pointers
+} lfnode;
+
+
+/*
+ * struct defining a thread's handle on a lock-free skiplist.  Every thread
+ * attaches once and passes its handle to each operation.  The handle holds
+ * the thread's epoch for memory reclamation, the nodes it retired, its
+ * share of the key count and a private random generator for node levels.
+ * Handles are written on every operation, so each gets cache lines of its
+ * own.
+ */
+typedef struct lfskiplist_handle_struct {
+    struct lfskiplist_struct* slst;            // the skiplist this handle is attached to
+    atomic_uint epoch;                         // global epoch seen when this thread last pinned
+    atomic_int active;                         // TRUE while inside an operation
+    atomic_int in_use;                         // TRUE while attached to a thread
+    atomic_int size;                           // keys inserted less keys deleted through this handle
+    lfnode* limbo[3];                          // retired nodes by epoch % 3, waiting to be freed
+    int limbo_count;                           // number of nodes in limbo
+    uint64_t rng;                              // xorshift64* state for node levels
+    struct lfskiplist_handle_struct* next;     // next handle of the same skiplist
+} __attribute__((aligned(64))) lfhandle;
+
+
+/*
+ * struct defining the lock-free skiplist.  Every operation reads it and
+ * almost none write it, so the key count is kept in the handles instead,
+ * where each thread updates its own.
+ */
+typedef struct lfskiplist_struct {
+    int max_levels;                // number of levels of the head
+    atomic_uint epoch;             // global epoch for memory reclamation
+    _Atomic(lfhandle*) handles;    // every handle ever attached, they are reused after detach
+    lfnode* head;                  // head of the skiplist, holds no key
+} lfskiplist;
+
+
+
+/**********************************************************
+ * function prototypes
+ ***********************************************************/
+
+/**
+ * Creates and initializes a lock-free skiplist.
+ * @param max_levels - the number of levels, at most LF_MAX_LEVELS
+ * @return a pointer to the newly created skiplist
+ **/
+lfskiplist* create_lfskiplist(int max_levels);
+
+/**
+ * Frees the skiplist, all of its nodes and handles.  No thread may be using
+ * the skiplist anymore.
+ * @param slst - a pointer to the skiplist to be freed
+ **/
+void free_lfskiplist(lfskiplist* slst);
+
+/**
+ * Attaches the calling thread to the skiplist.  A handle must only be used
+ * by one thread at a time.
+ * @param slst - a pointer to the skiplist
+ * @return the handle to pass to the other functions
+ **/
+lfhandle* attach_lfskiplist(lfskiplist* slst);
+
+/**
+ * Detaches a thread from the skiplist.  The handle may be given to another
+ * thread by a later attach_lfskiplist.
+ * @param h - the handle to detach
+ **/
+void detach_lfskiplist(lfhandle* h);
+
+/**
+ * Counts the keys in the skiplist by summing the handles' counts.  The
+ * count is exact while no operation is running, and close otherwise.
+ * @param slst - a pointer to the skiplist
+ * @return the number of keys
+ **/
+int lf_size(lfskiplist* slst);
+
+/**
+ * Checks whether the key is in the skiplist.
+ * @param h - the calling thread's handle
+ * @param key - the key value for which to search
+ * @return TRUE if the key is present, FALSE otherwise
+ **/
+int lf_find(lfhandle* h, int key);
+
+/**
+ * Inserts the key into the skiplist.
+ * @param h - the calling thread's handle
+ * @param key - the key value to insert
+ * @return TRUE if the key was inserted, FALSE if it was already present
+ **/
+int lf_insert(lfhandle* h, int key);
+
+/**
+ * Deletes the key from the skiplist.
+ * @param h - the calling thread's handle
+ * @param key - the key value to delete
+ * @return TRUE if this call deleted the key, FALSE if it wasn't present
+ **/
+int lf_delete(lfhandle* h, int key);
+
+/**
+ * Calls visit for every key in [low, high] in ascending order.  Keys inserted
+ * or deleted while the scan runs may or may not be seen, every key that was
+ * present for the whole scan is.
+ * @param h - the calling thread's handle
+ * @param low - the smallest key to visit
+ * @param high - the largest key to visit
+ * @param visit - called with each key and arg
+ * @param arg - passed through to visit
+ * @return the number of keys visited
+ **/
+int lf_range(lfhandle* h, int low, int high, void (*visit)(int key, void* arg), void* arg);
+
+
+#endif
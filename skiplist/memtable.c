@@ -0,0 +1,351 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include "utils.h"
+#include "memtable.h"
+
+#define MT_CHUNK_SIZE (256 * 1024)   // bytes per arena chunk
+#define WAL_HEADER 12                // checksum, key and length before the value of each log record
+
+/* the skiplist's node allocator: nodes come from the arena and go with it */
+#define MT_NODE_ALLOC(ctx, bytes) arena_alloc((memtable*)(ctx), (bytes))
+#define MT_NODE_RELEASE(ctx, node) ((void)(ctx), (void)(node))
+
+
+/**********************************************************
+ * Helpers for the arena and the skiplist
+ ***********************************************************/
+
+/* hands out bytes from the arena, pointer aligned; a request bigger than a chunk gets a chunk of its own */
+static void* arena_alloc(memtable* mt, size_t bytes) {
+	bytes = (bytes + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+	mtchunk* c = mt->chunks;
+	if (c == NULL || c->used + bytes > c->size) {
+		size_t size = (bytes > MT_CHUNK_SIZE) ? bytes : MT_CHUNK_SIZE;
+		mtchunk* fresh = myMalloc(sizeof(mtchunk) + size);
+		fresh->used = 0;
+		fresh->size = size;
+		if (c != NULL && bytes > MT_CHUNK_SIZE) {	//keep filling the current chunk afterwards
+			fresh->next = c->next;
+			c->next = fresh;
+		} else {
+			fresh->next = c;
+			mt->chunks = fresh;
+		}
+		c = fresh;
+	}
+	void* p = c->mem + c->used;
+	c->used = c->used + bytes;
+	mt->bytes = mt->bytes + bytes;
+	return p;
+}
+
+
+
+GSKIPLIST_IMPLEMENT(mtlist, int, mtvalue, GSL_COMPARE_NUM, MT_NODE_ALLOC, MT_NODE_RELEASE)
+
+
+
+/* applies a write to the skiplist, len is MT_TOMBSTONE for a delete */
+static void apply(memtable* mt, int key, const void* value, int len) {
+	mtvalue v;
+	v.len = len;
+	v.data = NULL;
+	if (len > 0) {
+		v.data = arena_alloc(mt, len);
+		memcpy(v.data, value, len);
+	}
+	mtlist_put(mt->list, key, v);	//a replaced value stays in the arena until the memtable is cleared
+}
+
+
+
+/**********************************************************
+ * Helpers for the write-ahead log
+ ***********************************************************/
+
+/* FNV-1a over a record, catches a record torn by a crash */
+static uint32_t checksum(int key, int len, const void* value) {
+	uint32_t h = 2166136261u;
+	const unsigned char* p = (const unsigned char*)&key;
+	size_t i;
+	for (i = 0; i < sizeof(int); i++) {
+		h = (h ^ p[i]) * 16777619u;
+	}
+	p = (const unsigned char*)&len;
+	for (i = 0; i < sizeof(int); i++) {
+		h = (h ^ p[i]) * 16777619u;
+	}
+	p = value;
+	for (i = 0; len > 0 && i < (size_t)len; i++) {
+		h = (h ^ p[i]) * 16777619u;
+	}
+	return h;
+}
+
+
+
+static void wal_append(memtable* mt, int key, const void* value, int len) {
+	if (mt->wal == NULL) {
+		return;
+	}
+	char header[WAL_HEADER];
+	uint32_t sum = checksum(key, len, value);
+	memcpy(header, &sum, 4);
+	memcpy(header + 4, &key, 4);
+	memcpy(header + 8, &len, 4);
+	if (fwrite(header, 1, WAL_HEADER, mt->wal) != WAL_HEADER
+			|| (len > 0 && fwrite(value, 1, len, mt->wal) != (size_t)len)
+			|| fflush(mt->wal) != 0) {	//hand it to the OS now, a process crash then loses nothing
+		fprintf(stderr, "Error writing log %s\n", mt->wal_path);
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+
+/* applies every intact record of the log and cuts off anything after the last one */
+static void wal_replay(memtable* mt) {
+	FILE* f = fopen(mt->wal_path, "rb");
+	if (f == NULL) {
+		return;	//no log yet
+	}
+	long size = (fseek(f, 0, SEEK_END) == 0) ? ftell(f) : -1;
+	rewind(f);
+	long good = 0;
+	char header[WAL_HEADER];
+	char* value = NULL;
+	int capacity = 0;
+	while (fread(header, 1, WAL_HEADER, f) == WAL_HEADER) {
+		uint32_t sum;
+		int key, len;
+		memcpy(&sum, header, 4);
+		memcpy(&key, header + 4, 4);
+		memcpy(&len, header + 8, 4);
+		if (len < MT_TOMBSTONE || len > size - ftell(f)) {	//a torn length, never allocate for it
+			break;
+		}
+		if (len > capacity) {
+			capacity = len;
+			value = myRealloc(value, capacity);
+		}
+		if (len > 0 && fread(value, 1, len, f) != (size_t)len) {
+			break;
+		}
+		if (checksum(key, len, value) != sum) {
+			break;
+		}
+		apply(mt, key, value, len);
+		good = ftell(f);
+	}
+	free(value);
+	fclose(f);
+	if (truncate(mt->wal_path, good) != 0) {	//new records go right after the last intact one
+		fprintf(stderr, "Error truncating log %s\n", mt->wal_path);
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+
+/**********************************************************
+ * Functions for the memtable
+ ***********************************************************/
+
+memtable* create_memtable(const char* wal_path) {
+	memtable* mt = myMalloc(sizeof(memtable));
+	mt->list = mtlist_create_in(MT_MAX_LEVELS, mt);
+	mt->chunks = NULL;
+	mt->bytes = 0;
+	mt->wal = NULL;
+	mt->wal_path = NULL;
+	if (wal_path != NULL) {
+		mt->wal_path = myMalloc(strlen(wal_path) + 1);
+		strcpy(mt->wal_path, wal_path);
+		wal_replay(mt);
+		mt->wal = fopen(wal_path, "ab");
+		if (mt->wal == NULL) {
+			fprintf(stderr, "Error opening log %s\n", wal_path);
+			exit(EXIT_FAILURE);
+		}
+	}
+	return mt;
+}
+
+
+
+/* frees the skiplist and the arena its nodes and values are in */
+static void drop_contents(memtable* mt) {
+	mtlist_free(mt->list);
+	mt->list = NULL;
+	while (mt->chunks != NULL) {
+		mtchunk* c = mt->chunks;
+		mt->chunks = c->next;
+		free(c);
+	}
+	mt->bytes = 0;
+}
+
+
+
+void free_memtable(memtable* mt) {
+	drop_contents(mt);
+	if (mt->wal != NULL) {
+		fclose(mt->wal);
+	}
+	free(mt->wal_path);
+	free(mt);
+}
+
+
+
+void clear_memtable(memtable* mt) {
+	drop_contents(mt);
+	mt->list = mtlist_create_in(MT_MAX_LEVELS, mt);
+	if (mt->wal != NULL && (fflush(mt->wal) != 0 || ftruncate(fileno(mt->wal), 0) != 0)) {
+		fprintf(stderr, "Error truncating log %s\n", mt->wal_path);
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+
+void mt_put(memtable* mt, int key, const void* value, int len) {
+	wal_append(mt, key, value, len);
+	apply(mt, key, value, len);
+}
+
+
+
+void mt_delete(memtable* mt, int key) {
+	wal_append(mt, key, NULL, MT_TOMBSTONE);
+	apply(mt, key, NULL, MT_TOMBSTONE);
+}
+
+
+
+int mt_get(memtable* mt, int key, const char** value, int* len) {
+	mtnode* n = mt_seek(mt, key);
+	if (n == NULL || n->key != key) {
+		return KV_NOT_FOUND;
+	}
+	if (n->value.len == MT_TOMBSTONE) {
+		return KV_DELETED;
+	}
+	*value = n->value.data;
+	*len = n->value.len;
+	return KV_FOUND;
+}
+
+
+
+void mt_sync(memtable* mt) {
+	if (mt->wal != NULL && (fflush(mt->wal) != 0 || fsync(fileno(mt->wal)) != 0)) {
+		fprintf(stderr, "Error syncing log %s\n", mt->wal_path);
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+
+mtnode* mt_seek(memtable* mt, int key) {
+	return mtlist_seek(mt->list, key);
+}
+
+
+
+mtnode* mt_first(memtable* mt) {
+	return mtlist_first(mt->list);
+}
+
+
+
+/**********************************************************
+ * The following main function is for debugging the
+ * memtable.  Supply the DEBUG_MEMTABLE flag to the
+ * compiler to compile it with this main function.
+ ***********************************************************/
+#ifdef DEBUG_MEMTABLE
+int main(void) {
+	printf("==================\n");
+	printf("Debugging memtable\n");
+	printf("==================\n");
+
+	const char* path = "memtable_debug.wal";
+	remove(path);
+	memtable* mt = create_memtable(path);
+	const char* v;
+	int len;
+	assert(mt_get(mt, 1, &v, &len) == KV_NOT_FOUND);
+	mt_put(mt, 1, "one", 3);
+	mt_put(mt, 2, "two", 3);
+	mt_put(mt, 1, "uno", 3);
+	mt_delete(mt, 2);
+	size_t before = mt->bytes;
+	mt_put(mt, 3, "", 0);
+	assert(mt->bytes > before);	//no value bytes, but the node is in the arena too
+	assert(mt_get(mt, 1, &v, &len) == KV_FOUND && len == 3 && memcmp(v, "uno", 3) == 0);
+	assert(mt_get(mt, 2, &v, &len) == KV_DELETED);
+	assert(mt_get(mt, 3, &v, &len) == KV_FOUND && len == 0);
+	assert(mt->list->size == 3);
+
+	printf("Writing and replaying the log\n");
+	int i;
+	char buf[64];
+	for (i = 1000; i > 0; i--) {
+		len = sprintf(buf, "value %i", i * 7);
+		mt_put(mt, i * 10, buf, len);
+	}
+	mt_sync(mt);
+	char* big = myMalloc(1000000);	//bigger than an arena chunk
+	memset(big, 'x', 1000000);
+	mt_put(mt, 5, big, 1000000);
+	free_memtable(mt);
+
+	FILE* f = fopen(path, "ab");	//a torn record, as if the process died halfway through a write
+	fwrite("\x01\x02\x03\x04\x05\x06", 1, 6, f);
+	fclose(f);
+
+	mt = create_memtable(path);
+	assert(mt->list->size == 1004);	//1, 2, 3, 5 and the thousand
+	assert(mt_get(mt, 2, &v, &len) == KV_DELETED);
+	assert(mt_get(mt, 5, &v, &len) == KV_FOUND && len == 1000000 && v[999999] == 'x');
+	for (i = 1; i <= 1000; i++) {
+		assert(mt_get(mt, i * 10, &v, &len) == KV_FOUND);
+		assert(len == sprintf(buf, "value %i", i * 7) && memcmp(v, buf, len) == 0);
+	}
+	mtnode* n = mt_first(mt);
+	int last = n->key;
+	int seen = 1;
+	for (n = n->next[0]; n != NULL; n = n->next[0]) {
+		assert(n->key > last);
+		last = n->key;
+		seen = seen + 1;
+	}
+	assert(seen == 1004);
+	assert(mt_seek(mt, 11)->key == 20 && mt_seek(mt, 10001) == NULL);
+	mt_put(mt, 7, "seven", 5);	//appended after the cut off record
+	free_memtable(mt);
+
+	f = fopen(path, "ab");	//a whole header with a garbage length, replay must not allocate for it
+	int garbage[3] = {0, 9, 0x7FFFFFF0};
+	fwrite(garbage, sizeof(int), 3, f);
+	fclose(f);
+
+	mt = create_memtable(path);
+	assert(mt->list->size == 1005 && mt_get(mt, 7, &v, &len) == KV_FOUND);
+	clear_memtable(mt);
+	assert(mt->list->size == 0 && mt_first(mt) == NULL && mt->bytes == 0);
+	free_memtable(mt);
+	mt = create_memtable(path);
+	assert(mt->list->size == 0);
+	free_memtable(mt);
+	free(big);
+	remove(path);
+
+	return 0;
+}
+#endif
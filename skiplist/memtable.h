@@ -0,0 +1,144 @@
+#ifndef _memtable_h
+#define _memtable_h
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "gskiplist.h"
+
+#define MT_MAX_LEVELS 24    // levels of the memtable skiplist, plenty at prob 1/2 for millions of keys
+#define MT_TOMBSTONE (-1)   // value length recorded for a deleted key
+
+/* results of a lookup in a memtable or sorted file */
+#define KV_NOT_FOUND 0      // the key was never written here
+#define KV_FOUND 1          // the key has a value
+#define KV_DELETED 2        // the key was deleted here, older data must not be consulted
+
+
+/* struct defining the latest value of a memtable key */
+typedef struct memtable_value_struct {
+    int len;                             // bytes in data, MT_TOMBSTONE once deleted
+    char* data;                          // the bytes, in the memtable's arena
+} mtvalue;
+
+
+/*
+ * The memtable keeps its keys in a generic skiplist from int to mtvalue,
+ * mtnode being its node type.  The skiplist's functions are defined in
+ * memtable.c with the arena as their allocator, so nodes and values are
+ * both carved from the arena and never freed one by one: writing a key
+ * again points its node at a new value, and deleting it stores a
+ * tombstone.
+ */
+GSKIPLIST_DECLARE(mtlist, int, mtvalue)
+
+typedef mtlist_node mtnode;
+
+
+/* struct defining a chunk of memtable memory */
+typedef struct memtable_chunk_struct {
+    struct memtable_chunk_struct* next; // previously filled chunk
+    size_t used;                        // bytes handed out so far
+    size_t size;                        // bytes available in mem
+    char mem[];                         // the node and value storage
+} mtchunk;
+
+
+/*
+ * struct defining a memtable: the in-memory write buffer of an ordered
+ * store.  Every write is appended to the write-ahead log before it is
+ * applied to the skiplist, so a crashed memtable is rebuilt by replaying
+ * the log.  Once it is big enough, flush_memtable (sstable.h) writes it to
+ * a sorted file and empties it.
+ */
+typedef struct memtable_struct {
+    mtlist* list;       // the keys in order, tombstones included, with their latest values
+    mtchunk* chunks;    // arena chunk currently being filled, links to older ones
+    size_t bytes;       // arena bytes in use, what decides when to flush
+    FILE* wal;          // the write-ahead log, NULL for a memtable without one
+    char* wal_path;     // where the log lives
+} memtable;
+
+
+
+/**********************************************************
+ * function prototypes
+ ***********************************************************/
+
+/**
+ * Creates a memtable logging to wal_path.  If the log already holds
+ * records, from a memtable that was never flushed, they are replayed first.
+ * A torn record at the end of the log, left by a crash in the middle of a
+ * write, is dropped.
+ * @param wal_path - the write-ahead log, NULL to keep the memtable in memory only
+ * @return a pointer to the newly created memtable
+ **/
+memtable* create_memtable(const char* wal_path);
+
+/**
+ * Frees the memtable and closes its log.  The log file is kept, so the
+ * contents come back with the next create_memtable on the same path.
+ * @param mt - a pointer to the memtable to be freed
+ **/
+void free_memtable(memtable* mt);
+
+/**
+ * Empties the memtable and truncates its log.  Called once the contents
+ * are safely in a sorted file.
+ * @param mt - a pointer to the memtable to clear
+ **/
+void clear_memtable(memtable* mt);
+
+/**
+ * Sets the value of a key, replacing any earlier value.
+ * @param mt - a pointer to the memtable
+ * @param key - the key
+ * @param value - the bytes of the value, copied
+ * @param len - the number of bytes in value
+ **/
+void mt_put(memtable* mt, int key, const void* value, int len);
+
+/**
+ * Deletes a key by storing a tombstone for it, which hides the key in
+ * older sorted files too.
+ * @param mt - a pointer to the memtable
+ * @param key - the key
+ **/
+void mt_delete(memtable* mt, int key);
+
+/**
+ * Looks up a key.
+ * @param mt - a pointer to the memtable
+ * @param key - the key
+ * @param value - set to the value when found, valid until the memtable is cleared
+ * @param len - set to the number of bytes in the value when found
+ * @return KV_FOUND, KV_DELETED or KV_NOT_FOUND
+ **/
+int mt_get(memtable* mt, int key, const char** value, int* len);
+
+/**
+ * Forces the log to disk, so every write so far survives a power loss.
+ * Writes are otherwise handed to the OS as they happen, which is enough
+ * to survive the process crashing.
+ * @param mt - a pointer to the memtable
+ **/
+void mt_sync(memtable* mt);
+
+/**
+ * Finds the first node with a key at or after key, to walk the memtable
+ * in key order through next[0].  Tombstones are included.
+ * @param mt - a pointer to the memtable
+ * @param key - the key to seek to
+ * @return the node, NULL if every key is smaller
+ **/
+mtnode* mt_seek(memtable* mt, int key);
+
+/**
+ * Finds the node with the smallest key.
+ * @param mt - a pointer to the memtable
+ * @return the node, NULL if the memtable is empty
+ **/
+mtnode* mt_first(memtable* mt);
+
+
+#endif
@@ -1,23 +1,108 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
 #include <limits.h>  // contains INT_MAX constant
 #include <math.h>
 #include <time.h>
+#include <assert.h>
 #include "utils.h"
 #include "skiplist.h"
 
+#define SL_CHUNK_SIZE (64 * 1024)	// bytes per arena chunk
+
+/* step by step tracing of the searches, only in the debug build */
+#ifdef DEBUG_SKIPLIST
+#define SL_TRACE(...) printf(__VA_ARGS__)
+#else
+#define SL_TRACE(...) ((void)0)
+#endif
+
+/* bytes needed for a node with a tower of num_levels pointers and widths, kept pointer aligned */
+#define SLNODE_BYTES(num_levels) \
+	((offsetof(slnode, next) + (num_levels) * (sizeof(slnode*) + sizeof(int)) + sizeof(slnode*) - 1) & ~(sizeof(slnode*) - 1))
+
+/* the span widths of a node, stored right after its next pointers */
+#define SL_WIDTH(node) ((int*)((node)->next + (node)->levels))
+
+/**********************************************************
+ * Helpers for level generation
+ ***********************************************************/
+
+/* the next value of the skiplist's generator */
+static uint32_t next_random(skiplist* slst) {
+	return xorshift_next(&slst->rng);
+}
+
+
+
+/* computes the size at which one more level is worth having, (1/prob)^max_levels */
+static void set_grow_point(skiplist* slst) {
+	if (slst->max_levels >= SL_MAX_LEVELS || slst->prob <= 0.0f || slst->prob >= 1.0f) {
+		slst->grow_at = 0;	//never grow
+		return;
+	}
+	double n = pow(1.0 / slst->prob, slst->max_levels);
+	slst->grow_at = (n > 1e18) ? 0 : (long long)n;
+}
+
+
+
+/* raises max_levels by one, making the head one level taller */
+static void grow_levels(skiplist* slst) {
+	int levels = slst->max_levels + 1;
+	slnode* head = myRealloc(slst->head, SLNODE_BYTES(levels));
+	memmove(head->next + levels, head->next + levels - 1, (levels - 1) * sizeof(int));	//widths move up past the new pointer
+	head->next[levels - 1] = NULL;
+	head->levels = levels;
+	slst->head = head;
+
+	slst->max_levels = levels;
+	slst->version = slst->version + 1;	//the head may have moved
+	set_grow_point(slst);
+}
+
+
+
 /**********************************************************
  * Functions for the skiplist
  ***********************************************************/
 
 skiplist* create_skiplist(int max_levels, float prob) {
     skiplist* sl = myMalloc(sizeof(skiplist));
+	if (max_levels < 1) {
+		max_levels = 1;
+	} else if (max_levels > SL_MAX_LEVELS) {
+		max_levels = SL_MAX_LEVELS;
+	}
 	sl->size = 0;
 	sl->prob = prob;
 	sl->max_levels = max_levels;
 	sl->cur_levels = 0;
 	sl->head = create_slnode(0, max_levels);
 	sl->tail = NULL;	//what is max integer and why do I need a tail?
+	sl->arena.chunks = NULL;
+	int i;
+	for (i = 0; i < SL_MAX_LEVELS; i++) {
+		sl->arena.free_nodes[i] = NULL;
+	}
+	
+	if (prob == 0.5f) {
+		sl->level_shift = 1;
+	} else if (prob == 0.25f) {
+		sl->level_shift = 2;
+	} else {
+		sl->level_shift = 0;
+	}
+	double p = 1.0;
+	for (i = 0; i < SL_MAX_LEVELS; i++) {	//P(level > i) = prob^(i+1)
+		p = p * prob;
+		sl->level_threshold[i] = (p >= 1.0) ? UINT32_MAX : (uint32_t)(p * 4294967296.0);
+	}
+	sl->grow_at = 0;
+	sl->version = 0;
+	set_grow_point(sl);
+	sl->rng = random_seed();
 	return sl;
 }
 
@@ -25,37 +110,70 @@ skiplist* create_skiplist(int max_levels, float prob) {
 
 void free_skiplist(skiplist* slst) {
 	clear_list(slst);
+	free_slnode(slst->head);
 	free(slst);
 }
 
 
 
 slnode* create_slnode(int key, int num_levels) {
-    slnode* node = myMalloc(sizeof(slnode));
+    slnode* node = myMalloc(SLNODE_BYTES(num_levels));
 	node->key = key;
-	slnode** array = myMalloc(num_levels * sizeof(slnode));
+	node->levels = num_levels;
 	int i = 0;
 	for (i = 0; i < num_levels; i++) {
-		array[i] = NULL;
+		node->next[i] = NULL;
+		SL_WIDTH(node)[i] = 0;
 	}
-	node->next = array;
-	
-	/////// Take this out for non-debug ///////
-	node->levels = num_levels;
-	//////////////////////////////////////////
-	
+
 	return node;
 }
 
 
 
 void free_slnode(slnode* node) {
-    free(node->next);
 	free(node);
 }
 
 
 
+slnode* alloc_slnode(skiplist* slst, int key, int num_levels) {
+	slarena* a = &slst->arena;
+	slnode* node = a->free_nodes[num_levels - 1];
+	if (node != NULL) {	//reuse a deleted node of the same height
+		a->free_nodes[num_levels - 1] = node->next[0];
+	} else {
+		size_t bytes = SLNODE_BYTES(num_levels);
+		if (a->chunks == NULL || a->chunks->used + bytes > a->chunks->size) {
+			slchunk* c = myMalloc(sizeof(slchunk) + SL_CHUNK_SIZE);
+			c->next = a->chunks;
+			c->used = 0;
+			c->size = SL_CHUNK_SIZE;
+			a->chunks = c;
+		}
+		node = (slnode*)(a->chunks->mem + a->chunks->used);
+		a->chunks->used = a->chunks->used + bytes;
+	}
+	node->key = key;
+	node->levels = num_levels;
+	int i;
+	for (i = 0; i < num_levels; i++) {
+		node->next[i] = NULL;
+		SL_WIDTH(node)[i] = 0;
+	}
+
+	return node;
+}
+
+
+
+void release_slnode(skiplist* slst, slnode* node, int num_levels) {
+	node->next[0] = slst->arena.free_nodes[num_levels - 1];
+	slst->arena.free_nodes[num_levels - 1] = node;
+}
+
+
+
 int is_list_empty(skiplist* slst) {
     if (slst->size == 0) { return 1; }
 	else { return 0; }
@@ -64,170 +182,546 @@ int is_list_empty(skiplist* slst) {
 
 
 void clear_list(skiplist* slst) {
-	while (slst->head->next[0] != NULL) {
-		int dont_need = delete(slst, slst->head->next[0]->key);
+	slarena* a = &slst->arena;
+	while (a->chunks != NULL) {	//every node lives in the arena, so drop it wholesale
+		slchunk* c = a->chunks;
+		a->chunks = c->next;
+		free(c);
+	}
+	int i;
+	for (i = 0; i < SL_MAX_LEVELS; i++) {
+		a->free_nodes[i] = NULL;
+	}
+	for (i = 0; i < slst->max_levels; i++) {
+		slst->head->next[i] = NULL;
 	}
+	slst->size = 0;
+	slst->cur_levels = 0;
+	slst->version = slst->version + 1;
+}
+
+
+
+void seed_skiplist(skiplist* slst, uint64_t seed) {
+	slst->rng = mix_seed(seed);
 }
 
 
 
-int generate_random_level(int max_levels, float prob) {
-	int head = 0;
-	int levels = 0;
-	head = rand() % 2;
-	while (head == 1 && levels < max_levels) {
-		levels = levels + 1;
-		head = rand() % 2;
+int generate_random_level(skiplist* slst) {
+	uint32_t r = next_random(slst);
+	int top = slst->max_levels - 1;
+	int level;
+	if (slst->level_shift != 0) {	//each trailing zero bit is a coin flip
+		level = (r == 0) ? top : __builtin_ctz(r) / slst->level_shift;
+	} else {
+		level = 0;
+		while (level < top && r < slst->level_threshold[level]) {
+			level = level + 1;
+		}
 	}
-	return levels;
+	return (level < top) ? level : top;
 }
 
 
 
 slnode* find(skiplist* slst, int key) {
-    printf("Finding key %i\n", key);
+    SL_TRACE("Finding key %i\n", key);
 	slnode* cur = slst->head;
 	int level = slst->cur_levels;
-	int i = 0;
-	for (i = 0; i < slst->size; i++) {	
-		if (level == 0 && (cur->next[level] == NULL || cur->next[level]->key > key)) {	//end of list or next is bigger, didn't find it
-			printf("Key not found\n");
-			printf("--------------------------------------\n");
-			return NULL;
-			
-		} else if (cur->next[level] == NULL || cur->next[level]->key > key) { //but level > 0, decrease level and look again
-			printf("Decrease level and search again\n");
+	while (level >= 0) {
+		slnode* next = cur->next[level];
+		if (next == NULL || next->key > key) { //end of level or next is bigger, decrease level and look again
+			SL_TRACE("Decrease level and search again\n");
 			level = level - 1;
-		
-		} else if (cur->next[level]->key < key) {	//keep searching
-			printf("Keep searching\n");
-			cur = cur->next[level];
-		
-		} else if (cur->next[level]->key == key) {	//found it
-			printf("Key %i found\n", key);
-			printf("--------------------------------------\n");
-			return cur->next[level];
+
+		} else if (next->key < key) {	//keep searching
+			SL_TRACE("Keep searching\n");
+			cur = next;
+
+		} else {	//found it
+			SL_TRACE("Key %i found\n", key);
+			SL_TRACE("--------------------------------------\n");
+			return next;
 		}
 	}
-	printf("Key not found\n");
-	printf("--------------------------------------\n");
+	SL_TRACE("Key not found\n");
+	SL_TRACE("--------------------------------------\n");
 	return NULL;
 }
 
 
 
+/*
+ * links a new node for key after the nodes in prev_array, which must hold the
+ * last node before key on levels 0..cur_levels, with their positions in rank
+ */
+static slnode* splice_new_node(skiplist* slst, slnode** prev_array, int* rank, int key) {
+	int new_level = generate_random_level(slst);
+	SL_TRACE("New level %i\n", new_level);
+	int j;
+	for (j = new_level; j > slst->cur_levels; j--) { //If new node will be highest add head nodes to array
+		prev_array[j] = slst->head;
+		rank[j] = 0;
+	}
+	slnode* new_node = alloc_slnode(slst, key, new_level + 1);
+	int* width = SL_WIDTH(new_node);
+	int pos = rank[0] + 1;	//position the new node takes
+	SL_TRACE("Update pointers from previous nodes\n");
+	for (j = 0; j <= new_level; j++) {
+		slnode* prev = prev_array[j];
+		int* prev_width = SL_WIDTH(prev);
+		new_node->next[j] = prev->next[j];
+		width[j] = (new_node->next[j] != NULL) ? rank[j] + prev_width[j] + 1 - pos : 0;
+		prev->next[j] = new_node;
+		prev_width[j] = pos - rank[j];
+	}
+	for (; j <= slst->cur_levels; j++) {	//links passing over the new node span one more
+		if (prev_array[j]->next[j] != NULL) {
+			SL_WIDTH(prev_array[j])[j] += 1;
+		}
+	}
+	if (slst->cur_levels < new_level) {
+		SL_TRACE("Update cur_levels to be %i\n", new_level);
+		slst->cur_levels = new_level;
+	}
+	SL_TRACE("Updating size to %i\n", slst->size + 1);
+	slst->size = slst->size + 1;
+	slst->version = slst->version + 1;
+	return new_node;
+}
+
+
+
 void insert(skiplist* slst, int key) {
-	printf("Inserting new key %i\n", key);
-	int new_level = generate_random_level(slst->max_levels, .5);
-	slnode* new_node = create_slnode(key, new_level);
-	printf("New level %i\n", new_level);
-	slnode** prev_array = myMalloc(new_level * sizeof(slnode));
+	SL_TRACE("Inserting new key %i\n", key);
+	if (slst->grow_at != 0 && slst->size >= slst->grow_at) {
+		grow_levels(slst);
+	}
+	slnode* prev_array[SL_MAX_LEVELS];	//last node before key on each level
+	int rank[SL_MAX_LEVELS];			//and its position
 	slnode* cur = slst->head;
+	int pos = 0;
 	int level = slst->cur_levels;
-	int done = 0;
-	int j = new_level;
-	for (j = new_level; j > level; j--) { //If new node will be highest add head nodes to array
-		prev_array[j] = cur;
-	}
-	
-	while (done == 0) {	
-		if (level == 0 && (cur->next[level] == NULL || cur->next[level]->key > key)) {	//end of list or next is bigger, can't decrease insert here
-			printf("End of list insert here\n");
-			printf("Update pointers from previous nodes\n");
-			int i = new_level;
-			for (i = new_level; i > 0; i--) { //update pointers from previous nodes
-				printf("Updating level %i\n", i);
-				prev_array[i]->next[i] = new_node;
-			}
-			printf("Updating level 0\n");
-			cur->next[level] = new_node; //For current node (level 0)
-			
-			if (slst->cur_levels < new_level) {
-				printf("Update cur_levels to be %i\n", new_level);
-				slst->cur_levels = new_level;
-			}
-			
-			printf("Updating size to %i\n", slst->size + 1);
-			slst->size = slst->size + 1;
-			done = 1;
-			
-		} else if (cur->next[level] == NULL || cur->next[level]->key > key) { //but level > 0, decrease level and look again
-			printf("Decrease level and search again\n");
-			if (level <= new_level) {	//add cur node to top of array if it's within range of new node levels
-				prev_array[level] = cur;
-			}
+
+	while (level >= 0) {
+		slnode* next = cur->next[level];
+		if (next == NULL || next->key > key) { //end of level or next is bigger, remember cur and go down
+			SL_TRACE("Decrease level and search again\n");
+			prev_array[level] = cur;
+			rank[level] = pos;
 			level = level - 1;
-		
-		} else if (cur->next[level]->key < key) {	//keep searching
-			printf("Keep searching\n");
-			cur = cur->next[level];
-		
-		} else if (cur->next[level]->key == key) {	//error bail
-			printf("Duplicate Key\n");
+
+		} else if (next->key < key) {	//keep searching
+			SL_TRACE("Keep searching\n");
+			pos = pos + SL_WIDTH(cur)[level];
+			cur = next;
+
+		} else {	//error bail
+			fprintf(stderr, "Duplicate Key %i\n", key);
 			exit(1);
 		}
 	}
+	splice_new_node(slst, prev_array, rank, key);
 }
 
 
 
 int delete(skiplist* slst, int key) {
-	printf("Deleting key %i\n", key);
-	int level = slst->cur_levels;
+	SL_TRACE("Deleting key %i\n", key);
+	slnode* update[SL_MAX_LEVELS];	//last node before key on each level
 	slnode* cur = slst->head;
-		
-	while (TRUE) {	
-		if (level == 0 && (cur->next[level] == NULL || cur->next[level]->key > key)) {	//end of list or next is bigger, can't decrease no key
-			printf("Key does not exist, delete failed\n");
-			return 0;
-			
-		} else if (cur->next[level] == NULL || cur->next[level]->key > key) { //but level > 0, decrease level and look again
-			printf("Decrease level and search again\n");
+	int level = slst->cur_levels;
+
+	while (level >= 0) {
+		slnode* next = cur->next[level];
+		if (next == NULL || next->key >= key) { //end of level or next is not smaller, remember cur and go down
+			SL_TRACE("Decrease level and search again\n");
+			update[level] = cur;
 			level = level - 1;
-		
-		} else if (cur->next[level]->key < key) {	//keep searching
-			printf("Keep searching\n");
+
+		} else {	//keep searching
+			SL_TRACE("Keep searching\n");
+			cur = next;
+		}
+	}
+
+	slnode* dead_node = cur->next[0];
+	if (dead_node == NULL || dead_node->key != key) {
+		SL_TRACE("Key does not exist, delete failed\n");
+		return 0;
+	}
+	int* dead_width = SL_WIDTH(dead_node);
+	for (level = 0; level <= slst->cur_levels; level++) {
+		slnode* prev = update[level];
+		if (prev->next[level] == dead_node) {	//jump over the undesired node on this level
+			prev->next[level] = dead_node->next[level];
+			SL_WIDTH(prev)[level] += dead_width[level] - 1;
+		} else if (prev->next[level] != NULL) {	//or just span one less
+			SL_WIDTH(prev)[level] -= 1;
+		}
+	}
+	release_slnode(slst, dead_node, dead_node->levels);
+	slst->size = slst->size - 1;
+	slst->version = slst->version + 1;
+	while (slst->cur_levels > 0 && slst->head->next[slst->cur_levels] == NULL) {
+		slst->cur_levels = slst->cur_levels - 1;
+	}
+	SL_TRACE("Key deleted\n");
+	return 1;
+}
+
+
+
+/**********************************************************
+ * Functions for building a skiplist in bulk
+ ***********************************************************/
+
+void bulk_load(skiplist* slst, const int* keys, int n, int deterministic) {
+	clear_list(slst);
+	if (n <= 0) {
+		return;
+	}
+	while (slst->grow_at != 0 && n >= slst->grow_at) {
+		grow_levels(slst);
+	}
+	int top = slst->max_levels - 1;
+	int base = (slst->prob > 0.0f && slst->prob < 1.0f) ? (int)(1.0f / slst->prob + 0.5f) : 2;
+	unsigned char* heights = myMalloc(n);
+	size_t bytes = 0;
+	int i, j;
+	for (i = 0; i < n; i++) {	//pick every level first so one block can hold all the nodes
+		if (i > 0 && keys[i] <= keys[i - 1]) {
+			fprintf(stderr, "Keys not strictly increasing at %i\n", keys[i]);
+			exit(1);
+		}
+		int level = 0;
+		if (deterministic) {
+			int pos = i + 1;
+			while (level < top && pos % base == 0) {
+				pos = pos / base;
+				level = level + 1;
+			}
+		} else {
+			level = generate_random_level(slst);
+		}
+		heights[i] = (unsigned char)(level + 1);
+		bytes = bytes + SLNODE_BYTES(level + 1);
+	}
+
+	slchunk* c = myMalloc(sizeof(slchunk) + bytes);
+	c->used = bytes;
+	c->size = bytes;
+	c->next = slst->arena.chunks;	//the arena frees it with the rest
+	slst->arena.chunks = c;
+
+	slnode* last[SL_MAX_LEVELS];	//the node each level currently ends at
+	int last_pos[SL_MAX_LEVELS];	//and its position
+	for (j = 0; j <= top; j++) {
+		last[j] = slst->head;
+		last_pos[j] = 0;
+	}
+	char* mem = c->mem;
+	int cur_levels = 0;
+	for (i = 0; i < n; i++) {
+		slnode* node = (slnode*)mem;
+		int h = heights[i];
+		mem = mem + SLNODE_BYTES(h);
+		node->key = keys[i];
+		node->levels = h;
+		for (j = 0; j < h; j++) {
+			last[j]->next[j] = node;
+			SL_WIDTH(last[j])[j] = i + 1 - last_pos[j];
+			last[j] = node;
+			last_pos[j] = i + 1;
+		}
+		if (h - 1 > cur_levels) {
+			cur_levels = h - 1;
+		}
+	}
+	for (j = 0; j <= top; j++) {
+		last[j]->next[j] = NULL;
+		SL_WIDTH(last[j])[j] = 0;
+	}
+	free(heights);
+
+	slst->size = n;
+	slst->cur_levels = cur_levels;
+	slst->version = slst->version + 1;
+}
+
+
+
+/**********************************************************
+ * Functions for finger searches of the skiplist
+ ***********************************************************/
+
+/* finds the last node on each level whose key is below key, the head if there is none, and its position */
+static void find_before(skiplist* slst, int key, slnode** before, int* rank) {
+	slnode* cur = slst->head;
+	int pos = 0;
+	int level;
+	for (level = slst->cur_levels; level >= 0; level--) {
+		while (cur->next[level] != NULL && cur->next[level]->key < key) {
+			pos = pos + SL_WIDTH(cur)[level];
+			cur = cur->next[level];
+		}
+		before[level] = cur;
+		rank[level] = pos;
+	}
+}
+
+
+
+void init_finger(slfinger* f, skiplist* slst) {
+	f->slst = slst;
+	f->levels = 0;
+	f->version = slst->version;
+}
+
+
+
+/*
+ * Points f->path at the last node before key on every level.  When the
+ * previous path is still good, climbs from the bottom only until the path
+ * node is before key and its successor is not, then descends from there.
+ * Keys a distance d away from the previous one cost O(log d) instead of
+ * O(log n), in either direction.
+ */
+static void finger_search(slfinger* f, int key) {
+	skiplist* slst = f->slst;
+	slnode** path = f->path;
+	int top = slst->cur_levels;
+	int level = 0;
+	if (f->levels == 0 || f->version != slst->version || f->levels <= top) {
+		find_before(slst, key, path, f->rank);	//no usable finger, start from the head
+		f->levels = top + 1;
+		f->version = slst->version;
+		return;
+	}
+	while (level < top && ((path[level] != slst->head && path[level]->key >= key)	//key is behind this level's node
+			|| (path[level]->next[level] != NULL && path[level]->next[level]->key < key))) {	//or past its successor
+		level = level + 1;
+	}
+	slnode* cur = path[level];
+	int pos = f->rank[level];
+	if (cur != slst->head && cur->key >= key) {
+		cur = slst->head;	//behind even the top of the path
+		pos = 0;
+	}
+	for (; level >= 0; level--) {	//the levels above are still right, redo the ones below
+		while (cur->next[level] != NULL && cur->next[level]->key < key) {
+			pos = pos + SL_WIDTH(cur)[level];
 			cur = cur->next[level];
-		
-		} else if (cur->next[level]->key == key && level != 0) {	//found it, update pointer and keep going
-			slnode* tmp = cur->next[level]->next[level];
-			cur->next[level] = tmp;
-			level = level - 1;
-			
-		} else if (cur->next[level]->key == key && level == 0) {	//done, delete key
-			printf("Done updating pointers\n");
-			slnode* dead_node =  cur->next[level];
-			slnode* tmp = cur->next[level]->next[level];
-			cur->next[level] = tmp;
-			free_slnode(dead_node);	//all pointers should have been updated by jumping the undesired node
-			printf("Key deleted\n");
-			return 1;
 		}
+		path[level] = cur;
+		f->rank[level] = pos;
 	}
 }
 
 
 
+slnode* finger_find(slfinger* f, int key) {
+	finger_search(f, key);
+	slnode* n = f->path[0]->next[0];
+	return (n != NULL && n->key == key) ? n : NULL;
+}
+
+
+
+void finger_insert(slfinger* f, int key) {
+	skiplist* slst = f->slst;
+	if (slst->grow_at != 0 && slst->size >= slst->grow_at) {
+		grow_levels(slst);
+	}
+	finger_search(f, key);
+	slnode* n = f->path[0]->next[0];
+	if (n != NULL && n->key == key) {	//error bail
+		fprintf(stderr, "Duplicate Key %i\n", key);
+		exit(1);
+	}
+	splice_new_node(slst, f->path, f->rank, key);	//the path stays correct for the new key
+	f->levels = slst->cur_levels + 1;
+	f->version = slst->version;
+}
+
+
+
+/**********************************************************
+ * Functions for ordered access to the skiplist
+ ***********************************************************/
+
+slnode* seek_lower_bound(skiplist* slst, int key) {
+	slnode* before[SL_MAX_LEVELS];
+	int rank[SL_MAX_LEVELS];
+	find_before(slst, key, before, rank);
+	return before[0]->next[0];
+}
+
+
+
+int rank_of(skiplist* slst, int key) {
+	slnode* cur = slst->head;
+	int pos = 0;
+	int level;
+	for (level = slst->cur_levels; level >= 0; level--) {
+		while (cur->next[level] != NULL && cur->next[level]->key < key) {
+			pos = pos + SL_WIDTH(cur)[level];
+			cur = cur->next[level];
+		}
+	}
+	return pos;
+}
+
+
+
+slnode* select_at(skiplist* slst, int index) {
+	if (index < 0 || index >= slst->size) {
+		return NULL;
+	}
+	int target = index + 1;	//the head is position 0
+	slnode* cur = slst->head;
+	int pos = 0;
+	int level;
+	for (level = slst->cur_levels; level >= 0; level--) {
+		while (cur->next[level] != NULL && pos + SL_WIDTH(cur)[level] <= target) {
+			pos = pos + SL_WIDTH(cur)[level];
+			cur = cur->next[level];
+		}
+	}
+	return cur;
+}
+
+
+
+int count_range(skiplist* slst, int low, int high) {
+	if (low > high) {
+		return 0;
+	}
+	int below_high = (high == INT_MAX) ? slst->size : rank_of(slst, high + 1);	//the keys at most high
+	return below_high - rank_of(slst, low);
+}
+
+
+
+int delete_range(skiplist* slst, int low, int high) {
+	if (low > high) {
+		return 0;
+	}
+	slnode* before[SL_MAX_LEVELS];
+	slnode* after[SL_MAX_LEVELS];	//walks each level through the run being deleted
+	int rank[SL_MAX_LEVELS];
+	int span[SL_MAX_LEVELS];		//positions from before[level] to after[level]
+	int top = slst->cur_levels;
+	int level;
+	find_before(slst, low, before, rank);
+	for (level = 0; level <= top; level++) {
+		after[level] = before[level]->next[level];
+		span[level] = SL_WIDTH(before[level])[level];
+	}
+
+	int count = 0;
+	slnode* n = before[0]->next[0];
+	while (n != NULL && n->key <= high) {
+		int* width = SL_WIDTH(n);
+		for (level = 0; level < n->levels; level++) {	//n is the next node met on each of its levels
+			after[level] = n->next[level];
+			span[level] = span[level] + width[level];
+		}
+		release_slnode(slst, n, n->levels);
+		count = count + 1;
+		n = after[0];
+	}
+
+	for (level = 0; level <= top; level++) {	//splice the run out of every level
+		before[level]->next[level] = after[level];
+		SL_WIDTH(before[level])[level] = (after[level] != NULL) ? span[level] - count : 0;
+	}
+	slst->size = slst->size - count;
+	slst->version = slst->version + 1;
+	while (slst->cur_levels > 0 && slst->head->next[slst->cur_levels] == NULL) {
+		slst->cur_levels = slst->cur_levels - 1;
+	}
+	return count;
+}
+
+
+
+void iter_seek(sliter* it, skiplist* slst, int key) {
+	it->slst = slst;
+	it->node = seek_lower_bound(slst, key);
+}
+
+
+
+void iter_seek_first(sliter* it, skiplist* slst) {
+	it->slst = slst;
+	it->node = slst->head->next[0];
+}
+
+
+
+void iter_seek_last(sliter* it, skiplist* slst) {
+	slnode* cur = slst->head;
+	int level;
+	for (level = slst->cur_levels; level >= 0; level--) {
+		while (cur->next[level] != NULL) {
+			cur = cur->next[level];
+		}
+	}
+	it->slst = slst;
+	it->node = (cur == slst->head) ? NULL : cur;
+}
+
+
+
+int iter_valid(sliter* it) {
+	return it->node != NULL;
+}
+
+
+
+int iter_key(sliter* it) {
+	return it->node->key;
+}
+
+
+
+void iter_next(sliter* it) {
+	it->node = it->node->next[0];
+}
+
+
+
+void iter_prev(sliter* it) {
+	slnode* before[SL_MAX_LEVELS];
+	int rank[SL_MAX_LEVELS];
+	find_before(it->slst, it->node->key, before, rank);
+	it->node = (before[0] == it->slst->head) ? NULL : before[0];
+}
+
+
+
 void print_list(skiplist* slst) {
 	printf("Printing List\n");
 	if (slst->size != 0) {
 		slnode* cur = slst->head;
-		
+
 		while (cur->next[0] != NULL) {
 			printf("%i", cur->next[0]->key);
-			
-			/////// Take this out for non-debug ///////
+
+#ifdef DEBUG_SKIPLIST
 			int i = 0;
 			for (i = 0; i < cur->next[0]->levels; i++) {
 				printf("[]");
 			}
-			//////////////////////////////////////////
-			
+#endif
+
 			printf("\n");
 			cur = cur->next[0];
 		}
 		printf("--------------------------------------\n");
-		
+
 	} else {
 		printf("Empty skiplist------------------------\n");
 	}
@@ -235,68 +729,299 @@ void print_list(skiplist* slst) {
 
 
 /**********************************************************
- * The following main function is for debugging this 
- * skiplist.  Supply the DEBUG flag to to compiler to 
+ * The following main function is for debugging this
+ * skiplist.  Supply the DEBUG flag to to compiler to
  * compile a skiplist containing this main function.
  ***********************************************************/
 #ifdef DEBUG_SKIPLIST
+/* checks every span width against the positions found by walking level 0 */
+static void check_ranks(skiplist* slst) {
+	slnode* n = slst->head;
+	int pos = 0;
+	int level;
+	while (n != NULL) {
+		for (level = 1; level < n->levels && n != slst->head; level++) {
+			if (n->next[level] != NULL) {
+				assert(rank_of(slst, n->next[level]->key) == pos + SL_WIDTH(n)[level] - 1);
+			}
+		}
+		if (n->next[0] != NULL) {
+			assert(SL_WIDTH(n)[0] == 1);
+			assert(select_at(slst, pos) == n->next[0]);
+			assert(rank_of(slst, n->next[0]->key) == pos);
+		}
+		n = n->next[0];
+		pos = pos + 1;
+	}
+	assert(pos == slst->size + 1);
+	assert(select_at(slst, slst->size) == NULL && select_at(slst, -1) == NULL);
+}
+
+
+
 int main(void) {
     printf("====================\n");
     printf("Debugging Skiplist\n");
     printf("====================\n");
-	
+
 	/* NOTE
 		I added a parameter to the slnode to store the number of levels generated
 		for each node. This is only used when printing the list so you can see it
 		visually. I was gonna take it out but it looks nice so don't count it against
 		me it doesn't impact the code anywhere else.:)
 	*/
-	
+
     srand(time(NULL));
-    
+
     skiplist* slst = create_skiplist(16, 0.5);
 	print_list(slst);  // should print an empty list
-    
+
     insert(slst, 1);
 	print_list(slst);
-	
+
 	insert(slst, 3);
 	print_list(slst);
-	
+
 	insert(slst, 5);
 	print_list(slst);
-	
+
 	insert(slst, 6);
 	print_list(slst);
-	
+
 	insert(slst, 8);
 	print_list(slst);
-	
+
 	insert(slst, 10);
 	print_list(slst);
-	
+
 	insert(slst, 13);
 	print_list(slst);
-	
+
 	slnode* n = find(slst, 6);
-		
+	assert(n != NULL && n->key == 6);
+
 	slnode* n2 = find(slst, 20);	//doesn't exist, make sure doesn't break
+	assert(n2 == NULL);
 
 	int who = delete(slst, 1);		//first node
 	print_list(slst);
-	
+	assert(who == 1);
+
 	int what = delete(slst, 6);		//middle node
 	print_list(slst);
-	
+	assert(what == 1 && find(slst, 6) == NULL);
+
 	int where = delete(slst, 13);	//last node
 	print_list(slst);
-	
+	assert(where == 1);
+
 	int when = delete(slst, 20);	//doesn't exist, make sure doesn't break
 	print_list(slst);
-	
-    free_skiplist(slst);
+	assert(when == 0 && slst->size == 4);
+
+	insert(slst, 6);		//reuses a deleted node when the height matches
+	assert(find(slst, 6) != NULL && slst->size == 5);
+
+	clear_list(slst);
 	print_list(slst);	//empty list
-	
+
+	int i;
+	for (i = 0; i < 3000; i++) {	//spans more than one arena chunk
+		insert(slst, (i * 7919) % 3001);
+	}
+	assert(slst->size == 3000);
+	slnode* cur = slst->head->next[0];
+	while (cur->next[0] != NULL) {
+		assert(cur->key < cur->next[0]->key);
+		cur = cur->next[0];
+	}
+	for (i = 0; i < 3000; i += 2) {
+		assert(delete(slst, (i * 7919) % 3001) == 1);
+	}
+	assert(slst->size == 1500);
+	assert(find(slst, 7919 % 3001) != NULL);
+
+    free_skiplist(slst);
+
+	printf("Checking level distribution\n");
+	float probs[3] = {0.5f, 0.25f, 0.3f};
+	int p;
+	for (p = 0; p < 3; p++) {
+		slst = create_skiplist(SL_MAX_LEVELS, probs[p]);
+		seed_skiplist(slst, 12345);
+		int counts[SL_MAX_LEVELS] = {0};
+		int draws = 1000000;
+		for (i = 0; i < draws; i++) {
+			counts[generate_random_level(slst)]++;
+		}
+		double at_least = draws;
+		int level;
+		for (level = 1; level < 4; level++) {	//fraction reaching each level should be about prob^level
+			at_least = at_least - counts[level - 1];
+			double expected = pow(probs[p], level);
+			printf("prob %.2f level %i: %.4f (expected %.4f)\n", probs[p], level, at_least / draws, expected);
+			assert(fabs(at_least / draws - expected) < 0.01);
+		}
+		free_skiplist(slst);
+	}
+
+	printf("Checking range scans and iterators\n");
+	slst = create_skiplist(16, 0.5);
+	for (i = 0; i < 100; i++) {
+		insert(slst, i * 10);
+	}
+	sliter it;
+	iter_seek(&it, slst, 95);
+	assert(iter_valid(&it) && iter_key(&it) == 100);
+	iter_next(&it);
+	assert(iter_key(&it) == 110);
+	iter_prev(&it);
+	iter_prev(&it);
+	assert(iter_key(&it) == 90);
+	iter_seek_first(&it, slst);
+	iter_prev(&it);
+	assert(!iter_valid(&it));
+	iter_seek_last(&it, slst);
+	assert(iter_key(&it) == 990);
+	int expect = 990;
+	while (iter_valid(&it)) {	//walk the whole list backwards
+		assert(iter_key(&it) == expect);
+		expect = expect - 10;
+		iter_prev(&it);
+	}
+	assert(expect == -10);
+	iter_seek(&it, slst, 991);
+	assert(!iter_valid(&it));
+	assert(count_range(slst, 95, 205) == 11);
+	assert(count_range(slst, 205, 95) == 0);
+	assert(count_range(slst, INT_MIN, INT_MAX) == slst->size);
+	assert(count_range(slst, 991, INT_MAX) == 0 && count_range(slst, 100, 100) == 1);
+	assert(delete_range(slst, 95, 205) == 11);
+	assert(slst->size == 89);
+	assert(count_range(slst, 0, 1000) == 89);
+	assert(find(slst, 90) != NULL && find(slst, 100) == NULL && find(slst, 210) != NULL);
+	for (i = 10; i <= 20; i++) {	//deleted nodes are reused
+		insert(slst, i * 10);
+	}
+	assert(delete_range(slst, 500, 5000) == 50);
+	iter_seek_last(&it, slst);
+	assert(iter_key(&it) == 490);
+	assert(delete_range(slst, -5, 5000) == 50);
+	assert(is_list_empty(slst) && slst->cur_levels == 0);
+	iter_seek_last(&it, slst);
+	assert(!iter_valid(&it));
+	free_skiplist(slst);
+
+	printf("Checking finger searches\n");
+	slst = create_skiplist(4, 0.5);
+	slfinger f;
+	init_finger(&f, slst);
+	for (i = 0; i < 2000; i++) {	//mostly ascending, with a step back now and then
+		int key = (i % 100 == 99) ? i * 10 - 995 : i * 10;
+		finger_insert(&f, key);
+		if (i % 10 == 0) {
+			assert(finger_find(&f, key) != NULL);
+		}
+		if (i == 1000) {
+			insert(slst, 5);	//a change behind the finger's back
+		}
+	}
+	assert(slst->size == 2001);
+	assert(slst->max_levels > 4);
+	iter_seek_first(&it, slst);
+	int last = INT_MIN;
+	for (i = 0; i < 2001; i++) {
+		assert(iter_key(&it) > last);
+		last = iter_key(&it);
+		iter_next(&it);
+	}
+	assert(!iter_valid(&it));
+	init_finger(&f, slst);
+	for (i = 0; i < 2000; i++) {
+		int key = (i % 100 == 99) ? i * 10 - 995 : i * 10;
+		assert(finger_find(&f, key) != NULL && find(slst, key) != NULL);
+		assert(finger_find(&f, key + 1) == NULL);
+	}
+	free_skiplist(slst);
+
+	printf("Checking bulk loads\n");
+	int* sorted = myMalloc(5000 * sizeof(int));
+	for (i = 0; i < 5000; i++) {
+		sorted[i] = i * 3;
+	}
+	for (p = 0; p < 3; p++) {
+		slst = create_skiplist(4, probs[p]);
+		insert(slst, 7);	//replaced by the load
+		bulk_load(slst, sorted, 5000, p != 2);
+		assert(slst->size == 5000 && find(slst, 7) == NULL);
+		assert(slst->max_levels > 4);
+		for (i = 0; i < 5000; i += 7) {
+			assert(find(slst, i * 3) != NULL && find(slst, i * 3 + 1) == NULL);
+		}
+		assert(count_range(slst, 0, 3 * 5000) == 5000);
+		insert(slst, 1);	//the loaded list takes ordinary updates
+		assert(delete(slst, 3) == 1);
+		assert(delete_range(slst, 0, 2999) == 1000);	//999 loaded multiples of 3 plus the 1
+		assert(seek_lower_bound(slst, 0)->key == 3000);
+		free_skiplist(slst);
+	}
+	slst = create_skiplist(16, 0.5);
+	bulk_load(slst, sorted, 16, TRUE);	//deterministic towers follow the trailing zeros of i+1
+	assert(slst->cur_levels == 4);
+	assert(slst->head->next[4]->key == 15 * 3);
+	assert(slst->head->next[2]->key == 3 * 3 && slst->head->next[2]->next[2]->key == 7 * 3);
+	free_skiplist(slst);
+	free(sorted);
+
+	printf("Checking rank and select\n");
+	slst = create_skiplist(2, 0.5);
+	assert(rank_of(slst, 5) == 0 && select_at(slst, 0) == NULL);
+	seed_skiplist(slst, 7);
+	for (i = 0; i < 3000; i++) {	//shuffled inserts of the even keys below 6000
+		insert(slst, ((i * 1237) % 3000) * 2);
+		if (i % 500 == 0) {
+			check_ranks(slst);
+		}
+	}
+	check_ranks(slst);
+	assert(rank_of(slst, 101) == 51 && rank_of(slst, 100) == 50);
+	assert(select_at(slst, 50)->key == 100);
+	for (i = 0; i < 3000; i += 3) {
+		assert(delete(slst, i * 2) == 1);
+	}
+	assert(delete(slst, 1) == 0);
+	check_ranks(slst);
+	assert(delete_range(slst, 1000, 2000) == 334);
+	check_ranks(slst);
+	init_finger(&f, slst);
+	for (i = 0; i < 3000; i += 3) {
+		if (i * 2 < 1000 || i * 2 > 2000) {
+			finger_insert(&f, i * 2);
+		}
+	}
+	check_ranks(slst);
+	assert(select_at(slst, slst->size - 1)->key == 5998);
+	sorted = myMalloc(1000 * sizeof(int));
+	for (i = 0; i < 1000; i++) {
+		sorted[i] = i * 5;
+	}
+	bulk_load(slst, sorted, 1000, FALSE);
+	check_ranks(slst);
+	insert(slst, 7);
+	assert(rank_of(slst, 7) == 2 && select_at(slst, 3)->key == 10);
+	check_ranks(slst);
+	free(sorted);
+	free_skiplist(slst);
+
+	slst = create_skiplist(2, 0.5);	//max_levels grows with the size
+	for (i = 0; i < 100; i++) {
+		insert(slst, i);
+	}
+	printf("max_levels grew to %i\n", slst->max_levels);
+	assert(slst->max_levels == 7);
+	assert(find(slst, 99) != NULL);
+	free_skiplist(slst);
+
     return 0;
 }
 #endif
@@ -1,36 +1,89 @@
 #ifndef _skiplist_h
 #define _skiplist_h
 
+#include <stddef.h>
+#include <stdint.h>
+
+#define SL_MAX_LEVELS 32   // hard limit on max_levels, a node is at most this tall
 
-/* struct defining a skiplist node */
-typedef struct skiplist_node_struct {
-    int key;                            // node stores a single integer
-    struct skiplist_node_struct** next; // pointer to an array of next pointers
-	
-	/////// Take this out for non-debug ///////
-	int levels;
-	//////////////////////////////////////////
 
+/*
+ * struct defining a skiplist node, allocated in one piece with its tower of
+ * next pointers followed by their span widths: width i is how many positions
+ * next[i] moves forward, which is what rank_of and select_at add up.  A
+ * width is only kept while its next pointer is not NULL.
+ */
+typedef struct skiplist_node_struct {
+    int key;                             // node stores a single integer
+    int levels;                          // height of the tower
+    struct skiplist_node_struct* next[]; // the tower of next pointers, next[0] is the bottom level
 } slnode;
 
 
+/* struct defining a chunk of memory that skiplist nodes are carved from */
+typedef struct skiplist_chunk_struct {
+    struct skiplist_chunk_struct* next; // previously filled chunk
+    size_t used;                        // bytes handed out so far
+    size_t size;                        // bytes available in mem
+    char mem[];                         // the node storage
+} slchunk;
+
+
+/* struct defining the node arena of a skiplist, deleted nodes are kept per height for reuse */
+typedef struct skiplist_arena_struct {
+    slchunk* chunks;                     // chunk currently being filled, links to older ones
+    slnode* free_nodes[SL_MAX_LEVELS];   // deleted nodes by height-1, chained through next[0]
+} slarena;
+
+
 typedef struct skiplist_struct {
-    int size;        // number of nodes currently in the skiplist (not counting
+    int size;        // number of nodes currently in the skiplist (not counting the head)
     float prob;      // probability with which to add new levels (0.5 for coin flip)
     int max_levels;  // maximum number of levels for this skiplist, Pugh suggests 16 for lists up to 65,536 nodes
-    int cur_levels;  // current number of levels in this skiplist, cur_levels <= max_levels
+    int cur_levels;  // highest level currently in use, cur_levels < max_levels
     slnode* head;    // head of the skiplist; it contains no data; should be maximum height
     slnode* tail;    // tail node should contain the maximum possible integer (INT_MAX), need only be 1 level
+    slarena arena;   // where the nodes of the skiplist are allocated
+    uint64_t rng;    // xorshift64* state used to draw node levels
+    int level_shift; // 1 when prob is 1/2, 2 when it is 1/4 (levels come from trailing zeros), else 0
+    uint32_t level_threshold[SL_MAX_LEVELS]; // prob^(i+1) scaled to 2^32, for any other prob
+    long long grow_at; // size at which max_levels is raised by one, 0 once it reached SL_MAX_LEVELS
+    unsigned long version; // bumped by every change, tells fingers whether their path still holds
 } skiplist;
 
 
+/*
+ * struct defining a finger into a skiplist: the search path of the last
+ * finger operation.  The next finger operation starts from that path
+ * instead of the head, so keys arriving in nearly sorted order are found
+ * and inserted close to O(1) each.  A change made to the skiplist through
+ * anything but this finger makes it fall back to one full search.
+ */
+typedef struct skiplist_finger_struct {
+    skiplist* slst;                 // the skiplist this finger points into
+    int levels;                     // number of valid entries in path, 0 before the first search
+    unsigned long version;          // skiplist version the path was recorded at
+    slnode* path[SL_MAX_LEVELS];    // last node before the previous key on each level
+    int rank[SL_MAX_LEVELS];        // position of each path node, the head is 0
+} slfinger;
+
+
+/* struct defining a position in a skiplist, for walking its keys in order */
+typedef struct skiplist_iter_struct {
+    skiplist* slst;  // the skiplist being walked
+    slnode* node;    // node at the current position, NULL once past either end
+} sliter;
+
+
 /**********************************************************
  * function prototypes
  ***********************************************************/
 
 /**
  * Creates and initializes a skiplist. 
- * @param max_levels - the maximum number of levels to allow for this skiplist
+ * @param max_levels - the maximum number of levels to start with, at most
+ *                     SL_MAX_LEVELS.  It is raised as the skiplist grows so
+ *                     that prob^max_levels stays below 1/size.
  * @param prob - probability with which to add new levels (0.5 for coin flip)
  * @return a pointer to the newly created skiplist
  **/
@@ -43,7 +96,9 @@ skiplist* create_skiplist(int max_levels, float prob);
 void free_skiplist(skiplist* slst);
 
 /**
- * Creates and initializes a skiplist node
+ * Creates and initializes a skiplist node in a single allocation of its own.
+ * The nodes inside a skiplist come from its arena instead (see alloc_slnode),
+ * this is used for the head.
  * @param key - the key to store in this skiplist node
  * @param num_levels - the number of levels for this node
  * @return a pointer to the newly created skiplist node
@@ -51,11 +106,29 @@ void free_skiplist(skiplist* slst);
 slnode* create_slnode(int key, int num_levels);
 
 /**
- * Frees ALL the memory for the specified skiplist node
+ * Frees ALL the memory for a node made by create_slnode
  * @param node - a pointer to the skiplist node to be freed
  **/
 void free_slnode(slnode* node);
 
+/**
+ * Takes a node for the specified skiplist from its arena, reusing a deleted
+ * node of the same height when there is one.
+ * @param slst - the skiplist the node will belong to
+ * @param key - the key to store in this skiplist node
+ * @param num_levels - the number of levels for this node
+ * @return a pointer to the node, its next pointers are all NULL
+ **/
+slnode* alloc_slnode(skiplist* slst, int key, int num_levels);
+
+/**
+ * Hands a node removed from the specified skiplist back to its arena.
+ * @param slst - the skiplist the node belonged to
+ * @param node - the node to give back
+ * @param num_levels - the number of levels of the node
+ **/
+void release_slnode(skiplist* slst, slnode* node, int num_levels);
+
 /**
  * Checks to see if the skiplist is empty
  * @param slst - a pointer to the skiplist to check
@@ -70,11 +143,23 @@ int is_list_empty(skiplist* slst);
 void clear_list(skiplist* slst);
 
 /**
- * Ramdomly generates the level of a new skip list node.
+ * Seeds the random generator the skiplist uses to pick node levels, so that
+ * a run can be repeated.  create_skiplist seeds it from the clock.
+ * @param slst - a pointer to the skiplist
+ * @param seed - any value
+ **/
+void seed_skiplist(skiplist* slst, uint64_t seed);
+
+/**
+ * Ramdomly generates the level of a new skip list node, with level k or
+ * higher happening with probability prob^k.  Uses one draw from the
+ * skiplist's own generator, so threads working on different skiplists
+ * don't share any state.
  * Levels begin at 0 (not at 1 like in Pugh's paper).
+ * @param slst - a pointer to the skiplist the node is for
  * @return an integer value between 0 and max_levels-1
  **/
-int generate_random_level(int max_levels, float prob);
+int generate_random_level(skiplist* slst);
 
 /**
  * Searches a skiplist for a node containing the specified key.
@@ -115,6 +200,147 @@ void insert(skiplist* slst, int key);
  **/
 int delete(skiplist* slst, int key);
 
+/**
+ * Counts the keys smaller than key, in O(log n) by adding up the span
+ * widths along the search path.
+ * @param slst - the skiplist to search
+ * @param key - the key value to rank, need not be in the skiplist
+ * @return the number of keys in the skiplist below key
+ **/
+int rank_of(skiplist* slst, int key);
+
+/**
+ * Finds the node at a position in key order, in O(log n).  select_at(slst,
+ * rank_of(slst, key)) is the node for key when key is present.
+ * @param slst - the skiplist to search
+ * @param index - position of the node, 0 is the smallest key
+ * @return the node at that position, NULL if index is out of range
+ **/
+slnode* select_at(skiplist* slst, int index);
+
+/**
+ * Replaces the contents of the skiplist with the keys of a sorted array,
+ * building every tower bottom-up in one linear pass.  All nodes are carved
+ * from a single allocation in key order, so a scan afterwards walks memory
+ * sequentially.  max_levels is raised first if n needs more levels.
+ **************************************************************
+ * The keys must be strictly increasing, otherwise an error is
+ * printed and the program terminates.
+ **************************************************************
+ * @param slst - the skiplist to fill
+ * @param keys - the sorted keys
+ * @param n - the number of keys
+ * @param deterministic - TRUE to give key i the level of a perfectly
+ *                        balanced skiplist (how many times 1/prob divides
+ *                        i+1), FALSE to draw levels at random as insert does
+ **/
+void bulk_load(skiplist* slst, const int* keys, int n, int deterministic);
+
+/**
+ * Initializes a finger for the specified skiplist.  A finger must only be
+ * used by one thread at a time, like the skiplist itself.
+ * @param f - the finger to initialize
+ * @param slst - the skiplist it points into
+ **/
+void init_finger(slfinger* f, skiplist* slst);
+
+/**
+ * Searches for a key starting from the finger's last position.  Costs
+ * O(log d) where d is the distance from the previous finger key.
+ * @param f - the finger to search with
+ * @param key - the key value for which to search
+ * @return the node that contains the key, NULL if it isn't in the skiplist
+ **/
+slnode* finger_find(slfinger* f, int key);
+
+/**
+ * Inserts a key starting from the finger's last position, like insert.
+ * Appending ever larger keys costs O(1) expected per key.
+ **************************************************************
+ * Duplicate keys print an error and terminate the program.
+ **************************************************************
+ * @param f - the finger to insert with
+ * @param key - the key value to store in the new skiplist node
+ **/
+void finger_insert(slfinger* f, int key);
+
+/**
+ * Finds the first node whose key is greater than or equal to key.
+ * @param slst - a pointer to the skiplist to search
+ * @param key - the lower bound
+ * @return the node, NULL if every key is smaller than key
+ **/
+slnode* seek_lower_bound(skiplist* slst, int key);
+
+/**
+ * Counts the keys in [low, high], in O(log n) as the difference of two
+ * ranks.
+ * @param slst - a pointer to the skiplist
+ * @param low - the smallest key to count
+ * @param high - the largest key to count
+ * @return the number of keys in the range
+ **/
+int count_range(skiplist* slst, int low, int high);
+
+/**
+ * Deletes every key in [low, high] with a single search, unlinking the
+ * whole run of nodes from each level at once.
+ * @param slst - a pointer to the skiplist
+ * @param low - the smallest key to delete
+ * @param high - the largest key to delete
+ * @return the number of keys deleted
+ **/
+int delete_range(skiplist* slst, int low, int high);
+
+/**
+ * Positions an iterator at the first key greater than or equal to key.
+ * @param it - the iterator to position
+ * @param slst - the skiplist to walk
+ * @param key - the lower bound
+ **/
+void iter_seek(sliter* it, skiplist* slst, int key);
+
+/**
+ * Positions an iterator at the smallest key of the skiplist.
+ * @param it - the iterator to position
+ * @param slst - the skiplist to walk
+ **/
+void iter_seek_first(sliter* it, skiplist* slst);
+
+/**
+ * Positions an iterator at the largest key of the skiplist.
+ * @param it - the iterator to position
+ * @param slst - the skiplist to walk
+ **/
+void iter_seek_last(sliter* it, skiplist* slst);
+
+/**
+ * Checks whether an iterator is at a key.
+ * @param it - the iterator
+ * @return TRUE if positioned at a key, FALSE once past either end
+ **/
+int iter_valid(sliter* it);
+
+/**
+ * Gets the key at the iterator.  The iterator must be valid.
+ * @param it - the iterator
+ * @return the key at the current position
+ **/
+int iter_key(sliter* it);
+
+/**
+ * Moves the iterator to the next larger key, O(1).
+ * @param it - the iterator, must be valid
+ **/
+void iter_next(sliter* it);
+
+/**
+ * Moves the iterator to the next smaller key.  Nodes have no backward
+ * links, so this searches for the predecessor in O(log n).
+ * @param it - the iterator, must be valid
+ **/
+void iter_prev(sliter* it);
+
 /**
  * Prints the contents of the skiplist, in order, from
  * head to tail
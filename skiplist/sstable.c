@@ -0,0 +1,672 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "utils.h"
+#include "memtable.h"
+#include "sstable.h"
+
+#define SST_MAGIC 0x31545353u    // "SST1", the last bytes of every sorted file
+#define SST_RECORD_HEADER 8      // key and length before the value of each record
+#define SST_INDEX_ENTRY 16       // first key, size and offset of a block
+#define SST_FOOTER 32            // index offset, block count, record count, filter offset and size, magic
+#define SST_FILTER_BITS 10       // bloom filter bits per key, about 1% false positives
+#define SST_FILTER_PROBES 7      // bits set per key
+
+
+/**********************************************************
+ * Helpers for the bloom filter of a sorted file
+ ***********************************************************/
+
+/* mixes a key into 64 well spread bits, the two halves seed the probe sequence */
+static uint64_t hash_key(int key) {
+	uint64_t h = (uint32_t)key;
+	h = (h ^ (h >> 33)) * 0xFF51AFD7ED558CCDULL;
+	h = (h ^ (h >> 33)) * 0xC4CEB9FE1A85EC53ULL;
+	return h ^ (h >> 33);
+}
+
+
+
+static void filter_add(unsigned char* filter, uint64_t bits, int key) {
+	uint64_t h = hash_key(key);
+	uint64_t step = (h >> 32) | 1;
+	int i;
+	for (i = 0; i < SST_FILTER_PROBES; i++) {
+		uint64_t bit = (h + i * step) % bits;
+		filter[bit / 8] |= (unsigned char)(1 << (bit % 8));
+	}
+}
+
+
+
+static int filter_may_contain(const unsigned char* filter, uint64_t bits, int key) {
+	uint64_t h = hash_key(key);
+	uint64_t step = (h >> 32) | 1;
+	int i;
+	for (i = 0; i < SST_FILTER_PROBES; i++) {
+		uint64_t bit = (h + i * step) % bits;
+		if ((filter[bit / 8] & (1 << (bit % 8))) == 0) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+
+
+/**********************************************************
+ * Helpers for writing sorted files
+ ***********************************************************/
+
+/* struct holding a sorted file while it is written */
+typedef struct sstable_writer_struct {
+	FILE* file;
+	const char* path;
+	char* block;          // the block being filled
+	int used;             // bytes in block
+	int capacity;         // bytes block can hold, more than SST_BLOCK_SIZE only for a huge value
+	int first_key;        // first key of the block
+	uint64_t offset;      // where the block will start
+	int num_blocks;
+	int index_capacity;
+	int* first_keys;
+	uint64_t* offsets;
+	int* sizes;
+} sstwriter;
+
+
+
+static void write_bytes(sstwriter* w, const void* p, size_t n) {
+	if (fwrite(p, 1, n, w->file) != n) {
+		fprintf(stderr, "Error writing sorted file %s\n", w->path);
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+
+/* writes out the block being filled and adds it to the index */
+static void end_block(sstwriter* w) {
+	if (w->used == 0) {
+		return;
+	}
+	if (w->num_blocks == w->index_capacity) {
+		w->index_capacity = w->index_capacity * 2;
+		w->first_keys = myRealloc(w->first_keys, w->index_capacity * sizeof(int));
+		w->offsets = myRealloc(w->offsets, w->index_capacity * sizeof(uint64_t));
+		w->sizes = myRealloc(w->sizes, w->index_capacity * sizeof(int));
+	}
+	w->first_keys[w->num_blocks] = w->first_key;
+	w->offsets[w->num_blocks] = w->offset;
+	w->sizes[w->num_blocks] = w->used;
+	w->num_blocks = w->num_blocks + 1;
+	write_bytes(w, w->block, w->used);
+	w->offset = w->offset + w->used;
+	w->used = 0;
+}
+
+
+
+static void add_record(sstwriter* w, int key, int len, const char* value) {
+	int bytes = SST_RECORD_HEADER + (len > 0 ? len : 0);
+	if (w->used > 0 && w->used + bytes > SST_BLOCK_SIZE) {
+		end_block(w);
+	}
+	if (bytes > w->capacity) {	//a value too big for a block gets one of its own
+		w->capacity = bytes;
+		w->block = myRealloc(w->block, w->capacity);
+	}
+	if (w->used == 0) {
+		w->first_key = key;
+	}
+	memcpy(w->block + w->used, &key, 4);
+	memcpy(w->block + w->used + 4, &len, 4);
+	if (len > 0) {
+		memcpy(w->block + w->used + SST_RECORD_HEADER, value, len);
+	}
+	w->used = w->used + bytes;
+}
+
+
+
+/* fsyncs the directory holding path, so that a rename into it survives a power loss */
+static int sync_parent_dir(const char* path) {
+	const char* slash = strrchr(path, '/');
+	char* dir;
+	if (slash == NULL) {
+		dir = strdup(".");
+	} else if (slash == path) {
+		dir = strdup("/");
+	} else {
+		dir = strndup(path, slash - path);
+	}
+	int fd = open(dir, O_RDONLY | O_DIRECTORY);
+	free(dir);
+	if (fd < 0) {
+		return -1;
+	}
+	int ok = fsync(fd);
+	close(fd);
+	return ok;
+}
+
+
+
+/**********************************************************
+ * Helpers for reading sorted files
+ ***********************************************************/
+
+/* reads block b of the file into *buf, growing it as needed */
+static void read_block(sstable* t, int b, char** buf) {
+	*buf = myRealloc(*buf, t->sizes[b]);
+	if (pread(fileno(t->file), *buf, t->sizes[b], (off_t)t->offsets[b]) != t->sizes[b]) {	//one system call, no stdio buffering
+		fprintf(stderr, "Error reading sorted file block %i\n", b);
+		exit(EXIT_FAILURE);
+	}
+}
+
+
+
+/* finds the last block whose first key is at most key, -1 if key is below them all */
+static int find_block(sstable* t, int key) {
+	int low = 0;
+	int high = t->num_blocks - 1;
+	int found = -1;
+	while (low <= high) {
+		int mid = low + (high - low) / 2;
+		if (t->first_keys[mid] <= key) {
+			found = mid;
+			low = mid + 1;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return found;
+}
+
+
+
+/* decodes the record at pos, returns where the next one starts */
+static int parse_record(const char* buf, int pos, int* key, int* len, const char** value) {
+	memcpy(key, buf + pos, 4);
+	memcpy(len, buf + pos + 4, 4);
+	*value = buf + pos + SST_RECORD_HEADER;
+	return pos + SST_RECORD_HEADER + (*len > 0 ? *len : 0);
+}
+
+
+
+/**********************************************************
+ * Functions for sorted files
+ ***********************************************************/
+
+int flush_memtable(memtable* mt, const char* path) {
+	if (mt->list->size == 0) {
+		return 0;
+	}
+	char* tmp = myMalloc(strlen(path) + 5);
+	sprintf(tmp, "%s.tmp", path);
+	sstwriter w;
+	w.file = fopen(tmp, "wb");
+	if (w.file == NULL) {
+		fprintf(stderr, "Error creating sorted file %s\n", tmp);
+		exit(EXIT_FAILURE);
+	}
+	w.path = tmp;
+	w.capacity = SST_BLOCK_SIZE;
+	w.block = myMalloc(w.capacity);
+	w.used = 0;
+	w.first_key = 0;
+	w.offset = 0;
+	w.num_blocks = 0;
+	w.index_capacity = 64;
+	w.first_keys = myMalloc(w.index_capacity * sizeof(int));
+	w.offsets = myMalloc(w.index_capacity * sizeof(uint64_t));
+	w.sizes = myMalloc(w.index_capacity * sizeof(int));
+
+	uint64_t filter_bits = (uint64_t)mt->list->size * SST_FILTER_BITS;
+	int filter_bytes = (int)((filter_bits + 7) / 8);
+	filter_bits = (uint64_t)filter_bytes * 8;
+	unsigned char* filter = calloc(filter_bytes, 1);
+	if (filter == NULL) {
+		fprintf(stderr, "Error allocating memory.\n");
+		exit(EXIT_FAILURE);
+	}
+	int entries = 0;
+	mtnode* n;
+	for (n = mt_first(mt); n != NULL; n = n->next[0]) {	//the memtable streams out already sorted
+		add_record(&w, n->key, n->value.len, n->value.data);
+		filter_add(filter, filter_bits, n->key);	//tombstones too, a lookup must find them
+		entries = entries + 1;
+	}
+	end_block(&w);
+
+	uint64_t index_offset = w.offset;
+	int b;
+	for (b = 0; b < w.num_blocks; b++) {
+		char entry[SST_INDEX_ENTRY];
+		memcpy(entry, &w.first_keys[b], 4);
+		memcpy(entry + 4, &w.sizes[b], 4);
+		memcpy(entry + 8, &w.offsets[b], 8);
+		write_bytes(&w, entry, SST_INDEX_ENTRY);
+	}
+	uint64_t filter_offset = index_offset + (uint64_t)w.num_blocks * SST_INDEX_ENTRY;
+	write_bytes(&w, filter, filter_bytes);
+	char footer[SST_FOOTER];
+	uint32_t magic = SST_MAGIC;
+	memcpy(footer, &index_offset, 8);
+	memcpy(footer + 8, &w.num_blocks, 4);
+	memcpy(footer + 12, &entries, 4);
+	memcpy(footer + 16, &filter_offset, 8);
+	memcpy(footer + 24, &filter_bytes, 4);
+	memcpy(footer + 28, &magic, 4);
+	write_bytes(&w, footer, SST_FOOTER);
+	if (fflush(w.file) != 0 || fsync(fileno(w.file)) != 0 || fclose(w.file) != 0
+			|| rename(tmp, path) != 0	//the file appears complete or not at all
+			|| sync_parent_dir(path) != 0) {	//and the rename is durable before the log goes
+		fprintf(stderr, "Error finishing sorted file %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+	free(w.block);
+	free(w.first_keys);
+	free(w.offsets);
+	free(w.sizes);
+	free(filter);
+	free(tmp);
+
+	clear_memtable(mt);	//only now is the log no longer needed
+	return entries;
+}
+
+
+
+sstable* open_sstable(const char* path) {
+	FILE* f = fopen(path, "rb");
+	if (f == NULL) {
+		return NULL;
+	}
+	char footer[SST_FOOTER];
+	uint64_t index_offset, filter_offset;
+	int num_blocks, num_entries, filter_bytes;
+	uint32_t magic = 0;
+	if (fseek(f, -SST_FOOTER, SEEK_END) == 0 && fread(footer, 1, SST_FOOTER, f) == SST_FOOTER) {
+		memcpy(&index_offset, footer, 8);
+		memcpy(&num_blocks, footer + 8, 4);
+		memcpy(&num_entries, footer + 12, 4);
+		memcpy(&filter_offset, footer + 16, 8);
+		memcpy(&filter_bytes, footer + 24, 4);
+		memcpy(&magic, footer + 28, 4);
+	}
+	if (magic != SST_MAGIC || num_blocks < 0 || filter_bytes <= 0) {
+		fprintf(stderr, "%s is not a sorted file\n", path);
+		fclose(f);
+		return NULL;
+	}
+
+	sstable* t = myMalloc(sizeof(sstable));
+	t->file = f;
+	t->num_blocks = num_blocks;
+	t->num_entries = num_entries;
+	t->first_keys = myMalloc((num_blocks + 1) * sizeof(int));
+	t->offsets = myMalloc((num_blocks + 1) * sizeof(uint64_t));
+	t->sizes = myMalloc((num_blocks + 1) * sizeof(int));
+	t->block = NULL;
+	t->cached = -1;
+	t->filter = myMalloc(filter_bytes);
+	t->filter_bits = (uint64_t)filter_bytes * 8;
+	char* index = myMalloc((size_t)num_blocks * SST_INDEX_ENTRY + 1);
+	if (fseek(f, (long)index_offset, SEEK_SET) != 0
+			|| fread(index, SST_INDEX_ENTRY, num_blocks, f) != (size_t)num_blocks
+			|| fseek(f, (long)filter_offset, SEEK_SET) != 0
+			|| fread(t->filter, 1, filter_bytes, f) != (size_t)filter_bytes) {
+		fprintf(stderr, "Error reading the index of %s\n", path);
+		free(index);
+		free_sstable(t);
+		return NULL;
+	}
+	int b;
+	for (b = 0; b < num_blocks; b++) {
+		memcpy(&t->first_keys[b], index + b * SST_INDEX_ENTRY, 4);
+		memcpy(&t->sizes[b], index + b * SST_INDEX_ENTRY + 4, 4);
+		memcpy(&t->offsets[b], index + b * SST_INDEX_ENTRY + 8, 8);
+	}
+	free(index);
+	return t;
+}
+
+
+
+void free_sstable(sstable* t) {
+	fclose(t->file);
+	free(t->first_keys);
+	free(t->offsets);
+	free(t->sizes);
+	free(t->block);
+	free(t->filter);
+	free(t);
+}
+
+
+
+int sst_get(sstable* t, int key, const char** value, int* len) {
+	if (!filter_may_contain(t->filter, t->filter_bits, key)) {	//most files without the key cost no read
+		return KV_NOT_FOUND;
+	}
+	int b = find_block(t, key);
+	if (b < 0) {
+		return KV_NOT_FOUND;
+	}
+	if (t->cached != b) {
+		read_block(t, b, &t->block);
+		t->cached = b;
+	}
+	int pos = 0;
+	while (pos < t->sizes[b]) {
+		int k, l;
+		const char* v;
+		pos = parse_record(t->block, pos, &k, &l, &v);
+		if (k == key) {
+			if (l == MT_TOMBSTONE) {
+				return KV_DELETED;
+			}
+			*value = v;
+			*len = l;
+			return KV_FOUND;
+		} else if (k > key) {
+			break;
+		}
+	}
+	return KV_NOT_FOUND;
+}
+
+
+
+/* loads block b and decodes its first record, or marks the iterator done */
+static void sstiter_load(sstiter* it, int b) {
+	it->block = b;
+	if (b >= it->table->num_blocks) {
+		return;
+	}
+	read_block(it->table, b, &it->buf);
+	it->pos = 0;
+	parse_record(it->buf, 0, &it->key, &it->len, &it->value);
+}
+
+
+
+void sstiter_seek(sstiter* it, sstable* t, int key) {
+	it->table = t;
+	int b = find_block(t, key);
+	sstiter_load(it, (b < 0) ? 0 : b);
+	while (sstiter_valid(it) && it->key < key) {
+		sstiter_next(it);
+	}
+}
+
+
+
+int sstiter_valid(sstiter* it) {
+	return it->block < it->table->num_blocks;
+}
+
+
+
+void sstiter_next(sstiter* it) {
+	it->pos = it->pos + SST_RECORD_HEADER + (it->len > 0 ? it->len : 0);
+	if (it->pos >= it->table->sizes[it->block]) {
+		sstiter_load(it, it->block + 1);
+	} else {
+		parse_record(it->buf, it->pos, &it->key, &it->len, &it->value);
+	}
+}
+
+
+
+void free_sstiter(sstiter* it) {
+	free(it->buf);
+	it->buf = NULL;
+}
+
+
+
+/**********************************************************
+ * Functions for the merging iterator
+ ***********************************************************/
+
+kvmerge* create_kvmerge(memtable* mt, sstable** tables, int num_tables) {
+	kvmerge* m = myMalloc(sizeof(kvmerge));
+	m->mt = mt;
+	m->node = NULL;
+	m->num_tables = num_tables;
+	m->iters = myMalloc((num_tables + 1) * sizeof(sstiter));
+	int i;
+	for (i = 0; i < num_tables; i++) {
+		m->iters[i].table = tables[i];
+		m->iters[i].buf = NULL;
+		m->iters[i].block = tables[i]->num_blocks;	//not positioned yet
+	}
+	m->valid = FALSE;
+	return m;
+}
+
+
+
+void free_kvmerge(kvmerge* m) {
+	int i;
+	for (i = 0; i < m->num_tables; i++) {
+		free_sstiter(&m->iters[i]);
+	}
+	free(m->iters);
+	free(m);
+}
+
+
+
+/* moves every source that is at key past it */
+static void merge_skip(kvmerge* m, int key) {
+	if (m->node != NULL && m->node->key == key) {
+		m->node = m->node->next[0];
+	}
+	int i;
+	for (i = 0; i < m->num_tables; i++) {
+		if (sstiter_valid(&m->iters[i]) && m->iters[i].key == key) {
+			sstiter_next(&m->iters[i]);
+		}
+	}
+}
+
+
+
+/*
+ * Settles on the smallest key any source is at.  The newest source holding
+ * it supplies the value; a tombstone there moves every source past the key
+ * and looks again.  Sources are scanned in turn, as a store only has a few.
+ */
+static void merge_settle(kvmerge* m) {
+	while (TRUE) {
+		int found = FALSE;
+		int key = 0;
+		int len = 0;
+		const char* value = NULL;
+		int i;
+		if (m->node != NULL) {
+			found = TRUE;
+			key = m->node->key;
+			len = m->node->value.len;
+			value = m->node->value.data;
+		}
+		for (i = 0; i < m->num_tables; i++) {
+			sstiter* it = &m->iters[i];
+			if (sstiter_valid(it) && (!found || it->key < key)) {	//ties go to the newer source seen first
+				found = TRUE;
+				key = it->key;
+				len = it->len;
+				value = it->value;
+			}
+		}
+		if (!found) {
+			m->valid = FALSE;
+			return;
+		}
+		if (len != MT_TOMBSTONE) {
+			m->valid = TRUE;
+			m->key = key;
+			m->len = len;
+			m->value = value;
+			return;
+		}
+		merge_skip(m, key);	//deleted, older versions must not show through
+	}
+}
+
+
+
+void merge_seek(kvmerge* m, int key) {
+	m->node = (m->mt != NULL) ? mt_seek(m->mt, key) : NULL;
+	int i;
+	for (i = 0; i < m->num_tables; i++) {
+		sstiter_seek(&m->iters[i], m->iters[i].table, key);
+	}
+	merge_settle(m);
+}
+
+
+
+void merge_seek_first(kvmerge* m) {
+	merge_seek(m, INT32_MIN);
+}
+
+
+
+void merge_next(kvmerge* m) {
+	merge_skip(m, m->key);
+	merge_settle(m);
+}
+
+
+
+/**********************************************************
+ * The following main function is for debugging the sorted
+ * files and the merging iterator.  Supply the
+ * DEBUG_SSTABLE flag to the compiler to compile it with
+ * this main function.
+ ***********************************************************/
+#ifdef DEBUG_SSTABLE
+#define KEYS 5000
+
+/* the value written for a key in a round, so every version reads differently */
+static int make_value(char* buf, int key, int round) {
+	return sprintf(buf, "key %i round %i", key, round);
+}
+
+
+
+int main(void) {
+	printf("=======================\n");
+	printf("Debugging sorted files\n");
+	printf("=======================\n");
+
+	int round_of[KEYS];	//round of the live value of each key, 0 when absent
+	memset(round_of, 0, sizeof(round_of));
+	char buf[64];
+	const char* v;
+	int len;
+	int i, round;
+	const char* paths[2] = {"sstable_debug_0.sst", "sstable_debug_1.sst"};
+	sstable* tables[2];	//newest first
+
+	assert(open_sstable("sstable_debug_missing.sst") == NULL);
+	memtable* mt = create_memtable(NULL);
+	assert(flush_memtable(mt, paths[0]) == 0);
+
+	for (round = 1; round <= 3; round++) {	//two flushed rounds, the third stays in the memtable
+		for (i = round - 1; i < KEYS; i += round) {
+			if (i % 7 == round) {
+				mt_delete(mt, i);
+				round_of[i] = 0;
+			} else {
+				mt_put(mt, i, buf, make_value(buf, i, round));
+				round_of[i] = round;
+			}
+		}
+		if (round < 3) {
+			int count = mt->list->size;
+			assert(flush_memtable(mt, paths[round - 1]) == count);
+			assert(mt->list->size == 0);
+			tables[2 - round] = open_sstable(paths[round - 1]);
+			assert(tables[2 - round] != NULL && tables[2 - round]->num_entries == count);
+		}
+	}
+	printf("%i and %i blocks written\n", tables[1]->num_blocks, tables[0]->num_blocks);
+	assert(tables[1]->num_blocks > 10);
+
+	printf("Looking keys up\n");
+	for (i = 0; i < KEYS; i++) {
+		int status = mt_get(mt, i, &v, &len);
+		int t;
+		for (t = 0; t < 2 && status == KV_NOT_FOUND; t++) {	//newest source first
+			status = sst_get(tables[t], i, &v, &len);
+		}
+		if (round_of[i] == 0) {
+			assert(status != KV_FOUND);
+		} else {
+			assert(status == KV_FOUND);
+			assert(len == make_value(buf, i, round_of[i]) && memcmp(v, buf, len) == 0);
+		}
+	}
+	assert(sst_get(tables[1], -1, &v, &len) == KV_NOT_FOUND);
+	assert(sst_get(tables[1], KEYS, &v, &len) == KV_NOT_FOUND);
+
+	printf("Merging the memtable and both files\n");
+	kvmerge* m = create_kvmerge(mt, tables, 2);
+	merge_seek_first(m);
+	int expect = 0;
+	int live = 0;
+	while (m->valid) {
+		while (round_of[expect] == 0) {
+			expect = expect + 1;
+		}
+		assert(m->key == expect);
+		assert(m->len == make_value(buf, expect, round_of[expect]) && memcmp(m->value, buf, m->len) == 0);
+		live = live + 1;
+		expect = expect + 1;
+		merge_next(m);
+	}
+	for (; expect < KEYS; expect++) {
+		assert(round_of[expect] == 0);
+	}
+	merge_seek(m, 2500);
+	assert(m->valid && m->key >= 2500 && round_of[m->key] != 0);
+	merge_seek(m, KEYS);
+	assert(!m->valid);
+	free_kvmerge(m);
+	printf("%i live keys\n", live);
+
+	printf("Flushing a value bigger than a block\n");
+	char* big = myMalloc(3 * SST_BLOCK_SIZE);
+	memset(big, 'y', 3 * SST_BLOCK_SIZE);
+	mt_put(mt, KEYS + 1, big, 3 * SST_BLOCK_SIZE);
+	assert(flush_memtable(mt, "sstable_debug_2.sst") > 0);
+	sstable* newest = open_sstable("sstable_debug_2.sst");
+	assert(sst_get(newest, KEYS + 1, &v, &len) == KV_FOUND && len == 3 * SST_BLOCK_SIZE && v[len - 1] == 'y');
+	m = create_kvmerge(NULL, &newest, 1);
+	merge_seek(m, KEYS);
+	assert(m->valid && m->key == KEYS + 1 && m->len == 3 * SST_BLOCK_SIZE);
+	merge_next(m);
+	assert(!m->valid);
+	free_kvmerge(m);
+	free_sstable(newest);
+	free(big);
+
+	free_sstable(tables[0]);
+	free_sstable(tables[1]);
+	free_memtable(mt);
+	remove(paths[0]);
+	remove(paths[1]);
+	remove("sstable_debug_2.sst");
+	return 0;
+}
+#endif
@@ -0,0 +1,170 @@
+#ifndef _sstable_h
+#define _sstable_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include "memtable.h"
+
+#define SST_BLOCK_SIZE 4096   // target bytes per data block, the unit read from disk
+
+
+/*
+ * struct defining an open sorted file: an immutable run of key/value
+ * records in key order, written by flush_memtable.  The file is a series
+ * of data blocks, then a sparse index holding the first key, offset and
+ * size of every block, then a bloom filter of the keys, then a fixed
+ * footer locating both.  Opening a file loads only the index and the
+ * filter; a lookup the filter lets through reads the one block that may
+ * hold the key.  Deleted keys are kept as tombstones so they still hide
+ * the key in older files.
+ */
+typedef struct sstable_struct {
+    FILE* file;              // the open file
+    int num_blocks;          // number of data blocks
+    int num_entries;         // number of records, tombstones included
+    int* first_keys;         // the sparse index: smallest key of each block
+    uint64_t* offsets;       // where each block starts
+    int* sizes;              // bytes in each block
+    unsigned char* filter;   // bloom filter of every key in the file
+    uint64_t filter_bits;    // bits in filter
+    char* block;             // the block last read by sst_get
+    int cached;              // which block is in block, -1 for none
+} sstable;
+
+
+/* struct defining a position in a sorted file, for walking its records in key order */
+typedef struct sstable_iter_struct {
+    sstable* table;      // the file being walked
+    int block;           // block holding the current record, num_blocks once past the end
+    char* buf;           // that block
+    int pos;             // offset of the current record in buf
+    int key;             // key of the current record
+    int len;             // bytes in its value, MT_TOMBSTONE for a deleted key
+    const char* value;   // its value, points into buf
+} sstiter;
+
+
+/*
+ * struct defining a merging iterator: walks the keys of a memtable and
+ * any number of sorted files as one ordered store.  When several sources
+ * hold a key, the newest one wins, and deleted keys are skipped.
+ */
+typedef struct kv_merge_struct {
+    memtable* mt;          // the newest source, may be NULL
+    mtnode* node;          // current node of the memtable
+    int num_tables;        // number of sorted files
+    sstiter* iters;        // one per file, newest first
+    int valid;             // FALSE once every source is exhausted
+    int key;               // the current key
+    int len;               // bytes in its value
+    const char* value;     // its value, valid until the iterator moves
+} kvmerge;
+
+
+
+/**********************************************************
+ * function prototypes
+ ***********************************************************/
+
+/**
+ * Writes the contents of the memtable to a new sorted file and empties the
+ * memtable and its log.  The file is written under a temporary name,
+ * synced and then renamed, so a crash leaves either no file and the log,
+ * or the complete file.
+ * @param mt - a pointer to the memtable to flush
+ * @param path - the sorted file to create
+ * @return the number of records written, 0 for an empty memtable, which
+ *         writes no file
+ **/
+int flush_memtable(memtable* mt, const char* path);
+
+/**
+ * Opens a sorted file and loads its index and bloom filter.
+ * @param path - the sorted file
+ * @return a pointer to the open file, NULL if it is missing or not a sorted file
+ **/
+sstable* open_sstable(const char* path);
+
+/**
+ * Closes a sorted file.
+ * @param t - a pointer to the open file
+ **/
+void free_sstable(sstable* t);
+
+/**
+ * Looks up a key, reading at most one block and usually none when the
+ * key is not in the file.
+ * @param t - a pointer to the open file
+ * @param key - the key
+ * @param value - set to the value when found, valid until the next sst_get on t
+ * @param len - set to the number of bytes in the value when found
+ * @return KV_FOUND, KV_DELETED or KV_NOT_FOUND
+ **/
+int sst_get(sstable* t, int key, const char** value, int* len);
+
+/**
+ * Positions an iterator on the first record with a key at or after key.
+ * free_sstiter releases its buffer.
+ * @param it - the iterator
+ * @param t - a pointer to the open file
+ * @param key - the key to seek to
+ **/
+void sstiter_seek(sstiter* it, sstable* t, int key);
+
+/**
+ * Checks whether an iterator is on a record.
+ * @param it - the iterator
+ * @return TRUE if it is, FALSE once past the last record
+ **/
+int sstiter_valid(sstiter* it);
+
+/**
+ * Moves an iterator to the next record.
+ * @param it - a valid iterator
+ **/
+void sstiter_next(sstiter* it);
+
+/**
+ * Releases the buffer of an iterator.
+ * @param it - the iterator
+ **/
+void free_sstiter(sstiter* it);
+
+/**
+ * Creates a merging iterator over a memtable and sorted files.  It is not
+ * positioned until merge_seek or merge_seek_first.  The sources must not
+ * change while it is in use.
+ * @param mt - the memtable, NULL for none
+ * @param tables - the sorted files, newest first
+ * @param num_tables - the number of sorted files
+ * @return a pointer to the new iterator
+ **/
+kvmerge* create_kvmerge(memtable* mt, sstable** tables, int num_tables);
+
+/**
+ * Frees a merging iterator.  The sources are left open.
+ * @param m - a pointer to the iterator
+ **/
+void free_kvmerge(kvmerge* m);
+
+/**
+ * Positions the iterator on the first live key at or after key.
+ * @param m - a pointer to the iterator
+ * @param key - the key to seek to
+ **/
+void merge_seek(kvmerge* m, int key);
+
+/**
+ * Positions the iterator on the smallest live key.
+ * @param m - a pointer to the iterator
+ **/
+void merge_seek_first(kvmerge* m);
+
+/**
+ * Moves the iterator to the next live key.
+ * @param m - a pointer to a valid iterator
+ **/
+void merge_next(kvmerge* m);
+
+
+#endif
@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdatomic.h>
+#include <time.h>
 #include "utils.h"
 
 /**
@@ -20,3 +22,51 @@ void* myMalloc(size_t size) {
     return ptr;
 }
 
+
+
+/**
+ * Attempts to resize a block of memory. If reallocation fails, the
+ * program terminates. This function is handy as it handles all
+ * of the error checking that is required each time a user calls
+ * 'realloc'.
+ * @param ptr - the block to resize, or NULL to allocate a new one
+ * @param size - the number of bytes requested
+ * @return a pointer to the resized memory if reallocation is
+ *  successful.
+ **/
+void* myRealloc(void* ptr, size_t size) {
+    void *p;
+    if ((p = realloc(ptr, size)) == NULL) {
+        fprintf(stderr, "Error allocating memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+
+
+/**
+ * Turns any value into a state for the xorshift64* generators the
+ * skiplists draw node levels from.  Nearby values give unrelated states.
+ * @param seed - any value
+ * @return the state, never zero
+ **/
+uint64_t mix_seed(uint64_t seed) {
+	seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;	//splitmix
+	seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+	seed = seed ^ (seed >> 31);
+	return (seed != 0) ? seed : 0x9E3779B97F4A7C15ULL;	//xorshift state must not be zero
+}
+
+
+
+/**
+ * Gives a generator state for a new skiplist, different on every call,
+ * from any thread, and from run to run.
+ * @return the state, never zero
+ **/
+uint64_t random_seed(void) {
+	static atomic_ullong instance = 0;
+	uint64_t n = atomic_fetch_add(&instance, 1) + 1;
+	return mix_seed((uint64_t)time(NULL) ^ (n * 0x9E3779B97F4A7C15ULL));
+}
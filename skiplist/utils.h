@@ -4,6 +4,33 @@
 #define TRUE  1
 #define FALSE 0
 
+#include <stddef.h>
+#include <stdint.h>
+
 void* myMalloc(size_t size);
 
+void* myRealloc(void* ptr, size_t size);
+
+uint64_t mix_seed(uint64_t seed);
+
+uint64_t random_seed(void);
+
+/* xorshift64*, fast and good enough for picking levels; state must not be 0 */
+static inline uint32_t xorshift_next(uint64_t* state) {
+	uint64_t x = *state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return (uint32_t)((x * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+/* a level below max_levels, one more with probability 1/2 per step */
+static inline int half_level(uint64_t* state, int max_levels) {
+	uint32_t r = xorshift_next(state);
+	int top = max_levels - 1;
+	int level = (r == 0) ? top : __builtin_ctz(r);
+	return (level < top) ? level : top;
+}
+
 #endif